@@ -9,6 +9,7 @@
 
 #include "button/watcher.hpp"
 #include "config.hpp"
+#include "diagnostics/console.hpp"
 #include "display/menu/main_menu_choices.hpp"
 #include "display/menu/menu.hpp"
 #include "display/renderer.hpp"
@@ -18,9 +19,14 @@
 #include "display/string_property_editor.hpp"
 #include "display/text.hpp"
 #include "led/strip_animator.hpp"
+#include "network/link_bench.hpp"
 #include "network/network_handler.hpp"
+#include "network/network_messages.hpp"
+#include "power/manager.hpp"
 #include "ringbuffer.hpp"
 
+#include <event_bus.hpp>
+
 namespace nsec::runtime {
 
 /*
@@ -40,32 +46,86 @@ public:
 	// Setup hardware.
 	void setup();
 
-	void relase_focus_current_screen() noexcept;
-	void on_splash_complete() noexcept;
+	// Resume the tasks that went to sleep if their wake-up condition occurred.
+	void check_wake_up_sources() noexcept;
+
+	// Let the MCU idle until the next interrupt; called with the result of the tick.
+	void idle(nsec::scheduling::relative_time_ms time_to_next_tick) noexcept;
+
 	uint8_t level() const noexcept;
 	bool is_connected() const noexcept;
 
-	void on_disconnection() noexcept;
 	void on_pairing_begin() noexcept;
-	void on_pairing_end(nsec::communication::peer_id_t our_peer_id,
-			    uint8_t peer_count) noexcept;
-	nsec::communication::network_handler::application_message_action
-	on_message_received(communication::message::type message_type,
-			    const uint8_t *message) noexcept;
-	void on_app_message_sent() noexcept;
 
 	void apply_score_change(uint8_t new_badges_discovered_count) noexcept;
-	void show_badge_info() noexcept;
 
 	void tick(nsec::scheduling::absolute_time_ms current_time_ms) noexcept;
 
 	enum cycle_animation_direction : int8_t { PREVIOUS = -1, NEXT = 1 };
-	void cycle_selected_animation(cycle_animation_direction direction) noexcept;
+
+	/*
+	 * Notification from one of the badge's subsystems (network, screens) which is
+	 * handled by the badge's event dispatch task rather than in the context of the
+	 * task that posted it.
+	 */
+	struct event {
+		enum class type : uint8_t {
+			// Network events, dispatched first.
+			DISCONNECTION,
+			PAIRING_END,
+			MESSAGE_RECEIVED,
+			APP_MESSAGE_SENT,
+			// UI events.
+			RELEASE_FOCUS,
+			SPLASH_COMPLETE,
+			SHOW_BADGE_INFO,
+			CYCLE_SELECTED_ANIMATION,
+		};
+
+		static constexpr uint8_t network_priority = 0;
+		static constexpr uint8_t ui_priority = 1;
+		static constexpr uint8_t priority_count = 2;
+
+		static event disconnection() noexcept;
+		static event pairing_end(nsec::communication::peer_id_t our_peer_id,
+					 uint8_t peer_count) noexcept;
+		// The payload is copied.
+		static event message_received(communication::message::type message_type,
+					      const uint8_t *payload) noexcept;
+		static event app_message_sent(communication::message::type message_type) noexcept;
+		static event release_focus() noexcept;
+		static event splash_complete() noexcept;
+		static event show_badge_info() noexcept;
+		static event cycle_selected_animation(cycle_animation_direction direction) noexcept;
+
+		uint8_t priority() const noexcept
+		{
+			return event_type <= type::APP_MESSAGE_SENT ? network_priority : ui_priority;
+		}
+
+		type event_type;
+		union {
+			struct {
+				nsec::communication::peer_id_t our_peer_id;
+				uint8_t peer_count;
+			} pairing;
+			struct {
+				communication::message::type message_type;
+				uint8_t payload[communication::message::max_payload_size];
+			} message;
+			struct {
+				cycle_animation_direction direction;
+			} cycle;
+		};
+	};
+
+	// The event is dropped, and counted, if its queue is full.
+	void post_event(const event& new_event) noexcept;
 
 private:
 	enum class network_app_state : uint8_t {
 		UNCONNECTED,
-		EXCHANGING_IDS,
+		// The ID exchange and the pairing animation run concurrently.
 		ANIMATE_PAIRING,
 		ANIMATE_PAIRING_COMPLETED,
 		IDLE,
@@ -84,7 +144,7 @@ private:
 		void new_message(badge& badge,
 				 nsec::communication::message::type msg_type,
 				 const uint8_t *payload) noexcept;
-		void message_sent(badge& badge) noexcept;
+		void message_sent(badge& badge, nsec::communication::message::type msg_type) noexcept;
 		void reset() noexcept;
 		uint8_t new_badges_discovered() const noexcept
 		{
@@ -113,7 +173,6 @@ private:
 		void new_message(badge& badge,
 				 nsec::communication::message::type msg_type,
 				 const uint8_t *payload) noexcept;
-		void message_sent(badge& badge) noexcept;
 		void reset() noexcept;
 
 		void tick(nsec::scheduling::absolute_time_ms current_time_ms) noexcept;
@@ -126,13 +185,24 @@ private:
 			WAIT_MESSAGE_ANIMATION_PART_2,
 			WAIT_DONE,
 			DONE,
+			// Pipelined animation (see config::badge::pipelined_pairing_animation).
+			WAIT_MESSAGE_ANIMATION_START,
+			PIPELINED_ANIMATION,
 		};
 
 		void _animation_state(animation_state) noexcept;
 		animation_state _animation_state() const noexcept;
 
+		void _start_pipelined_animation(badge& badge) noexcept;
+		void _send_start_message(badge& badge) noexcept;
+		void _pipelined_animation_tick(badge& badge,
+					       nsec::scheduling::absolute_time_ms current_time_ms) noexcept;
+
 		uint8_t _current_state : 3;
+		// Ticks spent in the state, or LEDs lit by the pipelined animation.
 		uint8_t _state_counter : 5;
+		// Time at which the pipelined animation starts on all badges.
+		nsec::scheduling::absolute_time_ms _start_time_ms;
 	};
 
 	class pairing_completed_animator {
@@ -169,6 +239,19 @@ private:
 		void run(nsec::scheduling::absolute_time_ms current_time_ms) noexcept override;
 	};
 
+	// Dispatches the posted events, a few per tick. Idle while there are none.
+	class event_dispatch_task : public nsec::scheduling::periodic_task {
+	public:
+		explicit event_dispatch_task();
+		void run(nsec::scheduling::absolute_time_ms current_time_ms) noexcept override;
+
+		// Schedule the task if it is idle.
+		void wake_up() noexcept;
+
+	private:
+		bool _is_idle;
+	};
+
 	struct eeprom_config {
 		uint16_t version_magic;
 		uint8_t favorite_animation_id;
@@ -183,14 +266,36 @@ private:
 
 	// Handle new button event
 	void on_button_event(button::id button, button::event event) noexcept;
+
+	// Event handlers
+	void _handle_event(const event& posted_event) noexcept;
+	void relase_focus_current_screen() noexcept;
+	void on_splash_complete() noexcept;
+	void on_disconnection() noexcept;
+	void on_pairing_end(nsec::communication::peer_id_t our_peer_id,
+			    uint8_t peer_count) noexcept;
+	void on_message_received(communication::message::type message_type,
+				 const uint8_t *message) noexcept;
+	void on_app_message_sent(communication::message::type message_type) noexcept;
+	void show_badge_info() noexcept;
+	void cycle_selected_animation(cycle_animation_direction direction) noexcept;
 	void set_social_level(uint8_t new_level, bool save) noexcept;
 
 	void set_focused_screen(display::screen& focused_screen) noexcept;
 
+#ifdef NSEC_LINK_BENCH
+	// Fails unless the badge is paired.
+	bool _start_link_bench(bool is_bidirectional) noexcept;
+	void _show_link_bench() noexcept;
+#endif
+
 	// Handle network events
 	enum class badge_discovered_result : uint8_t { NEW, ALREADY_KNOWN };
 	badge_discovered_result on_badge_discovered(const uint8_t *id) noexcept;
 	void on_badge_discovery_completed() noexcept;
+	void on_pairing_animation_completed() noexcept;
+	// Show the pairing's result once both the ID exchange and the animation are completed.
+	void _show_pairing_result_if_ready() noexcept;
 
 	network_app_state _network_app_state() const noexcept;
 	void _network_app_state(network_app_state) noexcept;
@@ -201,6 +306,13 @@ private:
 						 uint8_t new_badges_discovered_count) noexcept;
 	void _set_selected_animation(uint8_t animation_id, bool save) noexcept;
 
+	// Choices of the main menu, in the order they are shown.
+	static const display::menu_screen::choices::choice _main_menu_choice_list[];
+#ifdef NSEC_CONSOLE
+	// Commands of the serial console, in flash.
+	static const nsec::diagnostics::console::command _console_commands[];
+#endif
+
 	uint8_t _social_level;
 	uint8_t _selected_animation;
 	// Storage for network_app_state
@@ -208,6 +320,8 @@ private:
 	uint8_t _badges_discovered_last_exchange : 5;
 	bool _is_user_name_set : 1;
 	bool _is_expecting_factory_reset : 1;
+	bool _is_id_exchange_completed : 1;
+	bool _is_pairing_animation_completed : 1;
 	// Mask to prevent repeats after a screen transition, one bit per button.
 	uint8_t _button_had_non_repeat_event_since_screen_focus_change;
 	char _user_name[nsec::config::user::name_max_length];
@@ -231,6 +345,9 @@ private:
 	network_id_exchanger _id_exchanger;
 	pairing_animator _pairing_animator;
 	pairing_completed_animator _pairing_completed_animator;
+#ifdef NSEC_LINK_BENCH
+	communication::link_bench _link_bench;
+#endif
 
 	// menu choices
 	display::main_menu_choices _main_menu_choices;
@@ -238,8 +355,21 @@ private:
 	// animation timer
 	animation_task _timer;
 
+	// events posted by the subsystems
+	event_bus<event, nsec::config::badge::event_queue_length, event::priority_count> _events;
+	event_dispatch_task _event_dispatcher;
+
+	// lowers the power draw while the badge is unused
+	nsec::power::manager _power_manager;
+
 	// persistent buffer of known badge ids
 	nsec::storage::buffer<sizeof(eeprom_config)> _id_buffer;
+
+#ifdef NSEC_CONSOLE
+	nsec::diagnostics::console _console;
+	// Events posted while their queue was full, shown by the "sched" command.
+	uint16_t _dropped_event_count = 0;
+#endif
 };
 } // namespace nsec::runtime
 
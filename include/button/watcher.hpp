@@ -7,6 +7,10 @@
 #ifndef NSEC_BUTTON_WATCHER_HPP
 #define NSEC_BUTTON_WATCHER_HPP
 
+#include "config.hpp"
+#include "diagnostics/benchmark.hpp"
+
+#include <fifo.hpp>
 #include <scheduler.hpp>
 
 #include <stdint.h>
@@ -16,11 +20,22 @@ namespace nsec::button {
 enum class id { UP = 0, RIGHT = 1, DOWN = 2, LEFT = 3, OK = 4, CANCEL = 5 };
 enum class event { UP, DOWN, DOWN_REPEAT };
 
-using new_button_event_notifier = void (*)(id id, event event);
+// `timestamp` is the time at which the event was detected by the watcher.
+using new_button_event_notifier = void (*)(id id,
+					   event event,
+					   scheduling::absolute_time_ms timestamp);
 
 /*
  * Tracks the state of the badge's buttons to debounce and transform
  * the pin readings into UI button events.
+ *
+ * The buttons are only polled while they are in use. Once they have all been
+ * released for a while, the watcher goes to sleep and the first pin change
+ * wakes it up (see wake_up_on_button_activity()).
+ *
+ * Events are queued, with the time at which they were detected, rather than notified
+ * as soon as they are detected: the UI notifies them from its own task (see
+ * dispatch_events()) so that slow event handling never delays the polling.
  */
 class watcher : public nsec::scheduling::periodic_task {
 public:
@@ -36,46 +51,79 @@ public:
 	// Setup hardware.
 	void setup() noexcept;
 
+	/*
+	 * Resume polling if a button changed state while the watcher was asleep. Cheap
+	 * enough to be called on every iteration of the main loop.
+	 */
+	void wake_up_on_button_activity() noexcept;
+
+	// Resume polling, e.g. when the edge that woke the MCU was consumed by an interrupt.
+	void wake_up() noexcept;
+
+	bool is_asleep() const noexcept
+	{
+		return _is_asleep;
+	}
+
+	bool has_pending_events() const noexcept
+	{
+		return !_pending_events.empty();
+	}
+
+	/*
+	 * Notify the events queued since the last call, oldest first, up to max_event_count: the
+	 * others are left queued for the next call.
+	 */
+	void dispatch_events(scheduling::absolute_time_ms current_time_ms,
+			     uint8_t max_event_count) noexcept;
+
+	/*
+	 * Drop the queued events, and the coming events of the buttons being held until they
+	 * are released: e.g. the press which turns the display back on.
+	 */
+	void drop_pending_events() noexcept;
+
 protected:
-	void run(scheduling::absolute_time_ms current_time_ms) noexcept override;
+	NSEC_BENCHMARKED void
+	run(scheduling::absolute_time_ms current_time_ms) noexcept override;
 
 private:
-	class debouncer {
-	public:
-		debouncer();
-
-		// Deactivate copy and assignment.
-		debouncer(const debouncer&) = delete;
-		debouncer(debouncer&&) = delete;
-		debouncer& operator=(const debouncer&) = delete;
-		debouncer& operator=(debouncer&&) = delete;
-		~debouncer() = default;
-
-		enum class event {
-			NONE = -1,
-			UP = static_cast<int>(button::event::UP),
-			DOWN = static_cast<int>(button::event::DOWN),
-			DOWN_REPEAT = static_cast<int>(button::event::DOWN_REPEAT),
-		};
-
-		event update(bool button_state) noexcept;
-
-	private:
-		enum class state : uint8_t {
-			UP_CANDIDATE = 0,
-			DOWN_CANDIDATE = 1,
-			DOWN_WAIT_FIRST_REPEAT = 2,
-			DOWN_REPEAT = 3,
-			NONE = 4,
-		};
-
-		void transition_to_state(state new_state);
-
-		state _state;
-		// Ticks since transition into state.
-		uint8_t _ticks_in_state;
-	} _button_debouncers[static_cast<size_t>(id::CANCEL) + 1];
+	static constexpr uint8_t button_count = static_cast<uint8_t>(id::CANCEL) + 1;
+
+	// Pressed buttons, one bit per button id.
+	static uint8_t _sample_buttons() noexcept;
+
+	void _sleep() noexcept;
+	void _queue_event(id button, event event, scheduling::absolute_time_ms timestamp) noexcept;
+
 	new_button_event_notifier _notify_new_event;
+
+	struct queued_event {
+		uint8_t button : 3;
+		uint8_t type : 2;
+		// Detection time, truncated to 16 bits.
+		uint16_t timestamp_ms;
+	};
+
+	fifo<queued_event, config::button::event_queue_length> _pending_events;
+
+	/*
+	 * All buttons are debounced at once: each button is a bit of the following
+	 * bytes. A button's debounced state toggles once its samples have differed
+	 * from it for debounce_ticks consecutive polls, which are counted by a
+	 * two-bit "vertical" counter (one bit of each counter byte per button).
+	 */
+	uint8_t _debounced_state;
+	uint8_t _change_counter_low;
+	uint8_t _change_counter_high;
+	// Polls left before the next repeat event of each held button.
+	uint8_t _ticks_before_repeat[button_count];
+	// Buttons whose events are dropped until they are released.
+	uint8_t _dropped_buttons;
+
+	// Polling periods during which all buttons were released.
+	uint8_t _idle_ticks;
+	bool _is_asleep;
 };
 
 } // namespace nsec::button
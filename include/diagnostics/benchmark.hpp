@@ -0,0 +1,25 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_DIAGNOSTICS_BENCHMARK_HPP
+#define NSEC_DIAGNOSTICS_BENCHMARK_HPP
+
+/*
+ * Marks the functions whose cycle counts are measured by the simavr benchmark (see
+ * tools/cycle_bench). The benchmark observes their calls: in its build (NSEC_CYCLE_BENCH
+ * defined), they are kept out of line so that the link-time optimizer doesn't fold them
+ * into their callers. Elsewhere, the marker has no effect.
+ *
+ * lib/scheduling and lib/ringbuffer can't include this header and test NSEC_CYCLE_BENCH
+ * themselves.
+ */
+#ifdef NSEC_CYCLE_BENCH
+#define NSEC_BENCHMARKED __attribute__((noinline))
+#else
+#define NSEC_BENCHMARKED
+#endif
+
+#endif // NSEC_DIAGNOSTICS_BENCHMARK_HPP
@@ -0,0 +1,94 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_DIAGNOSTICS_CONSOLE_HPP
+#define NSEC_DIAGNOSTICS_CONSOLE_HPP
+
+#include "config.hpp"
+#include "scheduler.hpp"
+
+#include <stdint.h>
+
+class Print;
+class Stream;
+
+namespace nsec::diagnostics {
+
+/*
+ * Line-oriented command console, built when NSEC_CONSOLE is defined (see the "console"
+ * environment), which runs on the hardware serial port.
+ *
+ * The task consumes the bytes already received, at most
+ * config::diagnostics::console_max_bytes_per_tick per run, and never waits for input.
+ * A complete line is split into a command name and its arguments (the rest of the line)
+ * and dispatched to the matching command of a table in flash. The "help" command lists
+ * the available commands.
+ */
+class console : public scheduling::periodic_task {
+public:
+	// Prints the command's output; arguments may be empty, but never null.
+	using command_handler = void (*)(Print& out, const char *arguments);
+
+	struct command {
+		// Both strings are in flash.
+		const char *name;
+		const char *help;
+		command_handler handler;
+	};
+
+	// The commands are in flash.
+	console(Stream& stream, const command *commands, uint8_t command_count) noexcept;
+
+	/* Deactivate copy and assignment. */
+	console(const console&) = delete;
+	console(console&&) = delete;
+	console& operator=(const console&) = delete;
+	console& operator=(console&&) = delete;
+	~console() = default;
+
+protected:
+	void run(scheduling::absolute_time_ms current_time_ms) noexcept override;
+
+private:
+	void _execute_line() noexcept;
+	void _print_help() noexcept;
+	void _print_prompt() noexcept;
+
+	Stream& _stream;
+	const command *const _commands;
+	const uint8_t _command_count;
+
+	char _line[nsec::config::diagnostics::console_line_length];
+	uint8_t _line_length : 7;
+	// The line is discarded once complete.
+	bool _is_line_too_long : 1;
+};
+
+/*
+ * Time spent running tasks, accumulated when NSEC_CONSOLE is defined (see
+ * scheduler_observer.hpp).
+ */
+namespace scheduler_statistics {
+#ifdef NSEC_CONSOLE
+void on_task_run_begin(const scheduling::task& task) noexcept;
+void on_task_run_end(const scheduling::task& task) noexcept;
+
+void print(Print& out);
+void reset() noexcept;
+#else
+inline void on_task_run_begin(const scheduling::task&) noexcept
+{
+}
+
+inline void on_task_run_end(const scheduling::task&) noexcept
+{
+}
+#endif
+} // namespace scheduler_statistics
+
+} // namespace nsec::diagnostics
+
+#endif // NSEC_DIAGNOSTICS_CONSOLE_HPP
@@ -0,0 +1,76 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_DIAGNOSTICS_FLIGHT_RECORDER_HPP
+#define NSEC_DIAGNOSTICS_FLIGHT_RECORDER_HPP
+
+#include "diagnostics/trace.hpp"
+#include "scheduler.hpp"
+
+#include <stdint.h>
+
+class Print;
+
+/*
+ * Flight recorder and watchdog, part of every build.
+ *
+ * Once started, the watchdog resets the badge if the main loop stops feeding it, such as
+ * when a task never returns. The recorder keeps the most recent network events and slow
+ * task runs (see trace.hpp), along with the task being run, in a .noinit section which
+ * survives the reset.
+ *
+ * After a watchdog reset, the record is preserved: recording stops until it is cleared
+ * from the console (or the badge is powered off), so that later resets don't overwrite
+ * the events that led to the first one. Any other reset starts a new record, unless one is
+ * preserved.
+ *
+ * The badge information screen shows the cause of the last reset and the task that was
+ * running when the watchdog fired; the "crash" console command dumps the whole record.
+ */
+namespace nsec::diagnostics::flight_recorder {
+
+enum class reset_cause : uint8_t {
+	POWER_ON,
+	EXTERNAL,
+	BROWN_OUT,
+	WATCHDOG,
+	// No reset flag: a jump to the reset vector (e.g. a call through a null pointer).
+	SOFTWARE,
+};
+
+// Arm the watchdog, once the badge is set up.
+void start() noexcept;
+void feed_watchdog() noexcept;
+// Around sleeps and operations which may outlast the watchdog's timeout.
+void pause_watchdog() noexcept;
+void resume_watchdog() noexcept;
+
+// Events are recorded through trace::record(), see trace.hpp.
+#ifndef NSEC_LED_PREVIEW
+void on_task_run_begin(const scheduling::task& task) noexcept;
+void on_task_run_end(const scheduling::task& task) noexcept;
+#else
+// The LED previewer (see tools/led_preview) is built without the recorder.
+inline void on_task_run_begin(const scheduling::task&) noexcept
+{
+}
+
+inline void on_task_run_end(const scheduling::task&) noexcept
+{
+}
+#endif
+
+reset_cause last_reset_cause() noexcept;
+
+// The last reset's cause and the task that was running, sized for the display.
+void print_summary(Print& print);
+void dump(Print& print);
+// Drop the preserved record and resume recording.
+void clear() noexcept;
+
+} // namespace nsec::diagnostics::flight_recorder
+
+#endif // NSEC_DIAGNOSTICS_FLIGHT_RECORDER_HPP
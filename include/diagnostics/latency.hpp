@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_DIAGNOSTICS_LATENCY_HPP
+#define NSEC_DIAGNOSTICS_LATENCY_HPP
+
+#include "scheduler.hpp"
+
+class Print;
+
+/*
+ * Input-to-photon latency measurement, built when NSEC_LATENCY_PROBE is defined
+ * (see the "diagnostics" environment).
+ *
+ * A button press starts a measurement which completes when the next frame has been
+ * rendered and flushed to the display and, separately, when the LEDs are next
+ * updated. Both latencies are accumulated in histograms which can be printed as a
+ * summary (diagnostics screen) or dumped in full (serial port).
+ *
+ * Presses are timestamped when the watcher detects them: the physical edge happens
+ * up to debounce_ticks polling periods earlier. Presses happening while a measurement
+ * is in progress are ignored.
+ *
+ * Without NSEC_LATENCY_PROBE, the probes compile to nothing.
+ */
+namespace nsec::diagnostics::latency {
+
+#ifdef NSEC_LATENCY_PROBE
+void on_button_pressed(scheduling::absolute_time_ms timestamp) noexcept;
+void on_frame_flushed(scheduling::absolute_time_ms timestamp) noexcept;
+void on_leds_shown(scheduling::absolute_time_ms timestamp) noexcept;
+
+// Percentiles of both histograms, sized for the display.
+void print_summary(Print& print);
+// Both histograms, one line per bucket, in CSV.
+void dump(Print& print);
+#else
+inline void on_button_pressed(scheduling::absolute_time_ms) noexcept
+{
+}
+
+inline void on_frame_flushed(scheduling::absolute_time_ms) noexcept
+{
+}
+
+inline void on_leds_shown(scheduling::absolute_time_ms) noexcept
+{
+}
+#endif
+
+} // namespace nsec::diagnostics::latency
+
+#endif // NSEC_DIAGNOSTICS_LATENCY_HPP
@@ -0,0 +1,45 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_DIAGNOSTICS_PROFILER_HPP
+#define NSEC_DIAGNOSTICS_PROFILER_HPP
+
+#include <stdint.h>
+
+class Print;
+
+/*
+ * Statistical profiler, built when NSEC_PROFILER is defined (see the "profile"
+ * environment).
+ *
+ * Timer2 interrupts the badge config::diagnostics::profiler_sample_rate_hz times per
+ * second; its handler reads the interrupted program counter from the stack and counts it
+ * in a histogram of flash address ranges (1 << config::diagnostics::profiler_bucket_shift
+ * bytes each). Sampling stops once a bucket is full, which keeps the proportions intact.
+ *
+ * The histogram is dumped in a text format on the serial port from the "Profile" menu
+ * entry; tools/profiler/nsec_profile_symbolize.py maps its buckets to the functions of
+ * the firmware's ELF file.
+ *
+ * The handler delays the other interrupts by a few microseconds, which the software serial
+ * links tolerate at their speed. Without NSEC_PROFILER, start() compiles to nothing.
+ */
+namespace nsec::diagnostics::profiler {
+
+#ifdef NSEC_PROFILER
+void start() noexcept;
+
+// Dump the histogram, then clear it and resume sampling.
+void dump(Print& print);
+#else
+inline void start() noexcept
+{
+}
+#endif
+
+} // namespace nsec::diagnostics::profiler
+
+#endif // NSEC_DIAGNOSTICS_PROFILER_HPP
@@ -0,0 +1,45 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_DIAGNOSTICS_SCHEDULER_OBSERVER_HPP
+#define NSEC_DIAGNOSTICS_SCHEDULER_OBSERVER_HPP
+
+#include "diagnostics/console.hpp"
+#include "diagnostics/flight_recorder.hpp"
+#include "diagnostics/stack_monitor.hpp"
+#include "diagnostics/trace.hpp"
+#include "scheduler.hpp"
+
+namespace nsec::diagnostics {
+
+/*
+ * Observer of the badge's scheduler: keeps track of the running task and of the slow task
+ * runs for the flight recorder. It also traces the execution of tasks, identified by their
+ * address, accumulates the console's statistics and samples their stack usage when
+ * NSEC_TRACE, NSEC_CONSOLE or NSEC_STACK_MONITOR is defined.
+ */
+struct scheduler_observer {
+	static void on_task_run_begin(const scheduling::task& task) noexcept
+	{
+		trace::record(trace::tracepoint::TASK_RUN_BEGIN, 0, uint16_t(uintptr_t(&task)));
+		scheduler_statistics::on_task_run_begin(task);
+		flight_recorder::on_task_run_begin(task);
+		// Last, as it repaints the stack.
+		stack_monitor::on_task_run_begin(task);
+	}
+
+	static void on_task_run_end(const scheduling::task& task) noexcept
+	{
+		stack_monitor::on_task_run_end(task);
+		flight_recorder::on_task_run_end(task);
+		scheduler_statistics::on_task_run_end(task);
+		trace::record(trace::tracepoint::TASK_RUN_END, 0, uint16_t(uintptr_t(&task)));
+	}
+};
+
+} // namespace nsec::diagnostics
+
+#endif // NSEC_DIAGNOSTICS_SCHEDULER_OBSERVER_HPP
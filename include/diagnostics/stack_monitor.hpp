@@ -0,0 +1,52 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_DIAGNOSTICS_STACK_MONITOR_HPP
+#define NSEC_DIAGNOSTICS_STACK_MONITOR_HPP
+
+#include "scheduler.hpp"
+
+class Print;
+
+/*
+ * Stack usage monitor, built when NSEC_STACK_MONITOR is defined (see the "stack"
+ * environment).
+ *
+ * The free RAM, between the end of the static data and the top of the stack, is painted
+ * with a canary value before the C runtime is initialized. The deepest stack use since
+ * boot, of all contexts, is found by looking for the lowest byte that no longer holds the
+ * canary.
+ *
+ * Every config::diagnostics::stack_sample_period task runs, the run is sampled: the
+ * stack below the scheduler is repainted before the task runs and scanned once it
+ * returns, which gives the depth reached by that task (and the interrupts it was
+ * preempted by). The worst case of each task is kept.
+ *
+ * Without NSEC_STACK_MONITOR, the probes compile to nothing.
+ */
+namespace nsec::diagnostics::stack_monitor {
+
+#ifdef NSEC_STACK_MONITOR
+void on_task_run_begin(const scheduling::task& task) noexcept;
+void on_task_run_end(const scheduling::task& task) noexcept;
+
+// Static, heap and stack usage, sized for the display.
+void print_summary(Print& print);
+// The summary and the worst stack depth of each task.
+void dump(Print& print);
+#else
+inline void on_task_run_begin(const scheduling::task&) noexcept
+{
+}
+
+inline void on_task_run_end(const scheduling::task&) noexcept
+{
+}
+#endif
+
+} // namespace nsec::diagnostics::stack_monitor
+
+#endif // NSEC_DIAGNOSTICS_STACK_MONITOR_HPP
@@ -0,0 +1,135 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_DIAGNOSTICS_TRACE_HPP
+#define NSEC_DIAGNOSTICS_TRACE_HPP
+
+#include <stdint.h>
+
+class Print;
+
+/*
+ * Event tracer, built when NSEC_TRACE is defined (see the "trace" environment).
+ *
+ * Tracepoints are declared below, along with the names of their two arguments (a byte
+ * and a 16-bit word, "none" when unused). Records hold the time elapsed since the
+ * previous record (in µs), the tracepoint's id and its arguments; they are kept in a
+ * RAM ring buffer which only retains the most recent ones.
+ *
+ * The buffer is dumped in a text format on the serial port from the "Dump trace" menu
+ * entry. The dumps of a chain of badges can be converted to a single CTF trace, readable
+ * by Babeltrace 2, using tools/trace/nsec_trace_to_ctf.py.
+ *
+ * Tracepoints must not be hit from interrupt handlers. The network's events and the slow
+ * task runs are also kept by the flight recorder (see flight_recorder.hpp), in every
+ * build; without NSEC_TRACE, the other tracepoints compile to nothing.
+ */
+#define NSEC_TRACE_TRACEPOINTS(TRACEPOINT)                          \
+	/* The next record's delta is extended by (delta << 16). */ \
+	TRACEPOINT(CLOCK_ADVANCE, none, delta_high)                 \
+	TRACEPOINT(TASK_RUN_BEGIN, none, task)                      \
+	TRACEPOINT(TASK_RUN_END, none, task)                        \
+	TRACEPOINT(WIRE_PROTOCOL_STATE, state, none)                \
+	TRACEPOINT(MESSAGE_RECEPTION_STATE, state, none)            \
+	TRACEPOINT(MESSAGE_TRANSMISSION_STATE, state, none)         \
+	TRACEPOINT(PAIRING_END, peer_id, peer_count)                \
+	TRACEPOINT(APP_MESSAGE_RECEIVED, type, none)                \
+	TRACEPOINT(APP_MESSAGE_SENT, type, none)                    \
+	TRACEPOINT(RENDER_BEGIN, none, none)                        \
+	TRACEPOINT(RENDER_END, flushed, none)                       \
+	TRACEPOINT(EEPROM_ACCESS_BEGIN, operation, none)            \
+	TRACEPOINT(EEPROM_ACCESS_END, operation, none)              \
+	/* Duration capped at 255 ms. */                            \
+	TRACEPOINT(TASK_RUN_SLOW, duration_ms, task)                \
+	/* Only with NSEC_TRACE_WIRE, see record_wire_byte(). */    \
+	TRACEPOINT(WIRE_BYTE_RECEIVED, value, none)                 \
+	TRACEPOINT(WIRE_BYTE_SENT, value, none)
+
+namespace nsec::diagnostics::trace {
+
+enum class tracepoint : uint8_t {
+#define NSEC_TRACE_TRACEPOINT_ID(name, arg0_name, arg1_name) name,
+	NSEC_TRACE_TRACEPOINTS(NSEC_TRACE_TRACEPOINT_ID)
+#undef NSEC_TRACE_TRACEPOINT_ID
+};
+
+// Argument of the EEPROM_ACCESS_* tracepoints.
+enum class eeprom_operation : uint8_t {
+	LOAD_CONFIG,
+	SAVE_CONFIG,
+	INSERT_BADGE_ID,
+	FACTORY_RESET,
+};
+
+// Tracepoints also kept by the flight recorder.
+constexpr bool is_flight_recorded(tracepoint id) noexcept
+{
+	return id != tracepoint::CLOCK_ADVANCE && id != tracepoint::TASK_RUN_BEGIN &&
+		id != tracepoint::TASK_RUN_END && id != tracepoint::RENDER_BEGIN &&
+		id != tracepoint::RENDER_END && id != tracepoint::WIRE_BYTE_RECEIVED &&
+		id != tracepoint::WIRE_BYTE_SENT;
+}
+
+} // namespace nsec::diagnostics::trace
+
+namespace nsec::diagnostics::flight_recorder {
+#ifndef NSEC_LED_PREVIEW
+void record(trace::tracepoint id, uint8_t arg0, uint16_t arg1) noexcept;
+#else
+// The LED previewer (see tools/led_preview) is built without the flight recorder.
+inline void record(trace::tracepoint, uint8_t, uint16_t) noexcept
+{
+}
+#endif
+} // namespace nsec::diagnostics::flight_recorder
+
+namespace nsec::diagnostics::trace {
+
+#ifdef NSEC_TRACE
+// Append a record to the trace buffer; use record().
+void buffer(tracepoint id, uint8_t arg0, uint16_t arg1) noexcept;
+
+// Dump the buffered records, oldest first, and empty the buffer.
+void dump(Print& print);
+#endif
+
+inline void record(tracepoint id, uint8_t arg0 = 0, uint16_t arg1 = 0) noexcept
+{
+#ifdef NSEC_TRACE
+	buffer(id, arg0, arg1);
+#endif
+	// Resolved at compile time, as the ids are constants.
+	if (is_flight_recorded(id)) {
+		flight_recorder::record(id, arg0, arg1);
+	}
+}
+
+/*
+ * Bytes read from and written to the links by the network handler, when NSEC_TRACE_WIRE is
+ * also defined: a frame fills a good part of the buffer, which then only covers the last
+ * few exchanges.
+ */
+inline void record_wire_byte([[maybe_unused]] tracepoint id,
+			     [[maybe_unused]] uint8_t value) noexcept
+{
+#ifdef NSEC_TRACE_WIRE
+	record(id, value);
+#endif
+}
+
+inline void record_eeprom_access_begin(eeprom_operation operation) noexcept
+{
+	record(tracepoint::EEPROM_ACCESS_BEGIN, uint8_t(operation));
+}
+
+inline void record_eeprom_access_end(eeprom_operation operation) noexcept
+{
+	record(tracepoint::EEPROM_ACCESS_END, uint8_t(operation));
+}
+
+} // namespace nsec::diagnostics::trace
+
+#endif // NSEC_DIAGNOSTICS_TRACE_HPP
@@ -11,13 +11,13 @@
 
 namespace nsec::display {
 
+/*
+ * Choices of the main menu, listed by the badge along with their actions (including those
+ * of the diagnostics builds).
+ */
 class main_menu_choices : public menu_screen::choices {
 public:
-	using choice_action = void(*)();
-	explicit main_menu_choices(
-		const choice_action& set_name_action,
-		const choice_action& show_badge_info_action,
-		const choice_action& factory_reset_action) noexcept;
+	main_menu_choices(const choice *choices, uint8_t count) noexcept;
 
 	/* Deactivate copy and assignment. */
 	main_menu_choices(const main_menu_choices&) = delete;
@@ -30,10 +30,8 @@ public:
 	const choice& operator[](uint8_t) const noexcept override;
 
 private:
-	const choice_action _set_name_action;
-	const choice_action _show_badge_info_action;
-	const choice_action _factory_reset_action;
-	const menu_screen::choices::choice _choices[3];
+	const choice *const _choices;
+	const uint8_t _count;
 };
 
 } // namespace nsec::display
@@ -15,9 +15,15 @@
 
 namespace nsec::display {
 
+/*
+ * Hands the input received since the last frame to the screens before rendering, so
+ * that each frame reflects it.
+ */
+using input_dispatcher = void (*)(scheduling::absolute_time_ms current_time_ms);
+
 class renderer : public scheduling::periodic_task {
 public:
-	explicit renderer(screen **focused_screen) noexcept;
+	renderer(screen **focused_screen, input_dispatcher dispatch_input) noexcept;
 
 	/* Deactivate copy and assignment. */
 	renderer(const renderer&) = delete;
@@ -28,6 +34,33 @@ public:
 
 	void setup() noexcept;
 
+	/*
+	 * DIMMED lowers the panel's contrast and the frame rate. OFF puts the panel to sleep
+	 * (its content is kept) and stops rendering, along with the dispatch of the input.
+	 */
+	enum class power_mode : uint8_t { NORMAL, DIMMED, OFF };
+	void set_power_mode(power_mode mode) noexcept;
+
+#ifdef NSEC_CONSOLE
+	struct frame_statistics {
+		uint16_t frame_count;
+		// Frames sent to the display (some screens update it themselves).
+		uint16_t flushed_frame_count;
+		uint16_t longest_frame_us;
+		unsigned long total_frame_time_us;
+	};
+
+	const frame_statistics& statistics() const noexcept
+	{
+		return _statistics;
+	}
+
+	// Average time to render the focused screen, and to flush a frame, in µs.
+	void benchmark(uint8_t iterations,
+		       unsigned long& render_time_us,
+		       unsigned long& flush_time_us) noexcept;
+#endif
+
 protected:
 	void run(scheduling::absolute_time_ms current_time_ms) noexcept override;
 
@@ -40,8 +73,14 @@ private:
 	uint8_t _frameBuffer[SCREEN_WIDTH * ((SCREEN_HEIGHT + 7) / 8)];
 	Adafruit_SSD1306 _display;
 	uint8_t _render_time_sampling_counter;
+	power_mode _power_mode;
 
 	screen **const _focused_screen;
+	const input_dispatcher _dispatch_input;
+
+#ifdef NSEC_CONSOLE
+	frame_statistics _statistics;
+#endif
 };
 } // namespace nsec::display
 
@@ -8,6 +8,7 @@
 #define NSEC_DISPLAY_UTILS_HPP
 
 #include "Adafruit_SSD1306.h"
+#include "diagnostics/benchmark.hpp"
 
 namespace nsec::display::utils {
 
@@ -16,14 +17,14 @@ namespace nsec::display::utils {
  * Hand-rolled since the canvas Print interface does not allow us to bound the
  * printed length of a string stored in program memory.
  */
-void draw_string(Adafruit_SSD1306& canvas,
-		 const char *str,
-		 uint8_t max_char_count,
-		 bool draw_ellipsis_if_too_long = true) noexcept;
-void draw_string(Adafruit_SSD1306& canvas,
-		 const __FlashStringHelper *str,
-		 uint8_t max_char_count,
-		 bool draw_ellipsis_if_too_long = true) noexcept;
+NSEC_BENCHMARKED void draw_string(Adafruit_SSD1306& canvas,
+				  const char *str,
+				  uint8_t max_char_count,
+				  bool draw_ellipsis_if_too_long = true) noexcept;
+NSEC_BENCHMARKED void draw_string(Adafruit_SSD1306& canvas,
+				  const __FlashStringHelper *str,
+				  uint8_t max_char_count,
+				  bool draw_ellipsis_if_too_long = true) noexcept;
 
 
 enum class arrow_glyph_direction { UP, DOWN, LEFT, RIGHT };
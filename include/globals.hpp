@@ -7,11 +7,21 @@
 
 #include "stdint.h"
 #include "scheduler.hpp"
-#include "badge.hpp"
 #include "config.hpp"
+#include "diagnostics/scheduler_observer.hpp"
+
+/*
+ * The badge is only forward-declared so that modules which only need the scheduler
+ * (e.g. the LED strip animator) can be built without pulling in the whole runtime.
+ */
+namespace nsec::runtime {
+class badge;
+} // namespace nsec::runtime
 
 namespace nsec::g {
-extern scheduling::scheduler<config::scheduler::max_scheduled_task_count> the_scheduler;
+extern scheduling::scheduler<config::scheduler::max_scheduled_task_count,
+			     diagnostics::scheduler_observer>
+	the_scheduler;
 extern runtime::badge the_badge;
 } // namespace nsec::g
 
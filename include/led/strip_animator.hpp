@@ -7,6 +7,7 @@
 #ifndef NSEC_LED_STRIP_ANIMATOR_HPP
 #define NSEC_LED_STRIP_ANIMATOR_HPP
 
+#include "diagnostics/benchmark.hpp"
 #include "scheduler.hpp"
 
 #include <Adafruit_NeoPixel.h>
@@ -27,7 +28,8 @@ public:
 	void setup() noexcept;
 
 	void set_idle_animation(uint8_t id) noexcept;
-
+	// Idle animation ids wrap around after this count.
+	static uint8_t idle_animation_count() noexcept;
 
 	void set_red_to_green_led_progress_bar(uint8_t led_count) noexcept;
 
@@ -40,6 +42,19 @@ public:
 				      uint8_t level,
 				      bool set_lower_bar_on) noexcept;
 
+	/*
+	 * Scale (out of 255) applied to the frames of keyframed animations on top of the
+	 * power limit, to which they fade. At 0, the animation stops once the strip is dark
+	 * until the scale is raised again.
+	 */
+	void power_save_scale(uint8_t scale) noexcept;
+
+	// Running average of the LEDs' estimated current draw.
+	uint16_t average_current_ma() const noexcept
+	{
+		return _average_current_ma_x16 >> 4;
+	}
+
 	struct led_color {
 		led_color() = default;
 		constexpr led_color(uint8_t r_in, uint8_t g_in, uint8_t b_in) :
@@ -115,9 +130,11 @@ private:
 	};
 
 	void _legacy_animation_tick() noexcept;
-	void _keyframe_animation_tick(const scheduling::absolute_time_ms& current_time_ms) noexcept;
+	NSEC_BENCHMARKED void
+	_keyframe_animation_tick(const scheduling::absolute_time_ms& current_time_ms) noexcept;
 	led_color _color(uint8_t led_id) const noexcept;
 	void _reset_keyframed_animation_state() noexcept;
+	void _limit_power() noexcept;
 
 	Adafruit_NeoPixel _pixels;
 	animation_type _current_animation_type;
@@ -135,9 +152,12 @@ private:
 		struct {
 			union {
 				struct {
-					uint8_t ticks_before_advance;
+					uint16_t advance_interval_ms;
 					uint8_t star_count;
 				} shooting_star;
+				struct {
+					uint16_t max_birth_delay_ms;
+				} sparks;
 			};
 			uint8_t keyframe_count : 4;
 			uint8_t loop_point_index : 4;
@@ -156,16 +176,50 @@ private:
 			union {
 				struct {
 					uint8_t position : 4;
-					uint8_t ticks_in_position;
+					// Time at which the stars last moved (truncated to 16 bits).
+					uint16_t last_advance_time_ms;
 				} shooting_star;
 			};
 
 			indice_storage_element origin_keyframe_index[8];
 			indice_storage_element destination_keyframe_index[8];
-			uint8_t ticks_since_start_of_animation[16];
+			/*
+			 * Time at which each LED's animation started, truncated to 16 bits.
+			 * Keyframe times are 16-bit wide so only the (wrapping) difference
+			 * with the current time is meaningful.
+			 */
+			uint16_t animation_start_time_ms[16];
 		} keyframed;
 	} _state;
 
+	/*
+	 * Gamma correction and brightness are applied together through a lookup table; the
+	 * strip itself always runs at full brightness. The tables are in flash, one per
+	 * brightness level, unless NSEC_LED_COLOR_CORRECTION_TABLE_IN_RAM is defined, in which
+	 * case a single table is computed in RAM when the brightness changes (any level).
+	 */
+	void _brightness(uint8_t new_brightness) noexcept;
+	uint8_t _corrected_color_component(uint8_t component) const noexcept;
+	void _set_uncorrected_pixel_color(uint8_t led_id, const led_color& color) noexcept;
+
+#ifdef NSEC_LED_COLOR_CORRECTION_TABLE_IN_RAM
+	uint8_t _color_correction_table[256];
+	uint8_t _color_correction_table_brightness;
+#else
+	const uint8_t *_color_correction_table;
+#endif
+
+	// Scale (out of 255) applied to the frames to keep within the current budget.
+	uint8_t _power_limit_scale;
+	// Upper bound of _power_limit_scale set by the power manager.
+	uint8_t _power_save_scale;
+	bool _is_suspended;
+	// Exponential moving average (1/16 weight) in 1/16th of mA.
+	uint16_t _average_current_ma_x16;
+
+	// State of the random number generator used by animations, seeded from the unique ID.
+	uint16_t _random_state;
+
 	uint8_t _get_keyframe_index(const indice_storage_element *indices,
 				    uint8_t led_id) const noexcept;
 	void _set_keyframe_index(indice_storage_element *indices,
@@ -177,6 +231,11 @@ private:
 					  const keyframe *keyframe,
 					  uint8_t keyframe_count) noexcept;
 
+	void _set_sparks_animation(const keyframe *keyframes,
+				   uint8_t keyframe_count,
+				   uint16_t max_birth_delay_ms) noexcept;
+	void _schedule_spark_birth(uint8_t led_id, uint16_t now_ms) noexcept;
+
 	void _set_keyframed_cycle_animation(const keyframe *keyframe,
 					    uint8_t keyframe_count,
 					    uint8_t loop_point_index,
@@ -0,0 +1,119 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_NETWORK_LINK_BENCH_HPP
+#define NSEC_NETWORK_LINK_BENCH_HPP
+
+#include "config.hpp"
+#include "histogram.hpp"
+#include "network/network_handler.hpp"
+#include "network/network_messages.hpp"
+#include "scheduler.hpp"
+
+class Print;
+
+namespace nsec::communication {
+
+/*
+ * Throughput benchmark of the link to a neighbour, built when NSEC_LINK_BENCH is defined
+ * (see the "link_bench" environment).
+ *
+ * The badge starting the bench streams numbered frames, as long as the largest application
+ * message, to its right neighbour (left one for the right-most badge) for
+ * config::link_bench::duration_s, keeping config::link_bench::window frames in the outbox.
+ * The neighbour streams frames back when the bench is bidirectional. Once done, the badges
+ * exchange reports of the frames they sent and received.
+ *
+ * The results are the goodput of each direction (frames received intact per second), the
+ * frames lost or damaged, the retransmissions of both badges and the percentiles of the
+ * frames' round trip time: from their enqueuing to the neighbour's acknowledgement, which
+ * includes the wait for the token.
+ */
+class link_bench : public scheduling::periodic_task {
+public:
+	explicit link_bench(network_handler& network) noexcept;
+
+	/* Deactivate copy and assignment. */
+	link_bench(const link_bench&) = delete;
+	link_bench(link_bench&&) = delete;
+	link_bench& operator=(const link_bench&) = delete;
+	link_bench& operator=(link_bench&&) = delete;
+	~link_bench() = default;
+
+	// Restarts a bench in progress. The badge must be paired.
+	void start(bool is_bidirectional) noexcept;
+	// The badge is disconnected.
+	void abort() noexcept;
+
+	void on_message_received(message::type message_type, const uint8_t *payload) noexcept;
+	void on_app_message_sent(message::type message_type) noexcept;
+
+	// Progress or results, sized for the display.
+	void print_summary(Print& print, scheduling::absolute_time_ms current_time_ms) const;
+	void print(Print& print, scheduling::absolute_time_ms current_time_ms) const;
+
+protected:
+	void run(scheduling::absolute_time_ms current_time_ms) noexcept override;
+
+private:
+	enum class state : uint8_t {
+		IDLE,
+		STREAMING,
+		// Stopped streaming, waiting to send our report or to receive the neighbour's.
+		WAITING_REPORT,
+		DONE,
+		// Disconnected or no report from the neighbour.
+		FAILED,
+	};
+
+	void _start(scheduling::absolute_time_ms current_time_ms,
+		    peer_relative_position direction,
+		    uint8_t duration_s,
+		    bool is_bidirectional,
+		    bool is_initiator) noexcept;
+	void _stop_streaming(scheduling::absolute_time_ms current_time_ms) noexcept;
+	void _send_frames(scheduling::absolute_time_ms current_time_ms) noexcept;
+	void _send_report() noexcept;
+	void _on_frame(const message::link_bench_frame& frame) noexcept;
+	void _on_report(const message::link_bench_report& report) noexcept;
+	bool _is_streaming_frames() const noexcept;
+	// Duration of the streaming, so far if still in progress.
+	unsigned long _streaming_time_ms(scheduling::absolute_time_ms current_time_ms) const noexcept;
+
+	network_handler& _network;
+
+	state _state;
+	// Storage for a peer_relative_position enum.
+	uint8_t _direction : 1;
+	bool _is_bidirectional : 1;
+	// Started the bench: sends its report first.
+	bool _is_initiator : 1;
+	bool _is_report_pending : 1;
+	bool _has_peer_report : 1;
+	uint8_t _duration_s;
+
+	scheduling::absolute_time_ms _start_time_ms;
+	scheduling::absolute_time_ms _end_time_ms;
+
+	uint16_t _frames_sent;
+	uint16_t _frames_acknowledged;
+	uint16_t _frames_received;
+	// Tells the retransmissions of a frame whose OK was lost apart.
+	uint16_t _last_frame_sequence;
+	uint16_t _frames_damaged;
+	uint16_t _retransmissions;
+	message::link_bench_report _peer_report;
+
+	// Enqueuing time (low 16 bits of millis()) of the frames waiting in the outbox.
+	uint16_t _frame_enqueue_times_ms[config::link_bench::window];
+	histogram<config::link_bench::rtt_histogram_bucket_width_ms,
+		  config::link_bench::rtt_histogram_bucket_count>
+		_round_trip_times;
+};
+
+} // namespace nsec::communication
+
+#endif // NSEC_NETWORK_LINK_BENCH_HPP
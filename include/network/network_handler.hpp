@@ -9,6 +9,9 @@
 
 #include "callback.hpp"
 #include "config.hpp"
+#include "diagnostics/benchmark.hpp"
+#include "fifo.hpp"
+#include "histogram.hpp"
 #include "network_messages.hpp"
 #include "scheduler.hpp"
 
@@ -65,11 +68,68 @@ public:
 	};
 	link_position position() const noexcept;
 
+	/*
+	 * Stop receiving while the badge is in deep sleep (never while connected): the pin
+	 * change interrupts then only wake the badge up.
+	 */
+	void suspend() noexcept;
+	void resume() noexcept;
+
+	/*
+	 * Forward error correction sends every byte of a frame as two Hamming codewords (see
+	 * hamming.hpp): twice the transmission time, but single-bit errors are corrected in
+	 * place instead of costing a retransmission. Once paired, a badge which enables it
+	 * offers it to its neighbours, and codes the frames it sends to those which offered it
+	 * too; the others, including badges running firmware that predates the coding, are
+	 * sent uncoded frames. A change applies from the next discovery.
+	 */
+	void set_forward_error_correction(bool enable) noexcept;
+	bool is_forward_error_correction_enabled() const noexcept;
+	// Whether the frames exchanged with the neighbour on that side are coded.
+	bool is_link_coded(peer_relative_position side) const noexcept;
+
+	/*
+	 * Messages are sent in the order they are enqueued. FULL is returned when the outbox
+	 * holds config::communication::app_message_outbox_length messages.
+	 */
 	enum class enqueue_message_result : uint8_t { QUEUED, UNCONNECTED, FULL };
 	enqueue_message_result enqueue_app_message(peer_relative_position direction,
 						   uint8_t msg_type,
 						   const uint8_t *msg_payload);
 
+	/*
+	 * Wrapping counters of the link's activity, maintained when NSEC_CONSOLE or
+	 * NSEC_LINK_BENCH is defined.
+	 */
+	struct link_statistics {
+		// Wire messages, including retransmissions.
+		uint16_t messages_sent;
+		uint16_t retransmissions;
+		uint16_t messages_received;
+		// Received messages with an invalid checksum or an uncorrectable error.
+		uint16_t corrupted_messages;
+		// Received messages with errors corrected by the link's coding.
+		uint16_t corrected_messages;
+		uint16_t app_messages_sent;
+		uint16_t app_messages_received;
+		// Application messages rejected by a full outbox.
+		uint16_t outbox_overflows;
+		// Resets following a lack of activity.
+		uint16_t timeouts;
+		uint16_t topology_changes;
+		// From the last transmission of our messages to the reception of their OK.
+		histogram<nsec::config::communication::confirmation_time_histogram_bucket_width_ms,
+			  nsec::config::communication::confirmation_time_histogram_bucket_count>
+			confirmation_times;
+	};
+
+#if defined(NSEC_CONSOLE) || defined(NSEC_LINK_BENCH)
+	const link_statistics& statistics() const noexcept
+	{
+		return _statistics;
+	}
+#endif
+
 protected:
 	void run(scheduling::absolute_time_ms current_time_ms) noexcept override;
 
@@ -141,11 +201,13 @@ private:
 				   uint8_t message_type,
 				   const uint8_t *message_payload = nullptr) noexcept;
 
-	// Message transmission request from an application.
-	peer_relative_position _pending_outgoing_app_message_direction() const noexcept;
-	uint8_t _pending_outgoing_app_message_size() const noexcept;
-	bool _has_pending_outgoing_app_message() const noexcept;
-	void _clear_pending_outgoing_app_message() noexcept;
+	// Message transmission requests from the application.
+	struct pending_app_message {
+		// Storage for a peer_relative_location enum
+		uint8_t direction : 1;
+		uint8_t type : 5;
+		uint8_t payload[nsec::communication::message::max_payload_size];
+	};
 
 	enum class check_connections_result : uint8_t {
 		NO_CHANGE,
@@ -154,7 +216,26 @@ private:
 	check_connections_result _check_connections() noexcept;
 
 	void _detect_and_set_position() noexcept;
-	void _run_wire_protocol(nsec::scheduling::absolute_time_ms current_time_ms) noexcept;
+
+	enum class assemble_message_result : uint8_t {
+		NONE,
+		// A message was received and acknowledged.
+		RECEIVED,
+		// Bytes arrived while waiting for the confirmation of our message.
+		REPLY_PENDING,
+	};
+	/*
+	 * Runs at every tick while connected: a message is acknowledged as soon as it is
+	 * complete rather than at the next step of the wire protocol.
+	 */
+	assemble_message_result
+	_assemble_message(nsec::scheduling::absolute_time_ms current_time_ms,
+			  uint8_t& message_type,
+			  uint8_t *message_payload) noexcept;
+	void _run_wire_protocol(nsec::scheduling::absolute_time_ms current_time_ms,
+				bool has_received_message,
+				uint8_t message_type,
+				const uint8_t *message_payload) noexcept;
 	void _reset() noexcept;
 
 	bool _sense_is_left_connected() const noexcept;
@@ -166,9 +247,10 @@ private:
 		COMPLETE,
 		CORRUPTED,
 	};
-	handle_reception_result _handle_reception(SoftwareSerial&,
-						  uint8_t& message_type,
-						  uint8_t *message_payload) noexcept;
+	NSEC_BENCHMARKED handle_reception_result
+	_handle_reception(SoftwareSerial&,
+			  uint8_t& message_type,
+			  uint8_t *message_payload) noexcept;
 
 	enum class handle_transmission_result : uint8_t {
 		COMPLETE,
@@ -177,6 +259,20 @@ private:
 	handle_transmission_result
 	_handle_transmission(nsec::scheduling::absolute_time_ms current_time_ms) noexcept;
 
+	void _count([[maybe_unused]] uint16_t link_statistics::*counter) noexcept
+	{
+#if defined(NSEC_CONSOLE) || defined(NSEC_LINK_BENCH)
+		(_statistics.*counter)++;
+#endif
+	}
+
+	void _record_confirmation_time([[maybe_unused]] unsigned long confirmation_time_ms) noexcept
+	{
+#if defined(NSEC_CONSOLE) || defined(NSEC_LINK_BENCH)
+		_statistics.confirmation_times.record(confirmation_time_ms);
+#endif
+	}
+
 	static bool _is_wire_protocol_in_a_reception_state(wire_protocol_state state) noexcept;
 	static bool _is_wire_protocol_in_a_running_state(wire_protocol_state state) noexcept;
 	static void _log_wire_protocol_state(wire_protocol_state state) noexcept;
@@ -186,6 +282,7 @@ private:
 	SoftwareSerial _left_serial;
 	SoftwareSerial _right_serial;
 	nsec::scheduling::absolute_time_ms _last_message_received_time_ms;
+	nsec::scheduling::absolute_time_ms _last_wire_protocol_step_time_ms;
 
 	uint8_t _is_left_connected : 1;
 	uint8_t _is_right_connected : 1;
@@ -219,14 +316,24 @@ private:
 	uint8_t _current_message_being_sent_direction : 1;
 	uint8_t _current_message_being_sent_type : 5;
 
-	// App-level enqueued message
-	// Storage for a peer_relative_location enum
-	uint8_t _current_pending_outgoing_app_message_direction : 1;
-	uint8_t _current_pending_outgoing_app_message_size : 5;
-	// Enqueued outgoing application message type and payload.
-	uint8_t _current_pending_outgoing_app_message_type : 5;
-	uint8_t _current_pending_outgoing_app_message_payload
-		[nsec::config::communication::protocol_max_message_size];
+	uint8_t _is_forward_error_correction_enabled : 1;
+	// Outcome of the negotiation with each neighbour.
+	uint8_t _is_left_link_coded : 1;
+	uint8_t _is_right_link_coded : 1;
+	uint8_t _has_offered_left_link_coding : 1;
+	uint8_t _has_offered_right_link_coding : 1;
+	// Coding of the message being received, told by its magic number.
+	uint8_t _is_receiving_coded_message : 1;
+	// Type of the message being received, read before its checksum and payload.
+	uint8_t _received_message_type;
+
+	// App-level enqueued messages
+	nsec::fifo<pending_app_message, nsec::config::communication::app_message_outbox_length>
+		_pending_outgoing_app_messages;
+
+#if defined(NSEC_CONSOLE) || defined(NSEC_LINK_BENCH)
+	link_statistics _statistics;
+#endif
 
 	// Message currently being sent and potentially retransmitted.
 	nsec::scheduling::absolute_time_ms _last_transmission_time_ms;
@@ -20,6 +20,11 @@ enum class type : uint8_t {
 	PAIRING_ANIMATION_PART_1_DONE,
 	PAIRING_ANIMATION_PART_2_DONE,
 	PAIRING_ANIMATION_DONE,
+	PAIRING_ANIMATION_START,
+	// Link bench (see link_bench.hpp).
+	LINK_BENCH_START,
+	LINK_BENCH_FRAME,
+	LINK_BENCH_REPORT,
 };
 
 struct announce_badge_id {
@@ -27,6 +32,50 @@ struct announce_badge_id {
 	uint8_t board_unique_id[UniqueIDsize];
 } __attribute__((packed));
 
+struct pairing_animation_start {
+	// Time until the animation starts, from the reception of the message. Negative if late.
+	int16_t start_delay_ms;
+} __attribute__((packed));
+
+struct link_bench_start {
+	// Of the badge starting the bench, which tells its side to its neighbour.
+	uint8_t peer_id;
+	uint8_t duration_s;
+	// The neighbour streams frames back.
+	uint8_t is_bidirectional;
+} __attribute__((packed));
+
+// As long as the largest message.
+struct link_bench_frame {
+	uint16_t sequence;
+	// Derived from the sequence number, to catch the errors the checksum lets through.
+	uint8_t pattern[sizeof(announce_badge_id) - sizeof(uint16_t)];
+} __attribute__((packed));
+
+// Sent by each badge to the other at the end of the bench.
+struct link_bench_report {
+	uint16_t frames_sent;
+	uint16_t frames_received;
+	// Received with a pattern that doesn't match their sequence number.
+	uint16_t frames_damaged;
+	// Of all the badge's links, during the bench.
+	uint16_t retransmissions;
+} __attribute__((packed));
+
+namespace details {
+constexpr uint8_t larger(uint8_t lhs, uint8_t rhs)
+{
+	return lhs > rhs ? lhs : rhs;
+}
+} // namespace details
+
+// Size of the largest application message payload.
+constexpr uint8_t max_payload_size =
+	details::larger(details::larger(sizeof(announce_badge_id), sizeof(pairing_animation_start)),
+			details::larger(details::larger(sizeof(link_bench_start),
+							sizeof(link_bench_frame)),
+					sizeof(link_bench_report)));
+
 } // namespace nsec::communication::message
 
 #endif // NSEC_NETWORK_MESSAGES_HPP
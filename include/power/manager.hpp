@@ -0,0 +1,91 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_POWER_MANAGER_HPP
+#define NSEC_POWER_MANAGER_HPP
+
+#include "button/watcher.hpp"
+#include "display/renderer.hpp"
+#include "led/strip_animator.hpp"
+#include "network/network_handler.hpp"
+#include "scheduler.hpp"
+
+namespace nsec::power {
+
+/*
+ * Lowers the badge's current draw as it stays inactive (see config::power):
+ *   - ACTIVE: everything runs;
+ *   - DIMMED: the panel's contrast and frame rate are lowered, the LEDs are dimmed;
+ *   - DISPLAY_OFF: the panel sleeps, the LEDs fade out and their animation stops;
+ *   - DEEP_SLEEP: the MCU is powered down until a button or a connection line changes
+ *     level. millis() stands still meanwhile. Never entered while connected.
+ *
+ * Activity brings the badge back to ACTIVE. The button presses which turn the display back
+ * on are dropped rather than acting on the screen. In all states, the MCU idles between the
+ * scheduler's ticks (see idle()).
+ *
+ * On the ATmega328P, OK and CANCEL can't wake the badge from deep sleep (see
+ * button::watcher).
+ */
+class manager : public scheduling::periodic_task {
+public:
+	enum class state : uint8_t { ACTIVE, DIMMED, DISPLAY_OFF, DEEP_SLEEP };
+
+	manager(display::renderer& renderer,
+		led::strip_animator& strip_animator,
+		communication::network_handler& network_handler,
+		button::watcher& button_watcher) noexcept;
+
+	/* Deactivate copy and assignment. */
+	manager(const manager&) = delete;
+	manager(manager&&) = delete;
+	manager& operator=(const manager&) = delete;
+	manager& operator=(manager&&) = delete;
+	~manager() = default;
+
+	// A button was pressed, an application message received or a connection changed.
+	void on_activity() noexcept;
+
+	/*
+	 * The renderer dispatches the button events: while it is stopped, wake up on the
+	 * events it would dispatch. Cheap enough to be called on every iteration of the main
+	 * loop.
+	 */
+	void check_wake_up_sources() noexcept;
+
+	// Idle the MCU until the next interrupt if no task is due.
+	static void idle(scheduling::relative_time_ms time_to_next_tick) noexcept;
+
+	state current_state() const noexcept
+	{
+		return _current_state;
+	}
+
+	// Estimated supply current of the badge in a state, with the current LED frames, in µA.
+	uint32_t estimated_current_ua(state for_state) const noexcept;
+
+	// Time since the last activity.
+	scheduling::absolute_time_ms inactive_time_ms() const noexcept;
+
+protected:
+	void run(scheduling::absolute_time_ms current_time_ms) noexcept override;
+
+private:
+	void _state(state new_state) noexcept;
+	void _deep_sleep() noexcept;
+
+	display::renderer& _renderer;
+	led::strip_animator& _strip_animator;
+	communication::network_handler& _network_handler;
+	button::watcher& _button_watcher;
+
+	scheduling::absolute_time_ms _last_activity_ms;
+	state _current_state;
+};
+
+} // namespace nsec::power
+
+#endif // NSEC_POWER_MANAGER_HPP
@@ -0,0 +1,96 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_EVENT_BUS_HPP
+#define NSEC_EVENT_BUS_HPP
+
+#include <fifo.hpp>
+
+#include <stdint.h>
+
+namespace nsec {
+
+/*
+ * Fixed-capacity queue of events with per-event priorities.
+ *
+ * EventType must provide `uint8_t priority() const noexcept`, in [0, PriorityCount[,
+ * 0 being the highest priority. Events are dispatched by decreasing priority and, for
+ * a given priority, in the order in which they were posted.
+ *
+ * Each priority has its own queue so that a burst of low priority events can't
+ * prevent higher priority events from being posted.
+ */
+template <class EventType, uint8_t CapacityPerPriority, uint8_t PriorityCount>
+class event_bus {
+public:
+	event_bus() noexcept = default;
+
+	/* Deactivate copy and assignment. */
+	event_bus(const event_bus&) = delete;
+	event_bus(event_bus&&) = delete;
+	event_bus& operator=(const event_bus&) = delete;
+	event_bus& operator=(event_bus&&) = delete;
+	~event_bus() = default;
+
+	// Returns false, leaving the bus untouched, when the event's queue is full.
+	bool post(const EventType& event) noexcept
+	{
+		return _queues[event.priority()].push(event);
+	}
+
+	/*
+	 * Invoke `handler` on, at most, `max_event_count` events. Handlers may post new
+	 * events. Returns the number of events dispatched.
+	 */
+	template <class HandlerType>
+	uint8_t dispatch(HandlerType& handler, uint8_t max_event_count) noexcept
+	{
+		EventType event;
+		uint8_t dispatched_event_count = 0;
+
+		while (dispatched_event_count < max_event_count && _pop(event)) {
+			handler(event);
+			dispatched_event_count++;
+		}
+
+		return dispatched_event_count;
+	}
+
+	// Number of events of a given priority that can be posted before its queue is full.
+	uint8_t available(uint8_t priority) const noexcept
+	{
+		return CapacityPerPriority - _queues[priority].size();
+	}
+
+	bool empty() const noexcept
+	{
+		for (const auto& queue : _queues) {
+			if (!queue.empty()) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+private:
+	bool _pop(EventType& event) noexcept
+	{
+		for (auto& queue : _queues) {
+			if (queue.pop(event)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	fifo<EventType, CapacityPerPriority> _queues[PriorityCount];
+};
+
+} // namespace nsec
+
+#endif // NSEC_EVENT_BUS_HPP
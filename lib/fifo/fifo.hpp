@@ -0,0 +1,99 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_FIFO_HPP
+#define NSEC_FIFO_HPP
+
+#include <stdint.h>
+
+namespace nsec {
+
+/*
+ * Fixed-capacity first-in first-out queue.
+ *
+ * The read and write positions are free-running 8-bit counters: their difference is
+ * the element count and they are masked to index the storage, hence the power of two
+ * capacity. Meant to be used from a single execution context (no interrupts).
+ */
+template <class ElementType, uint8_t Capacity>
+class fifo {
+	static_assert(Capacity > 0 && Capacity <= 128 && (Capacity & (Capacity - 1)) == 0,
+		      "Capacity must be a power of two no greater than 128");
+
+public:
+	fifo() noexcept = default;
+
+	/* Deactivate copy and assignment. */
+	fifo(const fifo&) = delete;
+	fifo(fifo&&) = delete;
+	fifo& operator=(const fifo&) = delete;
+	fifo& operator=(fifo&&) = delete;
+	~fifo() = default;
+
+	// Returns false, leaving the queue untouched, when it is full.
+	bool push(const ElementType& element) noexcept
+	{
+		if (full()) {
+			return false;
+		}
+
+		_elements[_write_position++ & index_mask] = element;
+		return true;
+	}
+
+	// Returns false when the queue is empty.
+	bool pop(ElementType& element) noexcept
+	{
+		if (empty()) {
+			return false;
+		}
+
+		element = _elements[_read_position++ & index_mask];
+		return true;
+	}
+
+	// Oldest element, left in the queue. The queue must not be empty.
+	const ElementType& front() const noexcept
+	{
+		return _elements[_read_position & index_mask];
+	}
+
+	void clear() noexcept
+	{
+		_read_position = _write_position;
+	}
+
+	uint8_t size() const noexcept
+	{
+		return _write_position - _read_position;
+	}
+
+	bool empty() const noexcept
+	{
+		return _write_position == _read_position;
+	}
+
+	bool full() const noexcept
+	{
+		return size() == Capacity;
+	}
+
+	static constexpr uint8_t capacity() noexcept
+	{
+		return Capacity;
+	}
+
+private:
+	static constexpr uint8_t index_mask = Capacity - 1;
+
+	ElementType _elements[Capacity];
+	uint8_t _read_position = 0;
+	uint8_t _write_position = 0;
+};
+
+} // namespace nsec
+
+#endif // NSEC_FIFO_HPP
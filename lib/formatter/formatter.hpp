@@ -0,0 +1,215 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_FORMATTER_HPP
+#define NSEC_FORMATTER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+namespace nsec {
+
+/*
+ * Format text into a fixed-size buffer, which always holds a null-terminated string.
+ *
+ * Text that doesn't fit is dropped (and the formatter reports it as truncated) rather than
+ * written past the end of the buffer. Unlike Print, there is no virtual call per character
+ * and numbers are converted without divisions when they fit in 16 bits, which the AVR
+ * lacks an instruction for.
+ */
+class formatter {
+public:
+	template <size_t Size>
+	explicit formatter(char (&buffer)[Size]) noexcept : formatter(buffer, Size)
+	{
+		static_assert(Size > 0 && Size <= UINT8_MAX, "Buffer size must be in [1, 255]");
+	}
+
+	formatter(char *buffer, uint8_t size) noexcept :
+		_buffer{ buffer }, _size{ size }, _length{ 0 }, _is_truncated{ false }
+	{
+		_buffer[0] = '\0';
+	}
+
+	/* Deactivate copy and assignment. */
+	formatter(const formatter&) = delete;
+	formatter(formatter&&) = delete;
+	formatter& operator=(const formatter&) = delete;
+	formatter& operator=(formatter&&) = delete;
+	~formatter() = default;
+
+	formatter& append(char c) noexcept
+	{
+		// Keep room for the terminator.
+		if (_length + 1 < _size) {
+			_buffer[_length++] = c;
+			_buffer[_length] = '\0';
+		} else {
+			_is_truncated = true;
+		}
+
+		return *this;
+	}
+
+	formatter& append(const char *str) noexcept
+	{
+		while (*str && !_is_truncated) {
+			append(*str++);
+		}
+
+		return *this;
+	}
+
+	// Append a string stored in program memory.
+	formatter& append_P(const char *str) noexcept
+	{
+		for (char c = _read_program_memory(str); c && !_is_truncated;
+		     c = _read_program_memory(++str)) {
+			append(c);
+		}
+
+		return *this;
+	}
+
+#ifdef ARDUINO
+	formatter& append(const __FlashStringHelper *str) noexcept
+	{
+		return append_P(reinterpret_cast<const char *>(str));
+	}
+#endif
+
+	formatter& decimal(uint16_t value) noexcept
+	{
+		bool is_leading_zero = true;
+
+		_decimal_digit(value, 10000, is_leading_zero);
+		_decimal_digit(value, 1000, is_leading_zero);
+		_decimal_digit(value, 100, is_leading_zero);
+		_decimal_digit(value, 10, is_leading_zero);
+		return append(char('0' + value));
+	}
+
+	formatter& decimal(int16_t value) noexcept
+	{
+		if (value < 0) {
+			append('-');
+		}
+
+		return decimal(uint16_t(value < 0 ? 0U - uint16_t(value) : uint16_t(value)));
+	}
+
+	formatter& decimal(uint32_t value) noexcept
+	{
+		if (value <= UINT16_MAX) {
+			return decimal(uint16_t(value));
+		}
+
+		// Less common: the slower 32-bit divisions are acceptable.
+		char digits[10] = {};
+		uint8_t digit_count = 0;
+
+		do {
+			digits[digit_count++] = char('0' + value % 10);
+			value /= 10;
+		} while (value);
+
+		while (digit_count) {
+			append(digits[--digit_count]);
+		}
+
+		return *this;
+	}
+
+	formatter& decimal(int32_t value) noexcept
+	{
+		if (value < 0) {
+			append('-');
+		}
+
+		return decimal(uint32_t(value < 0 ? 0UL - uint32_t(value) : uint32_t(value)));
+	}
+
+	// Upper case, padded with zeros to at least min_digit_count digits.
+	formatter& hex(uint16_t value, uint8_t min_digit_count = 1) noexcept
+	{
+		bool is_leading_zero = true;
+
+		for (uint8_t digit = 4; digit > 0; digit--) {
+			const uint8_t nibble = uint8_t(value >> ((digit - 1) * 4)) & 0xF;
+
+			if (nibble == 0 && is_leading_zero && digit > min_digit_count && digit > 1) {
+				continue;
+			}
+
+			is_leading_zero = false;
+			append(char(nibble < 10 ? '0' + nibble : 'A' + nibble - 10));
+		}
+
+		return *this;
+	}
+
+	void clear() noexcept
+	{
+		_length = 0;
+		_is_truncated = false;
+		_buffer[0] = '\0';
+	}
+
+	constexpr const char *c_str() const noexcept
+	{
+		return _buffer;
+	}
+
+	// Excluding the terminator.
+	constexpr uint8_t length() const noexcept
+	{
+		return _length;
+	}
+
+	constexpr bool truncated() const noexcept
+	{
+		return _is_truncated;
+	}
+
+private:
+	void _decimal_digit(uint16_t& value, uint16_t power, bool& is_leading_zero) noexcept
+	{
+		char digit = '0';
+
+		while (value >= power) {
+			value -= power;
+			digit++;
+		}
+
+		if (digit != '0' || !is_leading_zero) {
+			is_leading_zero = false;
+			append(digit);
+		}
+	}
+
+	static char _read_program_memory(const char *address) noexcept
+	{
+#ifdef ARDUINO
+		return char(pgm_read_byte(address));
+#else
+		// Program memory is regular memory off the badge.
+		return *address;
+#endif
+	}
+
+	char *const _buffer;
+	const uint8_t _size;
+	uint8_t _length;
+	bool _is_truncated;
+};
+
+} // namespace nsec
+
+#endif // NSEC_FORMATTER_HPP
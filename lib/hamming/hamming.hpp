@@ -0,0 +1,97 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HAMMING_HPP
+#define NSEC_HAMMING_HPP
+
+#include <stdint.h>
+
+/*
+ * Extended Hamming (8,4) code: each nibble is sent as an 8-bit codeword, which corrects any
+ * single-bit error and detects (without correcting) double-bit errors.
+ *
+ * Bit i of a codeword holds position i + 1 of the classic Hamming (7,4) layout: the parity
+ * bits are at positions 1, 2 and 4, the data bits at 3, 5, 6 and 7. Bit 7 is the parity of
+ * the whole codeword. Decoding computes the syndrome, which is the position of a single
+ * flipped bit, rather than looking the codeword up in a table.
+ */
+namespace nsec::hamming {
+
+// Ordered by severity.
+enum class decode_result : uint8_t {
+	VALID,
+	// A single bit was flipped, the nibble is the one that was encoded.
+	CORRECTED,
+	// At least two bits were flipped.
+	UNCORRECTABLE,
+};
+
+namespace details {
+// Xor the bits shifted by shift onto the lower ones.
+constexpr uint8_t fold(uint8_t value, uint8_t shift) noexcept
+{
+	return value ^ (value >> shift);
+}
+
+constexpr uint8_t parity(uint8_t value) noexcept
+{
+	return fold(fold(fold(value, 4), 2), 1) & 1;
+}
+
+// Bits covered by each parity bit, including itself.
+constexpr uint8_t parity_1_mask = 0b01010101;
+constexpr uint8_t parity_2_mask = 0b01100110;
+constexpr uint8_t parity_4_mask = 0b01111000;
+
+constexpr uint8_t data_bits(uint8_t nibble) noexcept
+{
+	return ((nibble & 0b0001) << 2) | ((nibble & 0b1110) << 3);
+}
+
+// Data bits with the parity bits at positions 1, 2 and 4 set.
+constexpr uint8_t with_parity_bits(uint8_t data_bits) noexcept
+{
+	return data_bits | parity(data_bits & parity_1_mask) |
+		(parity(data_bits & parity_2_mask) << 1) | (parity(data_bits & parity_4_mask) << 3);
+}
+
+constexpr uint8_t with_overall_parity_bit(uint8_t codeword) noexcept
+{
+	return codeword | (parity(codeword) << 7);
+}
+} // namespace details
+
+constexpr uint8_t encode(uint8_t nibble) noexcept
+{
+	return details::with_overall_parity_bit(
+		details::with_parity_bits(details::data_bits(nibble)));
+}
+
+inline decode_result decode(uint8_t codeword, uint8_t& nibble) noexcept
+{
+	const uint8_t syndrome = details::parity(codeword & details::parity_1_mask) |
+		(details::parity(codeword & details::parity_2_mask) << 1) |
+		(details::parity(codeword & details::parity_4_mask) << 2);
+	auto result = decode_result::VALID;
+
+	if (details::parity(codeword)) {
+		// An odd number of flipped bits: assume one, which a null syndrome puts on bit 7.
+		if (syndrome) {
+			codeword ^= 1 << (syndrome - 1);
+		}
+
+		result = decode_result::CORRECTED;
+	} else if (syndrome) {
+		return decode_result::UNCORRECTABLE;
+	}
+
+	nibble = ((codeword >> 2) & 0b0001) | ((codeword >> 3) & 0b1110);
+	return result;
+}
+
+} // namespace nsec::hamming
+
+#endif // NSEC_HAMMING_HPP
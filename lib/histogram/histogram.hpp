@@ -0,0 +1,94 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HISTOGRAM_HPP
+#define NSEC_HISTOGRAM_HPP
+
+#include <stdint.h>
+
+namespace nsec {
+
+/*
+ * Histogram of durations, in BucketCount buckets of BucketWidth ms and a last bucket
+ * holding the durations past the histogram's range. The maximal duration is kept to
+ * bound the percentiles.
+ *
+ * Zero-initialized objects are empty, like cleared ones.
+ */
+template <uint16_t BucketWidth, uint8_t BucketCount>
+class histogram {
+public:
+	static constexpr uint16_t bucket_width = BucketWidth;
+	static constexpr uint8_t bucket_count = BucketCount;
+
+	void record(unsigned long duration_ms) noexcept
+	{
+		const auto bucket = duration_ms / bucket_width;
+
+		_bucket_sample_count[bucket < bucket_count ? bucket : bucket_count]++;
+		_sample_count++;
+		if (duration_ms > _max_ms) {
+			_max_ms = duration_ms < UINT16_MAX ? duration_ms : UINT16_MAX;
+		}
+	}
+
+	/*
+	 * Upper bound of the bucket holding the percentile, capped to the maximal
+	 * duration (which also covers the percentiles past the last bucket).
+	 */
+	uint16_t percentile_ms(uint8_t percentile) const noexcept
+	{
+		const uint32_t rank = (uint32_t(_sample_count) * percentile + 99) / 100;
+		uint32_t cumulative_sample_count = 0;
+
+		for (uint8_t i = 0; i < bucket_count; i++) {
+			cumulative_sample_count += _bucket_sample_count[i];
+			if (cumulative_sample_count >= rank) {
+				const uint16_t bucket_upper_bound_ms = (i + 1) * bucket_width - 1;
+
+				return bucket_upper_bound_ms < _max_ms ? bucket_upper_bound_ms :
+									 _max_ms;
+			}
+		}
+
+		return _max_ms;
+	}
+
+	// The last bucket holds the durations past the histogram's range.
+	uint16_t bucket_sample_count(uint8_t bucket) const noexcept
+	{
+		return _bucket_sample_count[bucket];
+	}
+
+	uint16_t sample_count() const noexcept
+	{
+		return _sample_count;
+	}
+
+	uint16_t max_ms() const noexcept
+	{
+		return _max_ms;
+	}
+
+	void clear() noexcept
+	{
+		for (auto& count : _bucket_sample_count) {
+			count = 0;
+		}
+
+		_sample_count = 0;
+		_max_ms = 0;
+	}
+
+private:
+	uint16_t _bucket_sample_count[bucket_count + 1];
+	uint16_t _sample_count;
+	uint16_t _max_ms;
+};
+
+} // namespace nsec
+
+#endif // NSEC_HISTOGRAM_HPP
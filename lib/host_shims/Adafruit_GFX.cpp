@@ -0,0 +1,237 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "Adafruit_GFX.h"
+
+namespace {
+/*
+ * Column `column` (0 to 4) of a character, least significant bit at the top. The bottom
+ * row is left blank, as in most of upstream's glyphs.
+ */
+uint8_t glyph_column(unsigned char c, uint8_t column) noexcept
+{
+	if (c == ' ') {
+		return 0;
+	}
+
+	return uint8_t((c * 37U + column * 91U) ^ (c >> (column % 4))) & 0x7F;
+}
+} // namespace
+
+Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h) :
+	WIDTH{ w },
+	HEIGHT{ h },
+	_width{ w },
+	_height{ h },
+	cursor_x{ 0 },
+	cursor_y{ 0 },
+	textcolor{ 0xFFFF },
+	textbgcolor{ 0xFFFF },
+	textsize_x{ 1 },
+	textsize_y{ 1 },
+	rotation{ 0 },
+	wrap{ true },
+	_cp437{ false }
+{
+}
+
+void Adafruit_GFX::startWrite()
+{
+}
+
+void Adafruit_GFX::writePixel(int16_t x, int16_t y, uint16_t color)
+{
+	drawPixel(x, y, color);
+}
+
+void Adafruit_GFX::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+	fillRect(x, y, w, h, color);
+}
+
+void Adafruit_GFX::writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+{
+	drawFastVLine(x, y, h, color);
+}
+
+void Adafruit_GFX::writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+{
+	drawFastHLine(x, y, w, color);
+}
+
+void Adafruit_GFX::endWrite()
+{
+}
+
+void Adafruit_GFX::setRotation(uint8_t r)
+{
+	rotation = r & 3;
+	_width = rotation & 1 ? HEIGHT : WIDTH;
+	_height = rotation & 1 ? WIDTH : HEIGHT;
+}
+
+void Adafruit_GFX::invertDisplay(bool)
+{
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+{
+	startWrite();
+	for (int16_t i = 0; i < h; i++) {
+		writePixel(x, y + i, color);
+	}
+
+	endWrite();
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+{
+	startWrite();
+	for (int16_t i = 0; i < w; i++) {
+		writePixel(x + i, y, color);
+	}
+
+	endWrite();
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+	startWrite();
+	for (int16_t i = x; i < x + w; i++) {
+		writeFastVLine(i, y, h, color);
+	}
+
+	endWrite();
+}
+
+void Adafruit_GFX::fillScreen(uint16_t color)
+{
+	fillRect(0, 0, _width, _height, color);
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+	startWrite();
+	writeFastHLine(x, y, w, color);
+	writeFastHLine(x, y + h - 1, w, color);
+	writeFastVLine(x, y, h, color);
+	writeFastVLine(x + w - 1, y, h, color);
+	endWrite();
+}
+
+void Adafruit_GFX::drawBitmap(
+	int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color)
+{
+	const int16_t byte_width = (w + 7) / 8;
+	uint8_t byte = 0;
+
+	startWrite();
+	for (int16_t j = 0; j < h; j++, y++) {
+		for (int16_t i = 0; i < w; i++) {
+			if (i & 7) {
+				byte <<= 1;
+			} else {
+				byte = pgm_read_byte(&bitmap[j * byte_width + i / 8]);
+			}
+
+			if (byte & 0x80) {
+				writePixel(x + i, y, color);
+			}
+		}
+	}
+
+	endWrite();
+}
+
+void Adafruit_GFX::drawChar(
+	int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size)
+{
+	drawChar(x, y, c, color, bg, size, size);
+}
+
+void Adafruit_GFX::drawChar(int16_t x,
+			    int16_t y,
+			    unsigned char c,
+			    uint16_t color,
+			    uint16_t bg,
+			    uint8_t size_x,
+			    uint8_t size_y)
+{
+	if (x >= _width || y >= _height || x + 6 * size_x - 1 < 0 || y + 8 * size_y - 1 < 0) {
+		return;
+	}
+
+	// Upstream's compatibility quirk of the classic font.
+	if (!_cp437 && c >= 176) {
+		c++;
+	}
+
+	startWrite();
+	for (uint8_t i = 0; i < 5; i++) {
+		uint8_t line = glyph_column(c, i);
+
+		for (uint8_t j = 0; j < 8; j++, line >>= 1) {
+			if (line & 1) {
+				if (size_x == 1 && size_y == 1) {
+					writePixel(x + i, y + j, color);
+				} else {
+					writeFillRect(x + i * size_x,
+						      y + j * size_y,
+						      size_x,
+						      size_y,
+						      color);
+				}
+			} else if (bg != color) {
+				if (size_x == 1 && size_y == 1) {
+					writePixel(x + i, y + j, bg);
+				} else {
+					writeFillRect(
+						x + i * size_x, y + j * size_y, size_x, size_y, bg);
+				}
+			}
+		}
+	}
+
+	// Spacing column.
+	if (bg != color) {
+		if (size_x == 1 && size_y == 1) {
+			writeFastVLine(x + 5, y, 8, bg);
+		} else {
+			writeFillRect(x + 5 * size_x, y, size_x, 8 * size_y, bg);
+		}
+	}
+
+	endWrite();
+}
+
+void Adafruit_GFX::setTextSize(uint8_t s)
+{
+	setTextSize(s, s);
+}
+
+void Adafruit_GFX::setTextSize(uint8_t sx, uint8_t sy)
+{
+	textsize_x = sx > 0 ? sx : 1;
+	textsize_y = sy > 0 ? sy : 1;
+}
+
+size_t Adafruit_GFX::write(uint8_t c)
+{
+	if (c == '\n') {
+		cursor_x = 0;
+		cursor_y += textsize_y * 8;
+	} else if (c != '\r') {
+		if (wrap && cursor_x + textsize_x * 6 > _width) {
+			cursor_x = 0;
+			cursor_y += textsize_y * 8;
+		}
+
+		drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize_x, textsize_y);
+		cursor_x += textsize_x * 6;
+	}
+
+	return 1;
+}
@@ -0,0 +1,140 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_ADAFRUIT_GFX_H
+#define NSEC_HOST_SHIMS_ADAFRUIT_GFX_H
+
+/*
+ * Host stand-in for the subset of the Adafruit GFX library used by the badge and its
+ * SSD1306 driver (built-in font only). Drawing goes through the same primitives as
+ * upstream so that the pixel operations per call match.
+ *
+ * Upstream's font isn't part of this tree: glyphs are arbitrary patterns of the same
+ * size, so text layout is exact but the rendered characters are not.
+ */
+
+#include "Arduino.h"
+
+#include <stdint.h>
+
+class Adafruit_GFX : public Print {
+public:
+	Adafruit_GFX(int16_t w, int16_t h);
+
+	virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+	virtual void startWrite();
+	virtual void writePixel(int16_t x, int16_t y, uint16_t color);
+	virtual void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+	virtual void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+	virtual void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+	virtual void endWrite();
+
+	virtual void setRotation(uint8_t r);
+	virtual void invertDisplay(bool i);
+
+	virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+	virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+	virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+	virtual void fillScreen(uint16_t color);
+	void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+	void drawBitmap(int16_t x,
+			int16_t y,
+			const uint8_t *bitmap,
+			int16_t w,
+			int16_t h,
+			uint16_t color);
+	void drawChar(int16_t x,
+		      int16_t y,
+		      unsigned char c,
+		      uint16_t color,
+		      uint16_t bg,
+		      uint8_t size);
+	void drawChar(int16_t x,
+		      int16_t y,
+		      unsigned char c,
+		      uint16_t color,
+		      uint16_t bg,
+		      uint8_t size_x,
+		      uint8_t size_y);
+
+	void setCursor(int16_t x, int16_t y)
+	{
+		cursor_x = x;
+		cursor_y = y;
+	}
+
+	void setTextSize(uint8_t s);
+	void setTextSize(uint8_t sx, uint8_t sy);
+
+	// Transparent background.
+	void setTextColor(uint16_t c)
+	{
+		textcolor = textbgcolor = c;
+	}
+
+	void setTextColor(uint16_t c, uint16_t bg)
+	{
+		textcolor = c;
+		textbgcolor = bg;
+	}
+
+	void setTextWrap(bool w)
+	{
+		wrap = w;
+	}
+
+	void cp437(bool x = true)
+	{
+		_cp437 = x;
+	}
+
+	size_t write(uint8_t) override;
+	using Print::write;
+
+	int16_t width() const
+	{
+		return _width;
+	}
+
+	int16_t height() const
+	{
+		return _height;
+	}
+
+	uint8_t getRotation() const
+	{
+		return rotation;
+	}
+
+	int16_t getCursorX() const
+	{
+		return cursor_x;
+	}
+
+	int16_t getCursorY() const
+	{
+		return cursor_y;
+	}
+
+protected:
+	int16_t WIDTH;
+	int16_t HEIGHT;
+	int16_t _width;
+	int16_t _height;
+	int16_t cursor_x;
+	int16_t cursor_y;
+	uint16_t textcolor;
+	uint16_t textbgcolor;
+	uint8_t textsize_x;
+	uint8_t textsize_y;
+	uint8_t rotation;
+	bool wrap;
+	bool _cp437;
+};
+
+#endif // NSEC_HOST_SHIMS_ADAFRUIT_GFX_H
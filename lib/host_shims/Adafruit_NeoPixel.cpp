@@ -0,0 +1,169 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "Adafruit_NeoPixel.h"
+
+#include <math.h>
+
+namespace {
+Adafruit_NeoPixel::show_observer the_show_observer;
+
+struct gamma_table {
+	gamma_table() noexcept
+	{
+		// Upstream's table is generated with a gamma of 2.6.
+		for (unsigned int i = 0; i < 256; i++) {
+			values[i] = uint8_t(pow(double(i) / 255.0, 2.6) * 255.0 + 0.5);
+		}
+	}
+
+	uint8_t values[256];
+};
+} // namespace
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, int16_t pin [[maybe_unused]], neoPixelType type) :
+	_pixel_count{ n },
+	_byte_count{ uint16_t(n * 3) },
+	_pixels{ new uint8_t[n * 3]() },
+	_brightness{ 0 },
+	_r_offset{ uint8_t((type >> 4) & 0b11) },
+	_g_offset{ uint8_t((type >> 2) & 0b11) },
+	_b_offset{ uint8_t(type & 0b11) },
+	_is_800khz{ (type & NEO_KHZ400) == 0 },
+	_show_count{ 0 },
+	_set_pixel_color_count{ 0 }
+{
+}
+
+Adafruit_NeoPixel::~Adafruit_NeoPixel()
+{
+	delete[] _pixels;
+}
+
+void Adafruit_NeoPixel::begin()
+{
+}
+
+void Adafruit_NeoPixel::show()
+{
+	_show_count++;
+	if (the_show_observer) {
+		the_show_observer(*this);
+	}
+}
+
+void Adafruit_NeoPixel::clear()
+{
+	memset(_pixels, 0, _byte_count);
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+{
+	_set_pixel_color_count++;
+	if (n >= _pixel_count) {
+		return;
+	}
+
+	if (_brightness) {
+		// See notes in setBrightness().
+		r = (r * _brightness) >> 8;
+		g = (g * _brightness) >> 8;
+		b = (b * _brightness) >> 8;
+	}
+
+	uint8_t *p = &_pixels[n * 3];
+	p[_r_offset] = r;
+	p[_g_offset] = g;
+	p[_b_offset] = b;
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c)
+{
+	setPixelColor(n, uint8_t(c >> 16), uint8_t(c >> 8), uint8_t(c));
+}
+
+/*
+ * Brightness is stored off by one (0 meaning "full") and applied when colors are set. Changing
+ * it rescales the colors already stored, which is lossy; this mirrors upstream exactly.
+ */
+void Adafruit_NeoPixel::setBrightness(uint8_t brightness)
+{
+	const uint8_t new_brightness = brightness + 1;
+
+	if (new_brightness == _brightness) {
+		return;
+	}
+
+	const uint8_t old_brightness = _brightness - 1;
+	uint16_t scale;
+
+	if (old_brightness == 0) {
+		scale = 0;
+	} else if (brightness == 255) {
+		scale = 65535 / old_brightness;
+	} else {
+		scale = ((uint16_t(new_brightness) << 8) - 1) / old_brightness;
+	}
+
+	for (uint16_t i = 0; i < _byte_count; i++) {
+		_pixels[i] = (_pixels[i] * scale) >> 8;
+	}
+
+	_brightness = new_brightness;
+}
+
+uint8_t Adafruit_NeoPixel::getBrightness() const
+{
+	return _brightness - 1;
+}
+
+uint8_t *Adafruit_NeoPixel::getPixels() const
+{
+	return _pixels;
+}
+
+uint16_t Adafruit_NeoPixel::numPixels() const
+{
+	return _pixel_count;
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const
+{
+	if (n >= _pixel_count) {
+		return 0;
+	}
+
+	const uint8_t *p = &_pixels[n * 3];
+	return Color(p[_r_offset], p[_g_offset], p[_b_offset]);
+}
+
+uint8_t Adafruit_NeoPixel::gamma8(uint8_t x)
+{
+	static const gamma_table table;
+
+	return table.values[x];
+}
+
+void Adafruit_NeoPixel::set_show_observer(show_observer observer)
+{
+	the_show_observer = observer;
+}
+
+unsigned long Adafruit_NeoPixel::show_duration_us() const
+{
+	// 24 bits per pixel at 1.25 µs (800 kHz) or 2.5 µs (400 kHz) per bit.
+	return (_pixel_count * 24UL * (_is_800khz ? 125 : 250)) / 100;
+}
+
+unsigned long Adafruit_NeoPixel::show_count() const
+{
+	return _show_count;
+}
+
+unsigned long Adafruit_NeoPixel::set_pixel_color_count() const
+{
+	return _set_pixel_color_count;
+}
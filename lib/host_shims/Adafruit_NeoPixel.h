@@ -0,0 +1,84 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_ADAFRUIT_NEOPIXEL_H
+#define NSEC_HOST_SHIMS_ADAFRUIT_NEOPIXEL_H
+
+/*
+ * Host stand-in for the Adafruit NeoPixel library. Pixel storage, brightness scaling and
+ * gamma correction follow the upstream implementation so that the values "sent" by show()
+ * match what the badge would put on the wire.
+ */
+
+#include "Arduino.h"
+
+#include <stdint.h>
+
+// RGB NeoPixel permutations; white and red offsets are always the same (see upstream).
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_RBG ((0 << 6) | (0 << 4) | (2 << 2) | (1))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_GBR ((2 << 6) | (2 << 4) | (0 << 2) | (1))
+#define NEO_BRG ((1 << 6) | (1 << 4) | (2 << 2) | (0))
+#define NEO_BGR ((2 << 6) | (2 << 4) | (1 << 2) | (0))
+
+#define NEO_KHZ800 0x0000
+#define NEO_KHZ400 0x0100
+
+using neoPixelType = uint16_t;
+
+class Adafruit_NeoPixel {
+public:
+	using show_observer = void (*)(const Adafruit_NeoPixel&);
+
+	Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800);
+	~Adafruit_NeoPixel();
+
+	Adafruit_NeoPixel(const Adafruit_NeoPixel&) = delete;
+	Adafruit_NeoPixel& operator=(const Adafruit_NeoPixel&) = delete;
+
+	void begin();
+	void show();
+	void clear();
+
+	void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+	void setPixelColor(uint16_t n, uint32_t c);
+	void setBrightness(uint8_t brightness);
+
+	uint8_t getBrightness() const;
+	uint8_t *getPixels() const;
+	uint16_t numPixels() const;
+	uint32_t getPixelColor(uint16_t n) const;
+
+	static uint32_t Color(uint8_t r, uint8_t g, uint8_t b)
+	{
+		return (uint32_t(r) << 16) | (uint32_t(g) << 8) | b;
+	}
+
+	static uint8_t gamma8(uint8_t x);
+
+	/* Host-only extensions. */
+
+	// Invoked with the strip's state every time show() is called.
+	static void set_show_observer(show_observer observer);
+	// Time spent sending a frame on the wire, with interrupts disabled, on the badge.
+	unsigned long show_duration_us() const;
+	unsigned long show_count() const;
+	unsigned long set_pixel_color_count() const;
+
+private:
+	uint16_t _pixel_count;
+	uint16_t _byte_count;
+	uint8_t *_pixels;
+	uint8_t _brightness;
+	uint8_t _r_offset, _g_offset, _b_offset;
+	bool _is_800khz;
+
+	unsigned long _show_count;
+	unsigned long _set_pixel_color_count;
+};
+
+#endif // NSEC_HOST_SHIMS_ADAFRUIT_NEOPIXEL_H
@@ -0,0 +1,215 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "Arduino.h"
+#include "avr/sleep.h"
+#include "host_clock.hpp"
+#include "host_pins.hpp"
+
+volatile uint8_t PINB, PINC, PIND, PINE;
+volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2, PCMSK3;
+volatile uint8_t ADCSRA;
+volatile uint8_t MCUSR = _BV(PORF);
+
+namespace {
+unsigned long long current_time_us;
+int current_sleep_mode = SLEEP_MODE_IDLE;
+nsec::host::power_down_observer current_power_down_observer;
+
+// Zero-initialized so that pins can be configured from the constructors of globals.
+enum class drive : uint8_t { NONE, LOW_LEVEL, HIGH_LEVEL };
+
+struct pin_state {
+	uint8_t mode;
+	// Output level, or pull-up enabled when the pin is an input (PORTx bit).
+	bool port_bit;
+	drive driven_level;
+};
+
+pin_state pins[NUM_DIGITAL_PINS];
+
+struct pin_location {
+	volatile uint8_t *input_register;
+	uint8_t bit;
+	// Pin change interrupt group (PCIFn and PCMSKn).
+	uint8_t pin_change_group;
+};
+
+pin_location locate(uint8_t pin) noexcept
+{
+	if (pin < 8) {
+		return { &PIND, pin, 2 };
+	} else if (pin < 14) {
+		return { &PINB, uint8_t(pin - 8), 0 };
+	} else if (pin < 20) {
+		return { &PINC, uint8_t(pin - 14), 1 };
+	} else {
+		// A6 and A7 are PE2 and PE3, followed by PE0 and PE1.
+		static const uint8_t port_e_bits[] = { 2, 3, 0, 1 };
+
+		return { &PINE, port_e_bits[pin - 20], 3 };
+	}
+}
+
+bool level(uint8_t pin) noexcept
+{
+	const auto& state = pins[pin];
+
+	if (state.mode == OUTPUT) {
+		return state.port_bit;
+	}
+
+	if (state.driven_level != drive::NONE) {
+		return state.driven_level == drive::HIGH_LEVEL;
+	}
+
+	return state.port_bit;
+}
+
+void update_input_register(uint8_t pin) noexcept
+{
+	static volatile uint8_t *const pin_change_masks[] = { &PCMSK0, &PCMSK1, &PCMSK2, &PCMSK3 };
+	const auto location = locate(pin);
+	const uint8_t previous_value = *location.input_register;
+
+	if (level(pin)) {
+		*location.input_register |= _BV(location.bit);
+	} else {
+		*location.input_register &= ~_BV(location.bit);
+	}
+
+	// Edges are latched in PCIFR even when the pin change interrupts are disabled.
+	if ((previous_value ^ *location.input_register) &
+	    *pin_change_masks[location.pin_change_group] & _BV(location.bit)) {
+		PCIFR |= _BV(location.pin_change_group);
+	}
+}
+} // namespace
+
+void nsec::host::set_time_us(unsigned long long time_us) noexcept
+{
+	current_time_us = time_us;
+}
+
+unsigned long long nsec::host::time_us() noexcept
+{
+	return current_time_us;
+}
+
+void nsec::host::drive_pin(uint8_t pin, bool level) noexcept
+{
+	if (pin >= NUM_DIGITAL_PINS) {
+		return;
+	}
+
+	pins[pin].driven_level = level ? drive::HIGH_LEVEL : drive::LOW_LEVEL;
+	update_input_register(pin);
+}
+
+void nsec::host::release_pin(uint8_t pin) noexcept
+{
+	if (pin >= NUM_DIGITAL_PINS) {
+		return;
+	}
+
+	pins[pin].driven_level = drive::NONE;
+	update_input_register(pin);
+}
+
+bool nsec::host::pin_level(uint8_t pin) noexcept
+{
+	return pin < NUM_DIGITAL_PINS && level(pin);
+}
+
+void nsec::host::set_power_down_observer(power_down_observer observer) noexcept
+{
+	current_power_down_observer = observer;
+}
+
+void nsec::host::details::set_sleep_mode(int mode) noexcept
+{
+	current_sleep_mode = mode;
+}
+
+void nsec::host::details::sleep_cpu() noexcept
+{
+	if (current_sleep_mode == SLEEP_MODE_PWR_DOWN && current_power_down_observer) {
+		current_power_down_observer();
+	}
+}
+
+/* Both wrap around like their AVR counterparts. */
+unsigned long millis()
+{
+	return static_cast<unsigned long>(uint32_t(current_time_us / 1000));
+}
+
+unsigned long micros()
+{
+	return static_cast<unsigned long>(uint32_t(current_time_us));
+}
+
+void delay(unsigned long ms)
+{
+	current_time_us += static_cast<unsigned long long>(ms) * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	current_time_us += us;
+}
+
+void yield()
+{
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	if (pin >= NUM_DIGITAL_PINS) {
+		return;
+	}
+
+	pins[pin].mode = mode == OUTPUT ? OUTPUT : INPUT;
+	if (mode != OUTPUT) {
+		pins[pin].port_bit = mode == INPUT_PULLUP;
+	}
+
+	update_input_register(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+	if (pin >= NUM_DIGITAL_PINS) {
+		return;
+	}
+
+	// Enables the pull-up of an input, as on the badge.
+	pins[pin].port_bit = value != LOW;
+	update_input_register(pin);
+}
+
+int digitalRead(uint8_t pin)
+{
+	return nsec::host::pin_level(pin) ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+	// Channel numbers are accepted too.
+	if (pin < A0) {
+		pin += A0;
+	}
+
+	return nsec::host::pin_level(pin) ? 1023 : 0;
+}
+
+void interrupts()
+{
+}
+
+void noInterrupts()
+{
+}
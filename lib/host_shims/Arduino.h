@@ -0,0 +1,126 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_ARDUINO_H
+#define NSEC_HOST_SHIMS_ARDUINO_H
+
+/*
+ * Subset of the Arduino core (MiniCore, ATmega328PB) used by the firmware, so that it can
+ * be built on the development host. Time is virtual and only advances when the host
+ * program says so (see host_clock.hpp), or when a blocking transfer would take time on the
+ * badge. Pins are driven by the host program (see host_pins.hpp).
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+#include <type_traits>
+#endif
+
+/* Program memory is regular memory on the host. */
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(str) (str)
+// Some libraries define their own fallback.
+#ifndef pgm_read_byte
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t *>(addr))
+#endif
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t *>(addr))
+#define pgm_read_dword(addr) (*reinterpret_cast<const uint32_t *>(addr))
+#define pgm_read_ptr(addr) (*reinterpret_cast<const void *const *>(addr))
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strlen_P strlen
+
+class __FlashStringHelper;
+#define F(str) (reinterpret_cast<const __FlashStringHelper *>(PSTR(str)))
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+/* MiniCore's pin numbering of the ATmega328PB. */
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define NUM_DIGITAL_PINS 24
+
+#define _BV(bit) (1 << (bit))
+
+using byte = uint8_t;
+using boolean = bool;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+// Full scale (1023) for a high pin, 0 for a low one.
+int analogRead(uint8_t pin);
+
+void interrupts();
+void noInterrupts();
+
+// Input pins of the ports, updated as the pins change level.
+extern volatile uint8_t PINB, PINC, PIND, PINE;
+// Only stored: pin changes don't raise interrupts or flags.
+extern volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2, PCMSK3;
+// Only stored, as the ADC isn't emulated.
+extern volatile uint8_t ADCSRA;
+// Reset flags: the host always starts from a power-on reset.
+extern volatile uint8_t MCUSR;
+
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+
+#define PCIE1 1
+#define PCIE2 2
+#define PCINT8 0
+#define PCINT9 1
+#define PCINT10 2
+#define PCINT11 3
+#define PCINT18 2
+#define PCINT23 7
+
+/* The AVR core defines these as macros; templates avoid clashing with the STL. */
+template <class T, class U>
+constexpr typename std::common_type<T, U>::type min(T a, U b)
+{
+	return a < b ? a : b;
+}
+
+template <class T, class U>
+constexpr typename std::common_type<T, U>::type max(T a, U b)
+{
+	return a > b ? a : b;
+}
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#include "HardwareSerial.h"
+#include "Print.h"
+#include "Stream.h"
+
+#endif // NSEC_HOST_SHIMS_ARDUINO_H
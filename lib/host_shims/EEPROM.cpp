@@ -0,0 +1,57 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "EEPROM.h"
+#include "host_clock.hpp"
+
+namespace {
+// Erase and write time of a byte (see the datasheet's EEPROM programming time).
+constexpr unsigned long long write_duration_us = 3400;
+} // namespace
+
+// Constant-initialized: usable from the constructors of other globals.
+EEPROMClass EEPROM;
+
+uint8_t EEPROMClass::read(int index)
+{
+	_erase_on_first_use();
+	return index >= 0 && index < int(sizeof(_contents)) ? _contents[index] : 0xFF;
+}
+
+void EEPROMClass::write(int index, uint8_t value)
+{
+	_erase_on_first_use();
+	if (index < 0 || index >= int(sizeof(_contents))) {
+		return;
+	}
+
+	_contents[index] = value;
+	_write_count++;
+	nsec::host::advance_time_us(write_duration_us);
+}
+
+void EEPROMClass::update(int index, uint8_t value)
+{
+	if (read(index) != value) {
+		write(index, value);
+	}
+}
+
+uint8_t *EEPROMClass::contents()
+{
+	_erase_on_first_use();
+	return _contents;
+}
+
+void EEPROMClass::_erase_on_first_use()
+{
+	if (_is_used) {
+		return;
+	}
+
+	memset(_contents, 0xFF, sizeof(_contents));
+	_is_used = true;
+}
@@ -0,0 +1,75 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_EEPROM_H
+#define NSEC_HOST_SHIMS_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * The ATmega328PB's 1 KiB EEPROM, erased (0xFF) on first use, which can happen before
+ * main() from the constructor of a global. Like on the badge, writing
+ * a byte waits for the previous write to complete: each write advances the virtual clock
+ * by the time it takes.
+ */
+class EEPROMClass {
+public:
+	uint8_t read(int index);
+	void write(int index, uint8_t value);
+	// Only writes if the value differs.
+	void update(int index, uint8_t value);
+
+	uint16_t length()
+	{
+		return sizeof(_contents);
+	}
+
+	template <class T>
+	T& get(int index, T& value)
+	{
+		auto *bytes = reinterpret_cast<uint8_t *>(&value);
+
+		for (size_t i = 0; i < sizeof(T); i++) {
+			bytes[i] = read(index + int(i));
+		}
+
+		return value;
+	}
+
+	template <class T>
+	const T& put(int index, const T& value)
+	{
+		const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+
+		for (size_t i = 0; i < sizeof(T); i++) {
+			update(index + int(i), bytes[i]);
+		}
+
+		return value;
+	}
+
+	/* Host-only extensions. */
+
+	uint8_t *contents();
+
+	// Byte writes performed (skipped updates excluded).
+	unsigned long write_count() const
+	{
+		return _write_count;
+	}
+
+private:
+	void _erase_on_first_use();
+
+	uint8_t _contents[1024];
+	unsigned long _write_count;
+	bool _is_used;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // NSEC_HOST_SHIMS_EEPROM_H
@@ -0,0 +1,95 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "HardwareSerial.h"
+
+namespace {
+// Same as the core's SERIAL_RX_BUFFER_SIZE.
+constexpr size_t receive_buffer_size = 64;
+
+HardwareSerial::output_observer the_output_observer;
+
+struct {
+	bool is_started;
+	uint8_t received[receive_buffer_size];
+	size_t received_head;
+	size_t received_count;
+	unsigned long bytes_sent;
+} state;
+} // namespace
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long)
+{
+	state.is_started = true;
+}
+
+void HardwareSerial::end()
+{
+	state.is_started = false;
+}
+
+int HardwareSerial::available()
+{
+	return int(state.received_count);
+}
+
+int HardwareSerial::read()
+{
+	const auto c = peek();
+
+	if (c >= 0) {
+		state.received_head = (state.received_head + 1) % receive_buffer_size;
+		state.received_count--;
+	}
+
+	return c;
+}
+
+int HardwareSerial::peek()
+{
+	return state.received_count ? state.received[state.received_head] : -1;
+}
+
+int HardwareSerial::availableForWrite()
+{
+	// Bytes are sent instantly.
+	return 63;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+	if (!state.is_started) {
+		return 0;
+	}
+
+	state.bytes_sent++;
+	if (the_output_observer) {
+		the_output_observer(c);
+	}
+
+	return 1;
+}
+
+void HardwareSerial::set_output_observer(output_observer observer)
+{
+	the_output_observer = observer;
+}
+
+void HardwareSerial::receive(const uint8_t *bytes, size_t size)
+{
+	for (size_t i = 0; i < size && state.received_count < receive_buffer_size; i++) {
+		state.received[(state.received_head + state.received_count) % receive_buffer_size] =
+			bytes[i];
+		state.received_count++;
+	}
+}
+
+unsigned long HardwareSerial::bytes_sent() const
+{
+	return state.bytes_sent;
+}
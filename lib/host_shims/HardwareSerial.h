@@ -0,0 +1,48 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_HARDWARE_SERIAL_H
+#define NSEC_HOST_SHIMS_HARDWARE_SERIAL_H
+
+#include "Stream.h"
+
+#include <stdint.h>
+
+/*
+ * USART0. Transmission doesn't block: the badge's core queues the bytes and sends them
+ * from an interrupt handler.
+ */
+class HardwareSerial : public Stream {
+public:
+	using output_observer = void (*)(uint8_t);
+
+	void begin(unsigned long baud);
+	void end();
+
+	int available() override;
+	int read() override;
+	int peek() override;
+	int availableForWrite() override;
+	size_t write(uint8_t) override;
+	using Print::write;
+
+	explicit operator bool() const
+	{
+		return true;
+	}
+
+	/* Host-only extensions. */
+
+	// Invoked with every byte sent (bytes sent before begin() are dropped, as on the badge).
+	static void set_output_observer(output_observer observer);
+	// Queue bytes to be received; bytes past the receive buffer's capacity are dropped.
+	void receive(const uint8_t *bytes, size_t size);
+	unsigned long bytes_sent() const;
+};
+
+extern HardwareSerial Serial;
+
+#endif // NSEC_HOST_SHIMS_HARDWARE_SERIAL_H
@@ -0,0 +1,143 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "Print.h"
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+	size_t written = 0;
+
+	while (size--) {
+		const auto count = write(*buffer++);
+
+		if (count == 0) {
+			break;
+		}
+
+		written += count;
+	}
+
+	return written;
+}
+
+size_t Print::print(const __FlashStringHelper *str)
+{
+	return print(reinterpret_cast<const char *>(str));
+}
+
+size_t Print::print(const char *str)
+{
+	return write(str);
+}
+
+size_t Print::print(char c)
+{
+	return write(uint8_t(c));
+}
+
+size_t Print::print(unsigned char value, int base)
+{
+	return print((unsigned long) value, base);
+}
+
+size_t Print::print(int value, int base)
+{
+	return print((long) value, base);
+}
+
+size_t Print::print(unsigned int value, int base)
+{
+	return print((unsigned long) value, base);
+}
+
+size_t Print::print(long value, int base)
+{
+	if (base == 0) {
+		return write(uint8_t(value));
+	}
+
+	// Like the core, only decimal numbers are signed.
+	if (base == DEC && value < 0) {
+		return print('-') + _print_number(-(unsigned long) value, DEC);
+	}
+
+	return _print_number((unsigned long) value, base);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+	if (base == 0) {
+		return write(uint8_t(value));
+	}
+
+	return _print_number(value, base);
+}
+
+size_t Print::println(const __FlashStringHelper *str)
+{
+	return print(str) + println();
+}
+
+size_t Print::println(const char *str)
+{
+	return print(str) + println();
+}
+
+size_t Print::println(char c)
+{
+	return print(c) + println();
+}
+
+size_t Print::println(unsigned char value, int base)
+{
+	return print(value, base) + println();
+}
+
+size_t Print::println(int value, int base)
+{
+	return print(value, base) + println();
+}
+
+size_t Print::println(unsigned int value, int base)
+{
+	return print(value, base) + println();
+}
+
+size_t Print::println(long value, int base)
+{
+	return print(value, base) + println();
+}
+
+size_t Print::println(unsigned long value, int base)
+{
+	return print(value, base) + println();
+}
+
+size_t Print::println()
+{
+	return write("\r\n");
+}
+
+size_t Print::_print_number(unsigned long value, uint8_t base)
+{
+	// Longest number: 32 binary digits.
+	char digits[33];
+	char *digit = &digits[sizeof(digits) - 1];
+
+	if (base < 2) {
+		base = 10;
+	}
+
+	*digit = '\0';
+	do {
+		const auto remainder = char(value % base);
+
+		value /= base;
+		*--digit = remainder < 10 ? remainder + '0' : remainder + 'A' - 10;
+	} while (value);
+
+	return write(digit);
+}
@@ -0,0 +1,70 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_PRINT_H
+#define NSEC_HOST_SHIMS_PRINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class __FlashStringHelper;
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+/* Same interface and number formatting as the Arduino core's Print. */
+class Print {
+public:
+	virtual ~Print() = default;
+
+	virtual size_t write(uint8_t) = 0;
+	virtual size_t write(const uint8_t *buffer, size_t size);
+	size_t write(const char *str)
+	{
+		return str ? write(reinterpret_cast<const uint8_t *>(str), strlen(str)) : 0;
+	}
+
+	size_t write(const char *buffer, size_t size)
+	{
+		return write(reinterpret_cast<const uint8_t *>(buffer), size);
+	}
+
+	virtual int availableForWrite()
+	{
+		return 0;
+	}
+
+	virtual void flush()
+	{
+	}
+
+	size_t print(const __FlashStringHelper *str);
+	size_t print(const char *str);
+	size_t print(char c);
+	size_t print(unsigned char value, int base = DEC);
+	size_t print(int value, int base = DEC);
+	size_t print(unsigned int value, int base = DEC);
+	size_t print(long value, int base = DEC);
+	size_t print(unsigned long value, int base = DEC);
+
+	size_t println(const __FlashStringHelper *str);
+	size_t println(const char *str);
+	size_t println(char c);
+	size_t println(unsigned char value, int base = DEC);
+	size_t println(int value, int base = DEC);
+	size_t println(unsigned int value, int base = DEC);
+	size_t println(long value, int base = DEC);
+	size_t println(unsigned long value, int base = DEC);
+	size_t println();
+
+private:
+	size_t _print_number(unsigned long value, uint8_t base);
+};
+
+#endif // NSEC_HOST_SHIMS_PRINT_H
@@ -0,0 +1,170 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "SoftwareSerial.h"
+#include "host_clock.hpp"
+
+namespace {
+constexpr uint8_t max_instance_count = 4;
+
+SoftwareSerial::transmit_observer the_transmit_observer;
+SoftwareSerial *instances[max_instance_count];
+SoftwareSerial *listening_instance;
+
+// Shared by all instances, as upstream.
+uint8_t receive_buffer[_SS_MAX_RX_BUFF];
+uint8_t receive_buffer_head;
+uint8_t receive_buffer_tail;
+bool has_receive_buffer_overflowed;
+} // namespace
+
+SoftwareSerial::SoftwareSerial(uint8_t receive_pin, uint8_t transmit_pin, bool) :
+	_receive_pin{ receive_pin }, _transmit_pin{ transmit_pin }, _byte_duration_us{ 0 }
+{
+	// Idle line, as upstream.
+	pinMode(transmit_pin, OUTPUT);
+	digitalWrite(transmit_pin, HIGH);
+	pinMode(receive_pin, INPUT_PULLUP);
+
+	for (auto& instance : instances) {
+		if (!instance) {
+			instance = this;
+			break;
+		}
+	}
+}
+
+SoftwareSerial::~SoftwareSerial()
+{
+	end();
+	for (auto& instance : instances) {
+		if (instance == this) {
+			instance = nullptr;
+		}
+	}
+}
+
+void SoftwareSerial::begin(long speed)
+{
+	_byte_duration_us = (10000000UL + speed / 2) / speed;
+	listen();
+}
+
+void SoftwareSerial::end()
+{
+	stopListening();
+}
+
+bool SoftwareSerial::listen()
+{
+	if (!_byte_duration_us || listening_instance == this) {
+		return false;
+	}
+
+	has_receive_buffer_overflowed = false;
+	receive_buffer_head = receive_buffer_tail = 0;
+	listening_instance = this;
+	return true;
+}
+
+bool SoftwareSerial::isListening() const
+{
+	return listening_instance == this;
+}
+
+bool SoftwareSerial::stopListening()
+{
+	if (!isListening()) {
+		return false;
+	}
+
+	listening_instance = nullptr;
+	return true;
+}
+
+bool SoftwareSerial::overflow()
+{
+	const auto overflowed = has_receive_buffer_overflowed;
+
+	has_receive_buffer_overflowed = false;
+	return overflowed;
+}
+
+int SoftwareSerial::available()
+{
+	if (!isListening()) {
+		return 0;
+	}
+
+	return (receive_buffer_tail + _SS_MAX_RX_BUFF - receive_buffer_head) % _SS_MAX_RX_BUFF;
+}
+
+int SoftwareSerial::read()
+{
+	const auto byte = peek();
+
+	if (byte >= 0) {
+		receive_buffer_head = (receive_buffer_head + 1) % _SS_MAX_RX_BUFF;
+	}
+
+	return byte;
+}
+
+int SoftwareSerial::peek()
+{
+	if (!isListening() || receive_buffer_head == receive_buffer_tail) {
+		return -1;
+	}
+
+	return receive_buffer[receive_buffer_head];
+}
+
+size_t SoftwareSerial::write(uint8_t byte)
+{
+	if (!_byte_duration_us) {
+		return 0;
+	}
+
+	nsec::host::advance_time_us(_byte_duration_us);
+	if (the_transmit_observer) {
+		the_transmit_observer(*this, byte);
+	}
+
+	return 1;
+}
+
+void SoftwareSerial::set_transmit_observer(transmit_observer observer)
+{
+	the_transmit_observer = observer;
+}
+
+void SoftwareSerial::deliver(uint8_t receive_pin, uint8_t byte)
+{
+	for (auto *instance : instances) {
+		if (instance && instance->_receive_pin == receive_pin) {
+			instance->_receive(byte);
+			return;
+		}
+	}
+}
+
+void SoftwareSerial::_receive(uint8_t byte)
+{
+	if (!isListening()) {
+		return;
+	}
+
+	const uint8_t next_tail = (receive_buffer_tail + 1) % _SS_MAX_RX_BUFF;
+
+	// Upstream keeps one slot free.
+	if (next_tail == receive_buffer_head) {
+		has_receive_buffer_overflowed = true;
+		return;
+	}
+
+	receive_buffer[receive_buffer_tail] = byte;
+	receive_buffer_tail = next_tail;
+}
@@ -0,0 +1,83 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_SOFTWARE_SERIAL_H
+#define NSEC_HOST_SHIMS_SOFTWARE_SERIAL_H
+
+#include "Arduino.h"
+
+#define _SS_MAX_RX_BUFF 64
+
+/*
+ * Same behaviour as the AVR SoftwareSerial library: only the listening instance receives,
+ * all instances share one receive buffer which is emptied when the listening instance
+ * changes, and transmissions are bit-banged, which blocks the badge (and advances the
+ * virtual clock) for the duration of each byte.
+ *
+ * Nothing is connected to the pins: the host program observes the transmitted bytes and
+ * delivers the received ones.
+ */
+class SoftwareSerial : public Stream {
+public:
+	// Invoked at the end of each byte's transmission.
+	using transmit_observer = void (*)(const SoftwareSerial& serial, uint8_t byte);
+
+	SoftwareSerial(uint8_t receive_pin, uint8_t transmit_pin, bool inverse_logic = false);
+	~SoftwareSerial() override;
+
+	SoftwareSerial(const SoftwareSerial&) = delete;
+	SoftwareSerial& operator=(const SoftwareSerial&) = delete;
+
+	void begin(long speed);
+	void end();
+	bool listen();
+	bool isListening() const;
+	bool stopListening();
+	// Returns and clears the receive buffer's overflow flag.
+	bool overflow();
+
+	int available() override;
+	int read() override;
+	int peek() override;
+	size_t write(uint8_t byte) override;
+	using Print::write;
+
+	explicit operator bool() const
+	{
+		return true;
+	}
+
+	/* Host-only extensions. */
+
+	static void set_transmit_observer(transmit_observer observer);
+	// Receive a byte on a pin; it is dropped unless that pin's instance is listening.
+	static void deliver(uint8_t receive_pin, uint8_t byte);
+
+	uint8_t receive_pin() const
+	{
+		return _receive_pin;
+	}
+
+	uint8_t transmit_pin() const
+	{
+		return _transmit_pin;
+	}
+
+	// Time to send a byte (start bit, eight data bits, stop bit).
+	unsigned long byte_duration_us() const
+	{
+		return _byte_duration_us;
+	}
+
+private:
+	void _receive(uint8_t byte);
+
+	const uint8_t _receive_pin;
+	const uint8_t _transmit_pin;
+	unsigned long _byte_duration_us;
+};
+
+#endif // NSEC_HOST_SHIMS_SOFTWARE_SERIAL_H
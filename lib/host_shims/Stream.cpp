@@ -0,0 +1,26 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "Stream.h"
+#include "host_clock.hpp"
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+	size_t count = 0;
+
+	while (count < length) {
+		const auto c = read();
+
+		if (c < 0) {
+			nsec::host::advance_time_us(_timeout_ms * 1000ULL);
+			break;
+		}
+
+		buffer[count++] = char(c);
+	}
+
+	return count;
+}
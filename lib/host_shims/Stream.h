@@ -0,0 +1,39 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_STREAM_H
+#define NSEC_HOST_SHIMS_STREAM_H
+
+#include "Print.h"
+
+/*
+ * The firmware only uses the non-blocking part of the Arduino core's Stream, and
+ * readBytes(). Nothing can be received while the badge waits for more bytes: when they
+ * run out, readBytes() advances the virtual clock by the timeout, like the badge would
+ * spend it, and returns what it got.
+ */
+class Stream : public Print {
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+
+	void setTimeout(unsigned long timeout_ms)
+	{
+		_timeout_ms = timeout_ms;
+	}
+
+	size_t readBytes(char *buffer, size_t length);
+	size_t readBytes(uint8_t *buffer, size_t length)
+	{
+		return readBytes(reinterpret_cast<char *>(buffer), length);
+	}
+
+private:
+	unsigned long _timeout_ms = 1000;
+};
+
+#endif // NSEC_HOST_SHIMS_STREAM_H
@@ -0,0 +1,95 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "Wire.h"
+#include "host_clock.hpp"
+
+namespace {
+TwoWire::transmission_observer the_transmission_observer;
+} // namespace
+
+TwoWire Wire;
+
+void TwoWire::begin()
+{
+}
+
+void TwoWire::end()
+{
+}
+
+void TwoWire::setClock(uint32_t clock)
+{
+	_clock = clock;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+	_address = address;
+	_buffer_length = 0;
+	_is_transmitting = true;
+}
+
+uint8_t TwoWire::endTransmission(bool)
+{
+	// Address byte included; each byte takes nine clock cycles (data and acknowledge).
+	const unsigned long byte_count = _buffer_length + 1;
+
+	_is_transmitting = false;
+	_bytes_sent += byte_count;
+	nsec::host::advance_time_us((byte_count * 9 * 1000000ULL + _clock - 1) / _clock);
+	if (the_transmission_observer) {
+		the_transmission_observer(_address, _buffer, _buffer_length);
+	}
+
+	return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t, uint8_t, bool)
+{
+	return 0;
+}
+
+size_t TwoWire::write(uint8_t byte)
+{
+	if (!_is_transmitting || _buffer_length == sizeof(_buffer)) {
+		return 0;
+	}
+
+	_buffer[_buffer_length++] = byte;
+	return 1;
+}
+
+size_t TwoWire::write(const uint8_t *bytes, size_t size)
+{
+	size_t written = 0;
+
+	while (written < size && write(bytes[written])) {
+		written++;
+	}
+
+	return written;
+}
+
+int TwoWire::available()
+{
+	return 0;
+}
+
+int TwoWire::read()
+{
+	return -1;
+}
+
+int TwoWire::peek()
+{
+	return -1;
+}
+
+void TwoWire::set_transmission_observer(transmission_observer observer)
+{
+	the_transmission_observer = observer;
+}
@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_WIRE_H
+#define NSEC_HOST_SHIMS_WIRE_H
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+/*
+ * TWI master. Transmissions block the badge until the last byte is acknowledged: each
+ * one advances the virtual clock by its duration on the bus. No device ever answers a
+ * read.
+ */
+class TwoWire : public Stream {
+public:
+	// Invoked with the bytes of each transmission, once it has completed.
+	using transmission_observer = void (*)(uint8_t address, const uint8_t *bytes, size_t size);
+
+	void begin();
+	void end();
+	void setClock(uint32_t clock);
+
+	void beginTransmission(uint8_t address);
+	void beginTransmission(int address)
+	{
+		beginTransmission(uint8_t(address));
+	}
+
+	// Always succeeds (0).
+	uint8_t endTransmission(bool send_stop = true);
+	uint8_t requestFrom(uint8_t address, uint8_t quantity, bool send_stop = true);
+
+	size_t write(uint8_t byte) override;
+	size_t write(const uint8_t *bytes, size_t size) override;
+	using Print::write;
+
+	int available() override;
+	int read() override;
+	int peek() override;
+
+	/* Host-only extensions. */
+
+	static void set_transmission_observer(transmission_observer observer);
+	// Bytes sent on the bus, addresses included.
+	unsigned long bytes_sent() const
+	{
+		return _bytes_sent;
+	}
+
+private:
+	uint32_t _clock = 100000;
+	uint8_t _address;
+	uint8_t _buffer[BUFFER_LENGTH];
+	uint8_t _buffer_length;
+	bool _is_transmitting;
+	unsigned long _bytes_sent;
+};
+
+extern TwoWire Wire;
+
+#endif // NSEC_HOST_SHIMS_WIRE_H
@@ -0,0 +1,21 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_AVR_BOOT_H
+#define NSEC_HOST_SHIMS_AVR_BOOT_H
+
+#include <stdint.h>
+
+/*
+ * The signature row holds the device's serial number; the host uses an arbitrary,
+ * fixed one.
+ */
+static inline uint8_t boot_signature_byte_get(uint8_t address)
+{
+	return uint8_t(0x5A ^ (address * 37));
+}
+
+#endif // NSEC_HOST_SHIMS_AVR_BOOT_H
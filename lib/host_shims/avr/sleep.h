@@ -0,0 +1,53 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_AVR_SLEEP_H
+#define NSEC_HOST_SHIMS_AVR_SLEEP_H
+
+/*
+ * The host never sleeps: every sleep mode returns at once, as if a wake-up source had
+ * fired right away. Power-down first calls the power-down observer, which can drive the
+ * pin change that wakes the MCU up (e.g. a button press).
+ */
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_PWR_DOWN 2
+
+namespace nsec::host {
+
+using power_down_observer = void (*)();
+void set_power_down_observer(power_down_observer observer) noexcept;
+
+namespace details {
+void set_sleep_mode(int mode) noexcept;
+void sleep_cpu() noexcept;
+} // namespace details
+
+} // namespace nsec::host
+
+static inline void set_sleep_mode(int mode)
+{
+	nsec::host::details::set_sleep_mode(mode);
+}
+
+static inline void sleep_enable()
+{
+}
+
+static inline void sleep_disable()
+{
+}
+
+static inline void sleep_cpu()
+{
+	nsec::host::details::sleep_cpu();
+}
+
+static inline void sleep_mode()
+{
+	sleep_cpu();
+}
+
+#endif // NSEC_HOST_SHIMS_AVR_SLEEP_H
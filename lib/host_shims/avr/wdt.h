@@ -0,0 +1,25 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_AVR_WDT_H
+#define NSEC_HOST_SHIMS_AVR_WDT_H
+
+/* The host has no watchdog: the badge is never reset. */
+#define WDTO_2S 7
+
+static inline void wdt_enable(int)
+{
+}
+
+static inline void wdt_disable()
+{
+}
+
+static inline void wdt_reset()
+{
+}
+
+#endif // NSEC_HOST_SHIMS_AVR_WDT_H
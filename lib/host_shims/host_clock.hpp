@@ -0,0 +1,29 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_HOST_CLOCK_HPP
+#define NSEC_HOST_SHIMS_HOST_CLOCK_HPP
+
+namespace nsec::host {
+
+/* Virtual time returned by millis() and micros(). */
+void set_time_us(unsigned long long time_us) noexcept;
+unsigned long long time_us() noexcept;
+
+inline void set_time_ms(unsigned long time_ms) noexcept
+{
+	set_time_us(static_cast<unsigned long long>(time_ms) * 1000);
+}
+
+// Time spent by the badge in a blocking operation (e.g. a bit-banged transfer).
+inline void advance_time_us(unsigned long long duration_us) noexcept
+{
+	set_time_us(time_us() + duration_us);
+}
+
+} // namespace nsec::host
+
+#endif // NSEC_HOST_SHIMS_HOST_CLOCK_HPP
@@ -0,0 +1,179 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "host_oled.hpp"
+#include "Wire.h"
+
+namespace {
+constexpr uint8_t width = 128, page_count = 4;
+constexpr uint8_t command_stream = 0x00, data_stream = 0x40;
+
+struct {
+	uint8_t address;
+	uint8_t ram[page_count][width];
+	bool is_on;
+	bool is_inverted;
+	uint8_t contrast;
+	unsigned long frame_count;
+
+	// Command being received (they can span transmissions) and its arguments.
+	uint8_t command;
+	uint8_t argument_count;
+	uint8_t arguments[2];
+
+	// Horizontal addressing window and write position.
+	uint8_t column_start, column_end, page_start, page_end;
+	uint8_t column, page;
+} panel;
+
+uint8_t argument_count(uint8_t command) noexcept
+{
+	switch (command) {
+	case 0x21: // COLUMNADDR
+	case 0x22: // PAGEADDR
+		return 2;
+	case 0x20: // MEMORYMODE
+	case 0x81: // SETCONTRAST
+	case 0x8D: // CHARGEPUMP
+	case 0xA8: // SETMULTIPLEX
+	case 0xD3: // SETDISPLAYOFFSET
+	case 0xD5: // SETDISPLAYCLOCKDIV
+	case 0xD9: // SETPRECHARGE
+	case 0xDA: // SETCOMPINS
+	case 0xDB: // SETVCOMDETECT
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+void execute(uint8_t command, const uint8_t *arguments) noexcept
+{
+	switch (command) {
+	case 0x21:
+		panel.column_start = arguments[0] < width ? arguments[0] : width - 1;
+		panel.column_end = arguments[1] < width ? arguments[1] : width - 1;
+		panel.column = panel.column_start;
+		break;
+	case 0x22:
+		// The page end is clamped to the panel's height (the driver sends 0xFF).
+		panel.page_start = arguments[0] < page_count ? arguments[0] : page_count - 1;
+		panel.page_end = arguments[1] < page_count ? arguments[1] : page_count - 1;
+		panel.page = panel.page_start;
+		break;
+	case 0x81:
+		panel.contrast = arguments[0];
+		break;
+	case 0xA6:
+	case 0xA7:
+		panel.is_inverted = command == 0xA7;
+		break;
+	case 0xAE:
+	case 0xAF:
+		panel.is_on = command == 0xAF;
+		break;
+	default:
+		break;
+	}
+}
+
+void receive_command_byte(uint8_t byte) noexcept
+{
+	if (panel.argument_count == 0) {
+		panel.command = byte;
+		if (argument_count(byte) == 0) {
+			execute(byte, nullptr);
+			return;
+		}
+
+		// Count the command itself to tell it apart from an idle parser.
+		panel.argument_count = 1;
+		return;
+	}
+
+	panel.arguments[panel.argument_count - 1] = byte;
+	if (panel.argument_count++ == argument_count(panel.command)) {
+		execute(panel.command, panel.arguments);
+		panel.argument_count = 0;
+	}
+}
+
+void receive_data_byte(uint8_t byte) noexcept
+{
+	panel.ram[panel.page][panel.column] = byte;
+	if (panel.column++ != panel.column_end) {
+		return;
+	}
+
+	panel.column = panel.column_start;
+	if (panel.page++ != panel.page_end) {
+		return;
+	}
+
+	panel.page = panel.page_start;
+	if (panel.column_start == 0 && panel.column_end == width - 1 && panel.page_start == 0 &&
+	    panel.page_end == page_count - 1) {
+		panel.frame_count++;
+	}
+}
+
+void on_transmission(uint8_t address, const uint8_t *bytes, size_t size)
+{
+	if (address != panel.address || size == 0) {
+		return;
+	}
+
+	const auto receive = bytes[0] == data_stream ? receive_data_byte : receive_command_byte;
+
+	if (bytes[0] != command_stream && bytes[0] != data_stream) {
+		return;
+	}
+
+	for (size_t i = 1; i < size; i++) {
+		receive(bytes[i]);
+	}
+}
+} // anonymous namespace
+
+void nsec::host::oled::attach(uint8_t address) noexcept
+{
+	panel = {};
+	panel.address = address;
+	// Reset state of the controller.
+	panel.contrast = 0x7F;
+	panel.column_end = width - 1;
+	panel.page_end = page_count - 1;
+	TwoWire::set_transmission_observer(on_transmission);
+}
+
+bool nsec::host::oled::pixel(uint8_t x, uint8_t y) noexcept
+{
+	if (x >= width || y >= page_count * 8) {
+		return false;
+	}
+
+	return (panel.ram[y / 8][x] >> (y % 8)) & 1;
+}
+
+bool nsec::host::oled::is_on() noexcept
+{
+	return panel.is_on;
+}
+
+bool nsec::host::oled::is_inverted() noexcept
+{
+	return panel.is_inverted;
+}
+
+uint8_t nsec::host::oled::contrast() noexcept
+{
+	return panel.contrast;
+}
+
+unsigned long nsec::host::oled::frame_count() noexcept
+{
+	return panel.frame_count;
+}
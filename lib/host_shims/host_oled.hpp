@@ -0,0 +1,32 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_HOST_OLED_HPP
+#define NSEC_HOST_SHIMS_HOST_OLED_HPP
+
+#include <stdint.h>
+
+/*
+ * The SSD1306 panel at the other end of the TWI bus. It decodes the commands and the
+ * display RAM writes sent by the badge, so that what the panel shows can be checked
+ * without trusting the driver's framebuffer.
+ */
+namespace nsec::host::oled {
+
+// Listen on the bus (replaces the Wire transmission observer) for a 128x32 panel.
+void attach(uint8_t address) noexcept;
+
+// Content of the panel's RAM, regardless of whether the panel is on.
+bool pixel(uint8_t x, uint8_t y) noexcept;
+bool is_on() noexcept;
+bool is_inverted() noexcept;
+uint8_t contrast() noexcept;
+// Number of times the whole RAM was written (i.e. display() calls).
+unsigned long frame_count() noexcept;
+
+} // namespace nsec::host::oled
+
+#endif // NSEC_HOST_SHIMS_HOST_OLED_HPP
@@ -0,0 +1,26 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_HOST_PINS_HPP
+#define NSEC_HOST_SHIMS_HOST_PINS_HPP
+
+#include <stdint.h>
+
+/*
+ * The world outside the badge's pins. A pin's level is, in order of precedence, the
+ * badge's output, the level driven by the host program, the pull-up, or low.
+ */
+namespace nsec::host {
+
+// e.g. a button pulling its pin low, or a neighbour badge driving a connection line.
+void drive_pin(uint8_t pin, bool level) noexcept;
+// The pin floats again.
+void release_pin(uint8_t pin) noexcept;
+bool pin_level(uint8_t pin) noexcept;
+
+} // namespace nsec::host
+
+#endif // NSEC_HOST_SHIMS_HOST_PINS_HPP
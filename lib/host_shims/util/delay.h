@@ -0,0 +1,23 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_HOST_SHIMS_UTIL_DELAY_H
+#define NSEC_HOST_SHIMS_UTIL_DELAY_H
+
+#include "host_clock.hpp"
+
+/* Busy-waits on the badge: they advance the virtual clock. */
+static inline void _delay_ms(double ms)
+{
+	nsec::host::advance_time_us((unsigned long long) (ms * 1000));
+}
+
+static inline void _delay_us(double us)
+{
+	nsec::host::advance_time_us((unsigned long long) us);
+}
+
+#endif // NSEC_HOST_SHIMS_UTIL_DELAY_H
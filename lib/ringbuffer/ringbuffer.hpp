@@ -72,6 +72,10 @@ public:
 		return true;
 	}
 
+#ifdef NSEC_CYCLE_BENCH
+	// Measured by tools/cycle_bench, see include/diagnostics/benchmark.hpp.
+	__attribute__((noinline))
+#endif
 	bool contains(uint32_t item) const
 	{
 		const auto count = get_count();
@@ -93,6 +97,20 @@ public:
 		return get_count();
 	}
 
+	uint16_t capacity() const
+	{
+		return _capacity;
+	}
+
+	// Items are stored in insertion order, wrapping around once the buffer is full.
+	uint32_t item(uint16_t index) const
+	{
+		uint32_t value;
+
+		EEPROM.get(item_addr(index), value);
+		return value;
+	}
+
 private:
 	/*
 	 * Each byte in a fresh chip will be set to 255, use this value to identify the
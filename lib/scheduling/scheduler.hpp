@@ -19,11 +19,28 @@
 
 namespace nsec::scheduling {
 
-template <unsigned int>
+class task;
+
+/* Observer of a scheduler which ignores all of its notifications. */
+struct null_observer {
+	static void on_task_run_begin(const task&) noexcept
+	{
+	}
+
+	static void on_task_run_end(const task&) noexcept
+	{
+	}
+};
+
+/*
+ * The Observer's static on_task_run_begin() and on_task_run_end() methods are invoked
+ * around the execution of every task (e.g. to trace the scheduler's activity).
+ */
+template <unsigned int max_scheduled_tasks, class Observer = null_observer>
 class scheduler;
 
 class task {
-	template <unsigned int>
+	template <unsigned int, class>
 	friend class scheduler;
 
 public:
@@ -54,7 +71,7 @@ private:
 };
 
 class periodic_task : public task {
-	template <unsigned int>
+	template <unsigned int, class>
 	friend class scheduler;
 
 public:
@@ -114,7 +131,7 @@ private:
 	bool _killed : 1;
 };
 
-template <unsigned int max_scheduled_tasks>
+template <unsigned int max_scheduled_tasks, class Observer>
 class scheduler {
 public:
 	scheduler() noexcept = default;
@@ -137,6 +154,10 @@ public:
 	 * Returns how many milliseconds can elapse before the next tick invocation,
 	 * allowing the MCU to sleep when the next task is sufficiently far away.
 	 */
+#ifdef NSEC_CYCLE_BENCH
+	// Measured by tools/cycle_bench, see include/diagnostics/benchmark.hpp.
+	__attribute__((noinline))
+#endif
 	relative_time_ms tick(absolute_time_ms current_time_ms) noexcept
 	{
 		_last_tick_ms = current_time_ms;
@@ -161,7 +182,9 @@ private:
 	/* Run a task and reschedule it if necessary. */
 	void run_task(task& task) noexcept
 	{
+		Observer::on_task_run_begin(task);
 		task.run(_last_tick_ms);
+		Observer::on_task_run_end(task);
 		if (task.must_be_rescheduled()) {
 			auto& task_to_schedule = static_cast<periodic_task&>(task);
 
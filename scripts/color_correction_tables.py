@@ -0,0 +1,37 @@
+# SPDX-FileCopyrightText: 2023 NorthSec
+# SPDX-License-Identifier: MIT
+
+# Prints the color correction tables of src/strip_animator.cpp.
+#
+# Usage: python3 scripts/color_correction_tables.py
+
+# Brightness levels used by the animations (dim_brightness and bright_brightness).
+BRIGHTNESS_LEVELS = (("dim", 50), ("bright", 120))
+GAMMA = 2.6
+
+
+def gamma8(value):
+    """Gamma correction curve, as used by the NeoPixel library's gamma8()."""
+    return int((value / 255) ** GAMMA * 255 + 0.5)
+
+
+def scale_to_brightness(component, brightness):
+    """Brightness scaling, as applied by the NeoPixel library."""
+    return (component * (brightness + 1)) >> 8
+
+
+def print_table(name, brightness):
+    values = [scale_to_brightness(gamma8(i), brightness) for i in range(256)]
+
+    print("// Generated by scripts/color_correction_tables.py, brightness = {}.".format(brightness))
+    print("const uint8_t PROGMEM {}_color_correction_table[256] = {{".format(name))
+    for row in range(0, 256, 16):
+        print("\t" + ", ".join(str(value) for value in values[row:row + 16]) + ",")
+    print("};")
+
+
+if __name__ == "__main__":
+    for index, (name, brightness) in enumerate(BRIGHTNESS_LEVELS):
+        if index:
+            print()
+        print_table(name, brightness)
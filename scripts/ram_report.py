@@ -0,0 +1,62 @@
+# SPDX-FileCopyrightText: 2023 NorthSec
+# SPDX-License-Identifier: MIT
+
+Import("env")
+
+import os
+import struct
+import subprocess
+import tempfile
+
+# Sections of the firmware held in RAM from boot (the rest is shared by the heap
+# and the stack).
+STATIC_RAM_SECTIONS = (".data", ".bss", ".noinit")
+RAM_SIZE = 2048
+
+
+def parse_class_sizes(data):
+    """Parse the entries emitted by src/ram_report.cpp."""
+    sizes = []
+    offset = 0
+    while offset < len(data):
+        name_end = data.index(b"\0", offset)
+        name = data[offset:name_end].decode()
+        (size,) = struct.unpack_from("<H", data, name_end + 1)
+        sizes.append((name, size))
+        offset = name_end + 3
+
+    return sizes
+
+
+def static_ram_size(size_tool, elf_path):
+    output = subprocess.check_output([size_tool, "-A", elf_path], text=True)
+    total = 0
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) == 3 and fields[0] in STATIC_RAM_SECTIONS:
+            total += int(fields[1])
+
+    return total
+
+
+def class_sizes(objcopy, elf_path):
+    with tempfile.TemporaryDirectory() as directory:
+        section_path = os.path.join(directory, "ram_report")
+        subprocess.check_call(
+            [objcopy, "--dump-section", ".nsec.ram_report=" + section_path, elf_path,
+             os.path.join(directory, "discarded.elf")])
+        with open(section_path, "rb") as section:
+            return parse_class_sizes(section.read())
+
+
+def report_ram_usage(source, target, env):
+    elf_path = target[0].get_abspath()
+
+    print("Static RAM: {} of {} bytes".format(
+        static_ram_size(env.subst("$SIZETOOL"), elf_path), RAM_SIZE))
+    # Sizes overlap: the badge holds most of the other objects.
+    for name, size in class_sizes(env.subst("$OBJCOPY"), elf_path):
+        print("  {:<48} {:>5}".format(name, size))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report_ram_usage)
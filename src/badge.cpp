@@ -6,7 +6,14 @@
 
 #include "badge.hpp"
 #include "board.hpp"
+#include "diagnostics/benchmark.hpp"
+#include "diagnostics/flight_recorder.hpp"
+#include "diagnostics/latency.hpp"
+#include "diagnostics/profiler.hpp"
+#include "diagnostics/stack_monitor.hpp"
+#include "diagnostics/trace.hpp"
 #include "display/menu/menu.hpp"
+#include "formatter.hpp"
 #include "globals.hpp"
 #include "network/network_messages.hpp"
 #include "unique_id.hpp"
@@ -18,66 +25,163 @@ namespace nd = nsec::display;
 namespace nc = nsec::communication;
 namespace nb = nsec::button;
 namespace nl = nsec::led;
+namespace ndt = nsec::diagnostics::trace;
 
 namespace {
 const char set_name_prompt[] PROGMEM = "Enter your name";
+const char set_name_choice_name[] PROGMEM = "Set name";
+const char badge_info_choice_name[] PROGMEM = "Badge information";
+const char factory_reset_choice_name[] PROGMEM = "Factory reset";
 const char yes_str[] PROGMEM = "yes";
 const char no_str[] PROGMEM = "no";
 const char unset_name_scroll[] PROGMEM = "Press X to set your name";
 
 constexpr uint16_t config_version_magic = 0xBAD8;
 
-/*
- * Format to a fixed size buffer. Caller must ensure it has enough space
- * for the formatted string, or risk being the subject of a talk at the next
- * edition of nsec.
- */
-class formatter : public Print {
-public:
-	explicit formatter(char *msg) : _ptr{ msg }
-	{
-	}
-
-	size_t write(uint8_t new_char) override
-	{
-		*_ptr = new_char;
-		_ptr++;
-		return 1;
-	}
-
-private:
-	char *_ptr;
-};
-
 const __FlashStringHelper *as_flash_string(const char *str)
 {
 	return static_cast<const __FlashStringHelper *>(static_cast<const void *>(str));
 }
 
-void badge_info_printer(void *badge_data,
-			Print& print,
-			nsec::scheduling::absolute_time_ms current_time_ms)
+NSEC_BENCHMARKED void badge_info_printer(void *badge_data,
+					 Print& print,
+					 nsec::scheduling::absolute_time_ms current_time_ms)
 {
 	const auto *badge = reinterpret_cast<const class nsec::runtime::badge *>(badge_data);
+	char line[nsec::config::display::text_line_length];
+	nsec::formatter formatter(line);
 
 	// Print the last 4 bytes of the serial unique ID
-	print.print(F("ID: "));
+	formatter.append(F("ID: "));
 	for (uint8_t i = UniqueIDsize - 4; i < UniqueIDsize; i++) {
-		if (UniqueID[i] < 0x10) {
-			print.print(F("0"));
-		}
-
-		print.print(UniqueID[i], HEX);
-		print.print(F(" "));
+		formatter.hex(UniqueID[i], 2).append(' ');
 	}
-	print.println();
+	print.println(line);
 
-	print.print(F("Level: "));
-	print.println(int(badge->level()));
+	formatter.clear();
+	formatter.append(F("Level: ")).decimal(badge->level());
+	print.println(line);
 
 	print.print(F("Connected: "));
 	print.println(badge->is_connected() ? as_flash_string(yes_str) : as_flash_string(no_str));
+
+	nsec::diagnostics::flight_recorder::print_summary(print);
+}
+
+#ifdef NSEC_LATENCY_PROBE
+const char latency_choice_name[] PROGMEM = "Latency";
+
+void latency_printer(void *, Print& print, nsec::scheduling::absolute_time_ms)
+{
+	nsec::diagnostics::latency::print_summary(print);
 }
+#endif
+
+#ifdef NSEC_TRACE
+const char dump_trace_choice_name[] PROGMEM = "Dump trace";
+
+void trace_dumped_printer(void *, Print& print, nsec::scheduling::absolute_time_ms)
+{
+	print.print(F("Trace dumped on the serial port"));
+}
+#endif
+
+#ifdef NSEC_CONSOLE
+const char sched_command_name[] PROGMEM = "sched";
+const char sched_command_help[] PROGMEM = "[reset] task run times";
+const char link_command_name[] PROGMEM = "link";
+const char link_command_help[] PROGMEM = "[fec on|off] link state and counters";
+const char fec_on_argument[] PROGMEM = "fec on";
+const char fec_off_argument[] PROGMEM = "fec off";
+const char render_command_name[] PROGMEM = "render";
+const char render_command_help[] PROGMEM = "frame statistics";
+const char storage_command_name[] PROGMEM = "storage";
+const char storage_command_help[] PROGMEM = "EEPROM configuration";
+const char ids_command_name[] PROGMEM = "ids";
+const char ids_command_help[] PROGMEM = "known badge IDs";
+const char bench_command_name[] PROGMEM = "bench";
+const char bench_command_help[] PROGMEM = "time rendering and ID lookups";
+const char power_command_name[] PROGMEM = "power";
+const char power_command_help[] PROGMEM = "power state and estimated current";
+const char active_power_state_name[] PROGMEM = "active";
+const char dimmed_power_state_name[] PROGMEM = "dimmed";
+const char display_off_power_state_name[] PROGMEM = "display off";
+const char deep_sleep_power_state_name[] PROGMEM = "deep sleep";
+// Indexed by power::manager::state.
+const char *const power_state_names[] PROGMEM = { active_power_state_name,
+						  dimmed_power_state_name,
+						  display_off_power_state_name,
+						  deep_sleep_power_state_name };
+const char crash_command_name[] PROGMEM = "crash";
+const char crash_command_help[] PROGMEM = "[clear] flight record of the last watchdog reset";
+const char clear_argument[] PROGMEM = "clear";
+#ifdef NSEC_TRACE
+const char trace_command_name[] PROGMEM = "trace";
+const char trace_command_help[] PROGMEM = "dump the trace buffer";
+#endif
+#ifdef NSEC_LATENCY_PROBE
+const char latency_command_name[] PROGMEM = "latency";
+const char latency_command_help[] PROGMEM = "dump the latency histograms";
+#endif
+#ifdef NSEC_STACK_MONITOR
+const char stack_command_name[] PROGMEM = "stack";
+const char stack_command_help[] PROGMEM = "RAM usage and stack depth per task";
+#endif
+#ifdef NSEC_LINK_BENCH
+const char link_bench_command_name[] PROGMEM = "linkbench";
+const char link_bench_command_help[] PROGMEM = "[start|both] link throughput bench";
+const char start_argument[] PROGMEM = "start";
+const char both_argument[] PROGMEM = "both";
+#endif
+#ifdef NSEC_PROFILER
+const char profile_command_name[] PROGMEM = "profile";
+const char profile_command_help[] PROGMEM = "dump and clear the PC histogram";
+#endif
+const char reset_argument[] PROGMEM = "reset";
+
+void print_hex_byte(Print& out, uint8_t value)
+{
+	if (value < 0x10) {
+		out.print('0');
+	}
+
+	out.print(value, HEX);
+}
+#endif
+
+#ifdef NSEC_LINK_BENCH
+const char link_bench_choice_name[] PROGMEM = "Link bench";
+
+void link_bench_printer(void *bench_data,
+			Print& print,
+			nsec::scheduling::absolute_time_ms current_time_ms)
+{
+	static_cast<const nc::link_bench *>(bench_data)->print_summary(print, current_time_ms);
+}
+
+void link_bench_unavailable_printer(void *, Print& print, nsec::scheduling::absolute_time_ms)
+{
+	print.print(F("Pair the badge first"));
+}
+#endif
+
+#ifdef NSEC_STACK_MONITOR
+const char ram_usage_choice_name[] PROGMEM = "RAM usage";
+
+void ram_usage_printer(void *, Print& print, nsec::scheduling::absolute_time_ms)
+{
+	nsec::diagnostics::stack_monitor::print_summary(print);
+}
+#endif
+
+#ifdef NSEC_PROFILER
+const char dump_profile_choice_name[] PROGMEM = "Profile";
+
+void profile_dumped_printer(void *, Print& print, nsec::scheduling::absolute_time_ms)
+{
+	print.print(F("Profile dumped on the serial port"));
+}
+#endif
 
 void factory_reset_confirmation_printer(void *, Print& print, nsec::scheduling::absolute_time_ms)
 {
@@ -86,39 +190,378 @@ void factory_reset_confirmation_printer(void *, Print& print, nsec::scheduling::
 
 } // anonymous namespace
 
+/*
+ * Choices of the main menu. Those of the diagnostics builds come between the badge
+ * information and the factory reset.
+ */
+const nd::menu_screen::choices::choice nr::badge::_main_menu_choice_list[] = {
+	{ as_flash_string(set_name_choice_name),
+	  { [](void *) {
+		   auto *badge = &nsec::g::the_badge;
+
+		   badge->_string_property_edit_screen.set_property(
+			   as_flash_string(set_name_prompt),
+			   badge->_user_name,
+			   sizeof(badge->_user_name));
+		   badge->set_focused_screen(badge->_string_property_edit_screen);
+	   },
+	    nullptr } },
+	{ as_flash_string(badge_info_choice_name),
+	  { [](void *) {
+		   auto *badge = &nsec::g::the_badge;
+
+		   badge->_text_screen.set_printer(
+			   nd::text_screen::text_printer{ badge_info_printer, badge });
+		   badge->set_focused_screen(badge->_text_screen);
+	   },
+	    nullptr } },
+#ifdef NSEC_LATENCY_PROBE
+	{ as_flash_string(latency_choice_name),
+	  { [](void *) {
+		   auto *badge = &nsec::g::the_badge;
+
+		   // The full histograms don't fit on the display.
+		   nsec::diagnostics::latency::dump(Serial);
+		   badge->_text_screen.set_printer(
+			   nd::text_screen::text_printer{ latency_printer, nullptr });
+		   badge->set_focused_screen(badge->_text_screen);
+	   },
+	    nullptr } },
+#endif
+#ifdef NSEC_TRACE
+	{ as_flash_string(dump_trace_choice_name),
+	  { [](void *) {
+		   auto *badge = &nsec::g::the_badge;
+
+		   ndt::dump(Serial);
+		   badge->_text_screen.set_printer(
+			   nd::text_screen::text_printer{ trace_dumped_printer, nullptr });
+		   badge->set_focused_screen(badge->_text_screen);
+	   },
+	    nullptr } },
+#endif
+#ifdef NSEC_STACK_MONITOR
+	{ as_flash_string(ram_usage_choice_name),
+	  { [](void *) {
+		   auto *badge = &nsec::g::the_badge;
+
+		   // The per-task worst cases don't fit on the display.
+		   nsec::diagnostics::stack_monitor::dump(Serial);
+		   badge->_text_screen.set_printer(
+			   nd::text_screen::text_printer{ ram_usage_printer, nullptr });
+		   badge->set_focused_screen(badge->_text_screen);
+	   },
+	    nullptr } },
+#endif
+#ifdef NSEC_LINK_BENCH
+	{ as_flash_string(link_bench_choice_name),
+	  { [](void *) {
+		   auto *badge = &nsec::g::the_badge;
+
+		   if (badge->_start_link_bench(false)) {
+			   badge->_show_link_bench();
+		   } else {
+			   badge->_text_screen.set_printer(nd::text_screen::text_printer{
+				   link_bench_unavailable_printer, nullptr });
+			   badge->set_focused_screen(badge->_text_screen);
+		   }
+	   },
+	    nullptr } },
+#endif
+#ifdef NSEC_PROFILER
+	{ as_flash_string(dump_profile_choice_name),
+	  { [](void *) {
+		   auto *badge = &nsec::g::the_badge;
+
+		   nsec::diagnostics::profiler::dump(Serial);
+		   badge->_text_screen.set_printer(
+			   nd::text_screen::text_printer{ profile_dumped_printer, nullptr });
+		   badge->set_focused_screen(badge->_text_screen);
+	   },
+	    nullptr } },
+#endif
+	{ as_flash_string(factory_reset_choice_name),
+	  { [](void *) {
+		   auto *badge = &nsec::g::the_badge;
+
+		   badge->_text_screen.set_printer(nd::text_screen::text_printer{
+			   factory_reset_confirmation_printer, badge });
+		   badge->set_focused_screen(badge->_text_screen);
+		   badge->_is_expecting_factory_reset = true;
+	   },
+	    nullptr } },
+};
+
+#ifdef NSEC_CONSOLE
+const nsec::diagnostics::console::command nr::badge::_console_commands[] PROGMEM = {
+	{ sched_command_name,
+	  sched_command_help,
+	  [](Print& out, const char *arguments) {
+		  if (!strcmp_P(arguments, reset_argument)) {
+			  nsec::diagnostics::scheduler_statistics::reset();
+			  nsec::g::the_badge._dropped_event_count = 0;
+		  } else {
+			  nsec::diagnostics::scheduler_statistics::print(out);
+			  out.print(F("dropped events: "));
+			  out.println(nsec::g::the_badge._dropped_event_count);
+		  }
+	  } },
+	{ link_command_name,
+	  link_command_help,
+	  [](Print& out, const char *arguments) {
+		  auto& network = nsec::g::the_badge._network_handler;
+		  const auto& statistics = network.statistics();
+
+		  if (!strcmp_P(arguments, fec_on_argument)) {
+			  network.set_forward_error_correction(true);
+			  return;
+		  } else if (!strcmp_P(arguments, fec_off_argument)) {
+			  network.set_forward_error_correction(false);
+			  return;
+		  }
+
+		  out.print(F("position: "));
+		  switch (network.position()) {
+		  case nc::network_handler::link_position::LEFT_MOST:
+			  out.println(F("left-most"));
+			  break;
+		  case nc::network_handler::link_position::RIGHT_MOST:
+			  out.println(F("right-most"));
+			  break;
+		  case nc::network_handler::link_position::MIDDLE:
+			  out.println(F("middle"));
+			  break;
+		  default:
+			  out.println(F("unknown"));
+			  break;
+		  }
+
+		  out.print(F("peer: "));
+		  out.print(network.peer_id());
+		  out.print(F(" of "));
+		  out.println(network.peer_count());
+		  out.print(F("sent: "));
+		  out.print(statistics.messages_sent);
+		  out.print(F(" (retransmitted: "));
+		  out.print(statistics.retransmissions);
+		  out.println(')');
+		  out.print(F("received: "));
+		  out.print(statistics.messages_received);
+		  out.print(F(" (corrupted: "));
+		  out.print(statistics.corrupted_messages);
+		  out.print(F(", corrected: "));
+		  out.print(statistics.corrected_messages);
+		  out.println(')');
+		  out.print(F("fec: "));
+		  out.print(network.is_forward_error_correction_enabled() ? F("on") : F("off"));
+		  out.print(F(" (left: "));
+		  out.print(network.is_link_coded(nc::peer_relative_position::LEFT) ? F("coded") :
+										       F("plain"));
+		  out.print(F(", right: "));
+		  out.print(network.is_link_coded(nc::peer_relative_position::RIGHT) ? F("coded") :
+											F("plain"));
+		  out.println(')');
+		  out.print(F("app sent: "));
+		  out.print(statistics.app_messages_sent);
+		  out.print(F(" (outbox full: "));
+		  out.print(statistics.outbox_overflows);
+		  out.println(')');
+		  out.print(F("app received: "));
+		  out.println(statistics.app_messages_received);
+		  out.print(F("timeouts: "));
+		  out.println(statistics.timeouts);
+		  out.print(F("topology changes: "));
+		  out.println(statistics.topology_changes);
+		  out.print(F("confirmation: p50 "));
+		  out.print(statistics.confirmation_times.percentile_ms(50));
+		  out.print(F(" ms, p90 "));
+		  out.print(statistics.confirmation_times.percentile_ms(90));
+		  out.print(F(" ms, max "));
+		  out.print(statistics.confirmation_times.max_ms());
+		  out.println(F(" ms"));
+	  } },
+	{ render_command_name,
+	  render_command_help,
+	  [](Print& out, const char *) {
+		  const auto& statistics = nsec::g::the_badge._renderer.statistics();
+
+		  out.print(F("frames: "));
+		  out.print(statistics.frame_count);
+		  out.print(F(" (flushed: "));
+		  out.print(statistics.flushed_frame_count);
+		  out.println(')');
+		  out.print(F("average: "));
+		  out.print(statistics.frame_count ?
+				    statistics.total_frame_time_us / statistics.frame_count :
+				    0);
+		  out.println(F(" us"));
+		  out.print(F("longest: "));
+		  out.print(statistics.longest_frame_us);
+		  out.println(F(" us"));
+	  } },
+	{ storage_command_name,
+	  storage_command_help,
+	  [](Print& out, const char *) {
+		  const auto& badge = nsec::g::the_badge;
+
+		  out.print(F("name: "));
+		  if (badge._is_user_name_set) {
+			  out.println(badge._user_name);
+		  } else {
+			  out.println(F("<unset>"));
+		  }
+
+		  out.print(F("level: "));
+		  out.println(badge._social_level);
+		  out.print(F("animation: "));
+		  out.println(badge._selected_animation);
+		  out.print(F("ids: "));
+		  out.print(badge._id_buffer.count());
+		  out.print(F(" of "));
+		  out.println(badge._id_buffer.capacity());
+	  } },
+	{ ids_command_name,
+	  ids_command_help,
+	  [](Print& out, const char *) {
+		  const auto& id_buffer = nsec::g::the_badge._id_buffer;
+
+		  for (uint16_t i = 0; i < id_buffer.count(); i++) {
+			  const auto id = id_buffer.item(i);
+
+			  for (int8_t shift = 24; shift >= 0; shift -= 8) {
+				  print_hex_byte(out, uint8_t(id >> shift));
+			  }
+
+			  out.println();
+		  }
+	  } },
+	{ bench_command_name,
+	  bench_command_help,
+	  [](Print& out, const char *) {
+		  auto& badge = nsec::g::the_badge;
+		  constexpr uint8_t iterations = 8;
+		  unsigned long render_time_us, flush_time_us;
+
+		  badge._renderer.benchmark(iterations, render_time_us, flush_time_us);
+
+		  // A miss scans all the stored IDs.
+		  const auto lookup_start_us = micros();
+		  badge._id_buffer.contains(0);
+		  const auto lookup_time_us = micros() - lookup_start_us;
+
+		  out.print(F("render: "));
+		  out.print(render_time_us);
+		  out.println(F(" us"));
+		  out.print(F("flush: "));
+		  out.print(flush_time_us);
+		  out.println(F(" us"));
+		  out.print(F("id lookup: "));
+		  out.print(lookup_time_us);
+		  out.println(F(" us"));
+	  } },
+	{ power_command_name,
+	  power_command_help,
+	  [](Print& out, const char *) {
+		  const auto& power_manager = nsec::g::the_badge._power_manager;
+
+		  out.print(F("inactive: "));
+		  out.print(power_manager.inactive_time_ms() / 1000);
+		  out.println(F(" s"));
+
+		  // The current state is marked.
+		  for (uint8_t i = 0; i < sizeof(power_state_names) / sizeof(*power_state_names);
+		       i++) {
+			  const auto state = nsec::power::manager::state(i);
+
+			  out.print(state == power_manager.current_state() ? '*' : ' ');
+			  out.print(as_flash_string(
+				  static_cast<const char *>(pgm_read_ptr(&power_state_names[i]))));
+			  out.print(F(": "));
+			  out.print(power_manager.estimated_current_ua(state));
+			  out.println(F(" uA"));
+		  }
+	  } },
+	{ crash_command_name,
+	  crash_command_help,
+	  [](Print& out, const char *arguments) {
+		  if (!strcmp_P(arguments, clear_argument)) {
+			  nsec::diagnostics::flight_recorder::clear();
+		  } else {
+			  nsec::diagnostics::flight_recorder::dump(out);
+		  }
+	  } },
+#ifdef NSEC_TRACE
+	{ trace_command_name,
+	  trace_command_help,
+	  [](Print& out, const char *) { ndt::dump(out); } },
+#endif
+#ifdef NSEC_LATENCY_PROBE
+	{ latency_command_name,
+	  latency_command_help,
+	  [](Print& out, const char *) { nsec::diagnostics::latency::dump(out); } },
+#endif
+#ifdef NSEC_STACK_MONITOR
+	{ stack_command_name,
+	  stack_command_help,
+	  [](Print& out, const char *) { nsec::diagnostics::stack_monitor::dump(out); } },
+#endif
+#ifdef NSEC_LINK_BENCH
+	{ link_bench_command_name,
+	  link_bench_command_help,
+	  [](Print& out, const char *arguments) {
+		  auto& badge = nsec::g::the_badge;
+		  const bool is_bidirectional = !strcmp_P(arguments, both_argument);
+
+		  if (!is_bidirectional && strcmp_P(arguments, start_argument)) {
+			  badge._link_bench.print(out, millis());
+		  } else if (badge._start_link_bench(is_bidirectional)) {
+			  out.println(F("started"));
+		  } else {
+			  out.println(F("not paired"));
+		  }
+	  } },
+#endif
+#ifdef NSEC_PROFILER
+	{ profile_command_name,
+	  profile_command_help,
+	  [](Print& out, const char *) { nsec::diagnostics::profiler::dump(out); } },
+#endif
+};
+#endif
+
 nr::badge::badge() :
 	_is_user_name_set{ false },
 	_user_name{ "" },
-	_button_watcher([](nsec::button::id id, nsec::button::event event) {
+	_button_watcher([](nsec::button::id id,
+			   nsec::button::event event,
+			   nsec::scheduling::absolute_time_ms) {
 		nsec::g::the_badge.on_button_event(id, event);
 	}),
-	_renderer{ &_focused_screen },
+	_renderer{ &_focused_screen,
+		   [](nsec::scheduling::absolute_time_ms current_time_ms) {
+			   auto& badge = nsec::g::the_badge;
+
+			   /*
+			    * A button event posts at most one UI event: the others wait in the
+			    * watcher's queue until the posted ones are dispatched.
+			    */
+			   badge._button_watcher.dispatch_events(
+				   current_time_ms, badge._events.available(event::ui_priority));
+		   } },
 	_network_handler(),
+#ifdef NSEC_LINK_BENCH
+	_link_bench{ _network_handler },
+#endif
 	_main_menu_choices(
-		[]() {
-			auto *badge = &nsec::g::the_badge;
-
-			badge->_string_property_edit_screen.set_property(
-				as_flash_string(set_name_prompt),
-				badge->_user_name,
-				sizeof(badge->_user_name));
-			badge->set_focused_screen(badge->_string_property_edit_screen);
-		},
-		[]() {
-			auto *badge = &nsec::g::the_badge;
-
-			badge->_text_screen.set_printer(
-				nd::text_screen::text_printer{ badge_info_printer, badge });
-			badge->set_focused_screen(badge->_text_screen);
-		},
-		[]() {
-			auto *badge = &nsec::g::the_badge;
-
-			badge->_text_screen.set_printer(nd::text_screen::text_printer{
-				factory_reset_confirmation_printer, badge });
-			badge->set_focused_screen(badge->_text_screen);
-			badge->_is_expecting_factory_reset = true;
-		})
+		_main_menu_choice_list,
+		uint8_t(sizeof(_main_menu_choice_list) / sizeof(*_main_menu_choice_list))),
+	_power_manager{ _renderer, _strip_animator, _network_handler, _button_watcher }
+#ifdef NSEC_CONSOLE
+	,
+	_console{ Serial,
+		  _console_commands,
+		  uint8_t(sizeof(_console_commands) / sizeof(*_console_commands)) }
+#endif
 {
 	_network_app_state(network_app_state::UNCONNECTED);
 	_id_exchanger.reset();
@@ -131,7 +574,9 @@ void nr::badge::load_config()
 {
 	eeprom_config config;
 
+	ndt::record_eeprom_access_begin(ndt::eeprom_operation::LOAD_CONFIG);
 	EEPROM.get(0, config);
+	ndt::record_eeprom_access_end(ndt::eeprom_operation::LOAD_CONFIG);
 	if (config.version_magic != config_version_magic) {
 		return;
 	}
@@ -154,7 +599,9 @@ void nr::badge::save_config() const
 	config.social_level = _social_level;
 
 	memcpy(config.name, _user_name, sizeof(config.name));
+	ndt::record_eeprom_access_begin(ndt::eeprom_operation::SAVE_CONFIG);
 	EEPROM.put(0, config);
+	ndt::record_eeprom_access_end(ndt::eeprom_operation::SAVE_CONFIG);
 }
 
 void nr::badge::factory_reset()
@@ -164,8 +611,12 @@ void nr::badge::factory_reset()
 	// Set an invalid magic.
 	config.version_magic = 1234;
 
+	// Clearing the badge ID storage takes seconds; the badge restarts right after.
+	nsec::diagnostics::flight_recorder::pause_watchdog();
+	ndt::record_eeprom_access_begin(ndt::eeprom_operation::FACTORY_RESET);
 	EEPROM.put(0, config);
 	_id_buffer.clear();
+	ndt::record_eeprom_access_end(ndt::eeprom_operation::FACTORY_RESET);
 
 	void (*so_looooong)(void) = nullptr;
 	so_looooong();
@@ -176,6 +627,11 @@ void nr::badge::setup()
 	// GPIO INIT
 	pinMode(LED_DBG, OUTPUT);
 
+#if defined(NSEC_LATENCY_PROBE) || defined(NSEC_TRACE) || defined(NSEC_CONSOLE) || \
+	defined(NSEC_STACK_MONITOR) || defined(NSEC_PROFILER)
+	Serial.begin(nsec::config::diagnostics::serial_speed);
+#endif
+
 	_button_watcher.setup();
 	_strip_animator.setup();
 	_renderer.setup();
@@ -183,6 +639,19 @@ void nr::badge::setup()
 	_network_handler.setup();
 
 	load_config();
+	nsec::diagnostics::profiler::start();
+	nsec::diagnostics::flight_recorder::start();
+}
+
+void nr::badge::check_wake_up_sources() noexcept
+{
+	_button_watcher.wake_up_on_button_activity();
+	_power_manager.check_wake_up_sources();
+}
+
+void nr::badge::idle(nsec::scheduling::relative_time_ms time_to_next_tick) noexcept
+{
+	nsec::power::manager::idle(time_to_next_tick);
 }
 
 uint8_t nr::badge::level() const noexcept
@@ -199,6 +668,7 @@ void nr::badge::on_button_event(nsec::button::id button, nsec::button::event eve
 {
 	const auto button_mask_position = static_cast<unsigned int>(button);
 
+	_power_manager.on_activity();
 	if (_network_app_state() != network_app_state::UNCONNECTED &&
 	    _network_app_state() != network_app_state::IDLE) {
 		// Don't allow button press during "modal" states.
@@ -230,7 +700,7 @@ void nr::badge::on_button_event(nsec::button::id button, nsec::button::event eve
 	}
 }
 
-void nr::badge::set_social_level(uint8_t new_level, bool save)
+void nr::badge::set_social_level(uint8_t new_level, bool save) noexcept
 {
 	new_level = constrain(new_level, 0, nsec::config::social::max_level);
 
@@ -256,8 +726,7 @@ void nr::badge::set_focused_screen(nd::screen& newly_focused_screen) noexcept
 
 void nr::badge::relase_focus_current_screen() noexcept
 {
-	if (_network_app_state() == network_app_state::EXCHANGING_IDS ||
-	    _network_app_state() == network_app_state::ANIMATE_PAIRING) {
+	if (_network_app_state() == network_app_state::ANIMATE_PAIRING) {
 		// Lock the user to the pairing screen.
 		return;
 	}
@@ -272,6 +741,9 @@ void nr::badge::relase_focus_current_screen() noexcept
 
 void nr::badge::on_disconnection() noexcept
 {
+#ifdef NSEC_LINK_BENCH
+	_link_bench.abort();
+#endif
 	_network_app_state(network_app_state::UNCONNECTED);
 	// Clear the debug LED
 	digitalWrite(LED_DBG, LOW);
@@ -286,25 +758,57 @@ void nr::badge::on_pairing_end(nc::peer_id_t our_peer_id, uint8_t peer_count) no
 	_network_app_state(network_app_state::ANIMATE_PAIRING);
 }
 
-nc::network_handler::application_message_action
-nr::badge::on_message_received(communication::message::type message_type,
-			       const uint8_t *message) noexcept
+void nr::badge::on_message_received(communication::message::type message_type,
+				    const uint8_t *message) noexcept
 {
-	if (_network_app_state() == network_app_state::EXCHANGING_IDS) {
-		_id_exchanger.new_message(*this, message_type, message);
-	} else if (_network_app_state() == network_app_state::ANIMATE_PAIRING) {
-		_pairing_animator.new_message(*this, message_type, message);
+#ifdef NSEC_LINK_BENCH
+	if (_network_app_state() == network_app_state::IDLE) {
+		_link_bench.on_message_received(message_type, message);
+		if (message_type == communication::message::type::LINK_BENCH_START) {
+			_show_link_bench();
+		}
+
+		return;
 	}
+#endif
 
-	return nc::network_handler::application_message_action::OK;
+	if (_network_app_state() != network_app_state::ANIMATE_PAIRING) {
+		return;
+	}
+
+	// The ID exchanger goes last as its completion may end the pairing.
+	_pairing_animator.new_message(*this, message_type, message);
+	_id_exchanger.new_message(*this, message_type, message);
+}
+
+void nr::badge::on_app_message_sent(communication::message::type message_type) noexcept
+{
+	if (_network_app_state() == network_app_state::ANIMATE_PAIRING) {
+		_id_exchanger.message_sent(*this, message_type);
+	}
+
+#ifdef NSEC_LINK_BENCH
+	_link_bench.on_app_message_sent(message_type);
+#endif
 }
 
-void nr::badge::on_app_message_sent() noexcept
+#ifdef NSEC_LINK_BENCH
+bool nr::badge::_start_link_bench(bool is_bidirectional) noexcept
 {
-	if (_network_app_state() == network_app_state::EXCHANGING_IDS) {
-		_id_exchanger.message_sent(*this);
+	if (_network_app_state() != network_app_state::IDLE) {
+		return false;
 	}
+
+	_link_bench.start(is_bidirectional);
+	return true;
+}
+
+void nr::badge::_show_link_bench() noexcept
+{
+	_text_screen.set_printer(nd::text_screen::text_printer{ link_bench_printer, &_link_bench });
+	set_focused_screen(_text_screen);
 }
+#endif
 
 void nr::badge::on_splash_complete() noexcept
 {
@@ -334,22 +838,20 @@ void nr::badge::_network_app_state(nr::badge::network_app_state new_state) noexc
 	_id_exchanger.reset();
 	_pairing_animator.reset();
 	_pairing_completed_animator.reset();
+	_is_id_exchange_completed = false;
+	_is_pairing_animation_completed = false;
 
 	_current_network_app_state = uint8_t(new_state);
 	switch (new_state) {
 	case network_app_state::ANIMATE_PAIRING:
-	case network_app_state::EXCHANGING_IDS:
 		_scroll_screen.set_property(F("Pairing"));
 		set_focused_screen(_scroll_screen);
 
 		// Reduce the CPU time of the renderer to reduce network errors.
 		_renderer.period_ms(16);
-		if (new_state == network_app_state::ANIMATE_PAIRING) {
-			_pairing_animator.start(*this);
-		} else {
-			_id_exchanger.start(*this);
-		}
-
+		// The animation's messages are enqueued first as they are time-sensitive.
+		_pairing_animator.start(*this);
+		_id_exchanger.start(*this);
 		break;
 	case network_app_state::ANIMATE_PAIRING_COMPLETED:
 		_pairing_completed_animator.start(*this);
@@ -373,14 +875,31 @@ nr::badge::badge_discovered_result nr::badge::on_badge_discovered(const uint8_t
 	const uint32_t id_low = (uint32_t(id[6]) << 24) | (uint32_t(id[7]) << 16) |
 		(uint32_t(id[8]) << 8) | id[9];
 
+	ndt::record_eeprom_access_begin(ndt::eeprom_operation::INSERT_BADGE_ID);
 	const auto inserted = _id_buffer.insert(id_low);
+	ndt::record_eeprom_access_end(ndt::eeprom_operation::INSERT_BADGE_ID);
+
 	return inserted ? badge_discovered_result::NEW : badge_discovered_result::ALREADY_KNOWN;
 }
 
 void nr::badge::on_badge_discovery_completed() noexcept
 {
 	_badges_discovered_last_exchange = _id_exchanger.new_badges_discovered();
-	_network_app_state(network_app_state::ANIMATE_PAIRING_COMPLETED);
+	_is_id_exchange_completed = true;
+	_show_pairing_result_if_ready();
+}
+
+void nr::badge::on_pairing_animation_completed() noexcept
+{
+	_is_pairing_animation_completed = true;
+	_show_pairing_result_if_ready();
+}
+
+void nr::badge::_show_pairing_result_if_ready() noexcept
+{
+	if (_is_id_exchange_completed && _is_pairing_animation_completed) {
+		_network_app_state(network_app_state::ANIMATE_PAIRING_COMPLETED);
+	}
 }
 
 void nr::badge::network_id_exchanger::start(nr::badge& badge) noexcept
@@ -471,9 +990,11 @@ void nr::badge::network_id_exchanger::new_message(nr::badge& badge,
 	}
 }
 
-void nr::badge::network_id_exchanger::message_sent(nr::badge& badge) noexcept
+void nr::badge::network_id_exchanger::message_sent(nr::badge& badge,
+						   nc::message::type msg_type) noexcept
 {
-	if (!_send_ours_on_next_send_complete) {
+	// Pairing animation messages are interleaved with the exchange's.
+	if (msg_type != nc::message::type::ANNOUNCE_BADGE_ID || !_send_ours_on_next_send_complete) {
 		return;
 	}
 
@@ -518,6 +1039,11 @@ nr::badge::pairing_animator::_animation_state() const noexcept
 
 void nr::badge::pairing_animator::start(nr::badge& badge) noexcept
 {
+	if (nsec::config::badge::pipelined_pairing_animation) {
+		_start_pipelined_animation(badge);
+		return;
+	}
+
 	if (badge._network_handler.position() == nc::network_handler::link_position::LEFT_MOST) {
 		_animation_state(animation_state::LIGHT_UP_UPPER_BAR);
 	} else {
@@ -533,6 +1059,82 @@ void nr::badge::pairing_animator::reset() noexcept
 	_animation_state(animation_state::DONE);
 }
 
+void nr::badge::pairing_animator::_start_pipelined_animation(nr::badge& badge) noexcept
+{
+	badge._timer.period_ms(nsec::config::badge::pipelined_pairing_animation_tick_period_ms);
+	badge._strip_animator.set_red_to_green_led_progress_bar(0);
+
+	if (badge._network_handler.position() != nc::network_handler::link_position::LEFT_MOST) {
+		_animation_state(animation_state::WAIT_MESSAGE_ANIMATION_START);
+		return;
+	}
+
+	// Leave enough time for the start message to reach the right-most badge.
+	_start_time_ms = millis() + nsec::config::badge::pairing_animation_start_lead_time_ms +
+		nsec::config::badge::pairing_animation_start_hop_delay_ms *
+			(badge._network_handler.peer_count() - 1);
+	_animation_state(animation_state::PIPELINED_ANIMATION);
+	_send_start_message(badge);
+}
+
+void nr::badge::pairing_animator::_send_start_message(nr::badge& badge) noexcept
+{
+	const nc::message::pairing_animation_start msg = {
+		.start_delay_ms = int16_t(_start_time_ms - millis() -
+					  nsec::config::badge::pairing_animation_start_hop_delay_ms)
+	};
+
+	badge._network_handler.enqueue_app_message(
+		nc::peer_relative_position::RIGHT,
+		uint8_t(nc::message::type::PAIRING_ANIMATION_START),
+		reinterpret_cast<const uint8_t *>(&msg));
+}
+
+/*
+ * The upper bars light up from the left-most badge to the right-most one during the
+ * first half of the animation, and the lower bars from the right-most badge to the
+ * left-most one during the second half. Each badge derives its part from its position
+ * in the chain and the time elapsed since the common start time.
+ */
+void nr::badge::pairing_animator::_pipelined_animation_tick(
+	nr::badge& badge, nsec::scheduling::absolute_time_ms current_time_ms) noexcept
+{
+	constexpr auto duration_ms = nsec::config::badge::pipelined_pairing_animation_duration_ms;
+	constexpr auto bar_duration_ms = duration_ms / 2;
+	constexpr uint8_t leds_per_bar = 8;
+
+	if (long(current_time_ms - _start_time_ms) < 0) {
+		return;
+	}
+
+	const auto elapsed_ms = current_time_ms - _start_time_ms;
+
+	if (elapsed_ms >= duration_ms) {
+		badge._strip_animator.set_red_to_green_led_progress_bar(2 * leds_per_bar);
+		_animation_state(animation_state::DONE);
+		return;
+	}
+
+	const auto peer_count = badge._network_handler.peer_count();
+	const auto peer_id = badge._network_handler.peer_id();
+	const bool is_lighting_lower_bar = elapsed_ms >= bar_duration_ms;
+	// LEDs lit, across the chain, in the bar being lit.
+	const uint16_t chain_lit_led_count =
+		uint32_t(elapsed_ms - (is_lighting_lower_bar ? bar_duration_ms : 0)) *
+		leds_per_bar * peer_count / bar_duration_ms;
+	const uint8_t badges_lit_before_us =
+		is_lighting_lower_bar ? peer_count - 1 - peer_id : peer_id;
+	const uint8_t lit_led_count = (is_lighting_lower_bar ? leds_per_bar : 0) +
+		constrain(int(chain_lit_led_count) - leds_per_bar * badges_lit_before_us,
+			  0,
+			  int(leds_per_bar));
+
+	if (lit_led_count != _state_counter) {
+		_state_counter = lit_led_count;
+		badge._strip_animator.set_red_to_green_led_progress_bar(lit_led_count);
+	}
+}
+
 nr::badge::animation_task::animation_task() : periodic_task(250)
 {
 	nsec::g::the_scheduler.schedule_task(*this);
@@ -543,23 +1145,179 @@ void nr::badge::animation_task::run(nsec::scheduling::absolute_time_ms current_t
 	nsec::g::the_badge.tick(current_time_ms);
 }
 
+nr::badge::event_dispatch_task::event_dispatch_task() :
+	periodic_task(nsec::config::badge::event_dispatch_period_ms), _is_idle{ true }
+{
+}
+
+void nr::badge::event_dispatch_task::wake_up() noexcept
+{
+	if (!_is_idle) {
+		return;
+	}
+
+	_is_idle = false;
+	revive();
+	nsec::g::the_scheduler.schedule_task(*this);
+}
+
+void nr::badge::event_dispatch_task::run(nsec::scheduling::absolute_time_ms) noexcept
+{
+	auto& events = nsec::g::the_badge._events;
+	auto handler = [](const event& pending_event) {
+		nsec::g::the_badge._handle_event(pending_event);
+	};
+
+	events.dispatch(handler, nsec::config::badge::max_events_dispatched_per_tick);
+	if (events.empty()) {
+		_is_idle = true;
+		kill();
+	}
+}
+
+nr::badge::event nr::badge::event::disconnection() noexcept
+{
+	event new_event;
+
+	new_event.event_type = type::DISCONNECTION;
+	return new_event;
+}
+
+nr::badge::event nr::badge::event::pairing_end(nc::peer_id_t our_peer_id,
+					       uint8_t peer_count) noexcept
+{
+	event new_event;
+
+	new_event.event_type = type::PAIRING_END;
+	new_event.pairing.our_peer_id = our_peer_id;
+	new_event.pairing.peer_count = peer_count;
+	return new_event;
+}
+
+nr::badge::event nr::badge::event::message_received(nc::message::type message_type,
+						    const uint8_t *payload) noexcept
+{
+	event new_event;
+
+	new_event.event_type = type::MESSAGE_RECEIVED;
+	new_event.message.message_type = message_type;
+	memcpy(new_event.message.payload, payload, sizeof(new_event.message.payload));
+	return new_event;
+}
+
+nr::badge::event nr::badge::event::app_message_sent(nc::message::type message_type) noexcept
+{
+	event new_event;
+
+	new_event.event_type = type::APP_MESSAGE_SENT;
+	new_event.message.message_type = message_type;
+	return new_event;
+}
+
+nr::badge::event nr::badge::event::release_focus() noexcept
+{
+	event new_event;
+
+	new_event.event_type = type::RELEASE_FOCUS;
+	return new_event;
+}
+
+nr::badge::event nr::badge::event::splash_complete() noexcept
+{
+	event new_event;
+
+	new_event.event_type = type::SPLASH_COMPLETE;
+	return new_event;
+}
+
+nr::badge::event nr::badge::event::show_badge_info() noexcept
+{
+	event new_event;
+
+	new_event.event_type = type::SHOW_BADGE_INFO;
+	return new_event;
+}
+
+nr::badge::event
+nr::badge::event::cycle_selected_animation(cycle_animation_direction direction) noexcept
+{
+	event new_event;
+
+	new_event.event_type = type::CYCLE_SELECTED_ANIMATION;
+	new_event.cycle.direction = direction;
+	return new_event;
+}
+
+void nr::badge::post_event(const event& new_event) noexcept
+{
+	if (!_events.post(new_event)) {
+		// Not expected given the size of the queues (see config.hpp).
+#ifdef NSEC_CONSOLE
+		if (_dropped_event_count != UINT16_MAX) {
+			_dropped_event_count++;
+		}
+#endif
+		return;
+	}
+
+	_event_dispatcher.wake_up();
+}
+
+void nr::badge::_handle_event(const event& posted_event) noexcept
+{
+	if (posted_event.event_type == event::type::DISCONNECTION ||
+	    posted_event.event_type == event::type::PAIRING_END ||
+	    posted_event.event_type == event::type::MESSAGE_RECEIVED) {
+		_power_manager.on_activity();
+	}
+
+	switch (posted_event.event_type) {
+	case event::type::DISCONNECTION:
+		on_disconnection();
+		break;
+	case event::type::PAIRING_END:
+		on_pairing_end(posted_event.pairing.our_peer_id, posted_event.pairing.peer_count);
+		break;
+	case event::type::MESSAGE_RECEIVED:
+		on_message_received(posted_event.message.message_type,
+				    posted_event.message.payload);
+		break;
+	case event::type::APP_MESSAGE_SENT:
+		on_app_message_sent(posted_event.message.message_type);
+		break;
+	case event::type::RELEASE_FOCUS:
+		relase_focus_current_screen();
+		break;
+	case event::type::SPLASH_COMPLETE:
+		on_splash_complete();
+		break;
+	case event::type::SHOW_BADGE_INFO:
+		show_badge_info();
+		break;
+	case event::type::CYCLE_SELECTED_ANIMATION:
+		cycle_selected_animation(posted_event.cycle.direction);
+		break;
+	}
+}
+
 void nr::badge::pairing_animator::tick(nsec::scheduling::absolute_time_ms current_time_ms) noexcept
 {
 	switch (_animation_state()) {
 	case animation_state::DONE:
-		if (_state_counter < 8 &&
-		    nsec::g::the_badge._network_handler.position() ==
-			    nc::network_handler::link_position::LEFT_MOST) {
-			// Left-most badge waits for the neighbor to transition states.
+		// Notify the badge once.
+		if (_state_counter == 0) {
 			_state_counter++;
-		} else {
-			nsec::g::the_badge._network_app_state(
-				nr::badge::network_app_state::EXCHANGING_IDS);
+			nsec::g::the_badge.on_pairing_animation_completed();
 		}
+
 		break;
 	case animation_state::WAIT_MESSAGE_ANIMATION_PART_1:
 	case animation_state::WAIT_MESSAGE_ANIMATION_PART_2:
 	case animation_state::WAIT_DONE:
+	case animation_state::WAIT_MESSAGE_ANIMATION_START:
+		break;
+	case animation_state::PIPELINED_ANIMATION:
+		_pipelined_animation_tick(nsec::g::the_badge, current_time_ms);
 		break;
 	case animation_state::LIGHT_UP_UPPER_BAR:
 		nsec::g::the_badge._strip_animator.set_red_to_green_led_progress_bar(
@@ -626,6 +1384,24 @@ void nr::badge::pairing_animator::new_message(nr::badge& badge,
 
 		_animation_state(animation_state::DONE);
 		break;
+	case nc::message::type::PAIRING_ANIMATION_START:
+	{
+		if (_animation_state() != animation_state::WAIT_MESSAGE_ANIMATION_START) {
+			break;
+		}
+
+		const auto *start_msg =
+			reinterpret_cast<const nc::message::pairing_animation_start *>(payload);
+
+		_start_time_ms = millis() + start_msg->start_delay_ms;
+		_animation_state(animation_state::PIPELINED_ANIMATION);
+		if (badge._network_handler.position() !=
+		    nc::network_handler::link_position::RIGHT_MOST) {
+			_send_start_message(badge);
+		}
+
+		break;
+	}
 	default:
 		break;
 	}
@@ -652,21 +1428,18 @@ void nr::badge::pairing_completed_animator::start(nr::badge& badge) noexcept
 		badge._badges_discovered_last_exchange > 0 ?
 			nl::strip_animator::pairing_completed_animation_type::HAPPY_CLOWN_BARF :
 			nl::strip_animator::pairing_completed_animation_type::NO_NEW_FRIENDS);
-	memset(current_message, 0, sizeof(current_message));
-
 	// format current msg
-	formatter message_formatter(current_message);
+	nsec::formatter message_formatter(current_message);
 	if (badge._badges_discovered_last_exchange > 0) {
-		message_formatter.print(badge._badges_discovered_last_exchange);
+		message_formatter.decimal(badge._badges_discovered_last_exchange);
 	} else {
-		message_formatter.print(F("No"));
+		message_formatter.append(F("No"));
 	}
 
-	message_formatter.print(F(" "));
-	message_formatter.print(F("new badge"));
+	message_formatter.append(F(" new badge"));
 	if (badge._badges_discovered_last_exchange > 1 ||
 	    badge._badges_discovered_last_exchange == 0) {
-		message_formatter.print(F("s"));
+		message_formatter.append('s');
 	}
 
 	badge._scroll_screen.set_property(current_message);
@@ -699,14 +1472,12 @@ void nr::badge::pairing_completed_animator::tick(
 				new_level,
 				false);
 
-			memset(current_message, 0, sizeof(current_message));
-
-			formatter message_formatter(current_message);
-			message_formatter.print(F("Level "));
-			message_formatter.print(int(new_level));
-			message_formatter.print(F(" (+"));
-			message_formatter.print(int(new_level - badge._social_level));
-			message_formatter.print(F(")"));
+			nsec::formatter message_formatter(current_message);
+			message_formatter.append(F("Level "))
+				.decimal(new_level)
+				.append(F(" (+"))
+				.decimal(int16_t(new_level - badge._social_level))
+				.append(')');
 			badge._scroll_screen.set_property(current_message);
 		} else {
 			badge.apply_score_change(badge._badges_discovered_last_exchange);
@@ -14,7 +14,9 @@
 #include <stdint.h>
 
 namespace nsec::config::scheduler {
-constexpr unsigned int max_scheduled_task_count = 10;
+// The console, the splash screen and the name prompt bring the task count to 10, the link bench
+// to 11: keep a margin.
+constexpr unsigned int max_scheduled_task_count = 12;
 }
 
 namespace nsec::config::social {
@@ -37,6 +39,8 @@ constexpr nsec::scheduling::relative_time_ms polling_period_ms = 10;
 
 // How many ticks a button's state must be observed in to trigger.
 constexpr uint8_t debounce_ticks = 2;
+// Debounce ticks are counted on two bits.
+static_assert(debounce_ticks >= 1 && debounce_ticks <= 3);
 
 // Must be multiples of the polling period.
 constexpr nsec::scheduling::relative_time_ms button_down_first_repeat_delay_ms = 500;
@@ -44,6 +48,18 @@ static_assert(button_down_first_repeat_delay_ms % polling_period_ms == 0);
 
 constexpr nsec::scheduling::relative_time_ms button_down_repeat_delay_ms = 30;
 static_assert(button_down_repeat_delay_ms % polling_period_ms == 0);
+static_assert(button_down_first_repeat_delay_ms / polling_period_ms <= UINT8_MAX);
+
+// Analog-only button pins (OK and CANCEL on the ATmega328P) read below this value when pressed.
+constexpr int analog_button_pressed_threshold = 512;
+
+// Polling stops once all buttons have been released for that long (until the next press).
+constexpr nsec::scheduling::relative_time_ms idle_time_before_sleep_ms = 1000;
+static_assert(idle_time_before_sleep_ms % polling_period_ms == 0);
+static_assert(idle_time_before_sleep_ms / polling_period_ms <= UINT8_MAX);
+
+// Events detected but not yet handled by the UI. Must be a power of two.
+constexpr uint8_t event_queue_length = 8;
 
 } // namespace nsec::config::button
 
@@ -57,6 +73,8 @@ constexpr uint8_t pairing_font_size = 3;
 // Default font.
 constexpr uint8_t font_base_width = 6;
 constexpr uint8_t font_base_height = 8;
+// Characters of a line of the text screen, in the default font, including the terminator.
+constexpr uint8_t text_line_length = SCREEN_WIDTH / font_base_width + 1;
 
 constexpr nsec::scheduling::absolute_time_ms prompt_cycle_time = 2000;
 
@@ -69,7 +87,7 @@ constexpr size_t protocol_max_message_size = 16;
 constexpr unsigned int software_serial_speed = 38400;
 /*
 * Applications may define messages >= application_message_type_range_begin.
-* IDs under this range are reserved by the wire protocol.
+* IDs under this range are reserved by the wire protocol, as is 31 (see network_handler.cpp).
 */
 constexpr uint8_t application_message_type_range_begin = 10;
 
@@ -82,14 +100,153 @@ constexpr unsigned int serial_rx_pin_right = SIG_R2;
 constexpr unsigned int serial_tx_pin_right = SIG_R1;
 
 constexpr nsec::scheduling::relative_time_ms network_handler_base_period_ms = 60;
+/*
+ * While connected, incoming messages are assembled and acknowledged at this period; the wire
+ * protocol steps at the base period, or as soon as a message or a reply is received.
+ */
+constexpr nsec::scheduling::relative_time_ms network_handler_message_poll_period_ms = 4;
 constexpr nsec::scheduling::relative_time_ms network_handler_timeout_ms = 10000;
 constexpr nsec::scheduling::relative_time_ms network_handler_retransmit_timeout_ms =
 	6 * network_handler_base_period_ms;
 
+// Application messages waiting to be sent. Must be a power of two.
+constexpr uint8_t app_message_outbox_length = 4;
+
+// Offer forward error correction to the neighbours (see network_handler.hpp).
+constexpr bool forward_error_correction_enabled = true;
+
+// Confirmation time histogram of the link statistics (see histogram.hpp).
+constexpr uint8_t confirmation_time_histogram_bucket_width_ms = 8;
+constexpr uint8_t confirmation_time_histogram_bucket_count = 20;
+
 } // namespace nsec::communication
 
+namespace nsec::config::led {
+/*
+ * Estimated current draw of a LED: each color channel draws up to
+ * channel_full_scale_current_ma (proportionally to its value) on top of the LED's idle current.
+ */
+constexpr uint8_t channel_full_scale_current_ma = 20;
+constexpr uint8_t led_idle_current_ma = 1;
+
+// The LEDs are dimmed when their estimated current draw exceeds this budget.
+constexpr uint16_t current_budget_ma = 150;
+// Maximal change of the dimming scale (out of 255) per frame while dimming and recovering.
+constexpr uint8_t power_limit_dim_step = 16;
+constexpr uint8_t power_limit_recovery_step = 2;
+} // namespace nsec::config::led
+
+namespace nsec::config::power {
+/*
+ * Inactivity before each power state. Button presses, application messages and changes of
+ * the connections are activity; deep sleep is never entered while connected.
+ */
+constexpr nsec::scheduling::absolute_time_ms dim_delay_ms = 30000;
+constexpr nsec::scheduling::absolute_time_ms display_off_delay_ms = 120000;
+constexpr nsec::scheduling::absolute_time_ms deep_sleep_delay_ms = 600000;
+constexpr nsec::scheduling::relative_time_ms manager_period_ms = 1000;
+
+constexpr nsec::scheduling::relative_time_ms dimmed_refresh_period_ms = 50;
+// Scale (out of 255) of the LEDs' frames while dimmed.
+constexpr uint8_t dimmed_led_scale = 64;
+
+/*
+ * Estimated supply current of the parts, in µA at 3.3 V (typical datasheet values). The
+ * MCU is idle between ticks, which is most of the time. The LEDs' current is estimated by
+ * the strip animator, on top of their idle current (see config::led).
+ */
+constexpr uint16_t mcu_idle_current_ua = 1000;
+constexpr uint16_t mcu_power_down_current_ua = 20;
+constexpr uint16_t display_on_current_ua = 8000;
+constexpr uint16_t display_dimmed_current_ua = 2500;
+constexpr uint16_t display_off_current_ua = 10;
+} // namespace nsec::config::power
+
 namespace nsec::config::badge {
 constexpr unsigned int pairing_animation_time_per_led_progress_bar_ms = 1000;
+
+/*
+ * Rather than lighting their bars one after the other, the badges of a chain play their
+ * part of a chain-wide animation, of constant duration, from a start time broadcast by
+ * the left-most badge.
+ */
+constexpr bool pipelined_pairing_animation = true;
+constexpr nsec::scheduling::relative_time_ms pipelined_pairing_animation_duration_ms = 8000;
+constexpr nsec::scheduling::relative_time_ms pipelined_pairing_animation_tick_period_ms = 50;
+// Estimated time for the start message to reach the next badge.
+constexpr nsec::scheduling::relative_time_ms pairing_animation_start_hop_delay_ms =
+	3 * nsec::config::communication::network_handler_base_period_ms;
+// Delay before the start of the animation, on top of the start message's propagation.
+constexpr nsec::scheduling::relative_time_ms pairing_animation_start_lead_time_ms = 250;
+
+/*
+ * Events posted to the badge, per priority. Must be a power of two. Sized for the events
+ * posted between two runs of the event dispatch task:
+ *   - network: a run of the network handler posts at most one, and the handler runs less
+ *     often than the dispatch task. Enqueuing an application message towards a neighbour
+ *     that went away posts one more, a disconnection.
+ *   - UI: the renderer forwards no more button events than there is room for, and the splash
+ *     screen's timer posts the only other one, while the buttons post none.
+ * A full queue drops the event (see badge::post_event()).
+ */
+constexpr uint8_t event_queue_length = 4;
+// Events dispatched per run of the event dispatch task, which runs every
+// event_dispatch_period_ms while events are pending.
+constexpr uint8_t max_events_dispatched_per_tick = 2;
+constexpr nsec::scheduling::relative_time_ms event_dispatch_period_ms = 1;
+static_assert(nsec::config::communication::network_handler_message_poll_period_ms >=
+		      event_dispatch_period_ms,
+	      "The network events must be dispatched as fast as they are posted");
+static_assert(event_queue_length >= 2 && max_events_dispatched_per_tick >= 2,
+	      "Two network events can be posted between two runs of the dispatch task");
 } // namespace nsec::badge
 
+namespace nsec::config::link_bench {
+// Only used by the link bench builds (see include/network/link_bench.hpp).
+constexpr uint8_t duration_s = 20;
+// Frames kept waiting in the outbox, at most communication::app_message_outbox_length. A single
+// message is sent per token, so more frames only add queueing to the round trip times.
+constexpr uint8_t window = 1;
+constexpr nsec::scheduling::relative_time_ms period_ms = 20;
+// The bench fails if the neighbour's report doesn't arrive in time.
+constexpr nsec::scheduling::relative_time_ms report_timeout_ms = 5000;
+// Round trip time histogram (see histogram.hpp), covering a few token round trips.
+constexpr uint8_t rtt_histogram_bucket_width_ms = 100;
+constexpr uint8_t rtt_histogram_bucket_count = 20;
+} // namespace nsec::config::link_bench
+
+namespace nsec::config::flight_recorder {
+// Events (6 bytes each) kept across resets in .noinit RAM; the oldest are overwritten.
+constexpr uint8_t event_count = 16;
+// Task runs lasting at least this long are recorded.
+constexpr uint8_t slow_task_run_ms = 50;
+} // namespace nsec::config::flight_recorder
+
+namespace nsec::config::diagnostics {
+// Only used by the diagnostics builds (see include/diagnostics).
+constexpr unsigned long serial_speed = 115200;
+
+// Latency histograms cover [0, bucket_count * bucket_width_ms[, plus one bucket for the rest.
+constexpr uint8_t latency_histogram_bucket_width_ms = 8;
+constexpr uint8_t latency_histogram_bucket_count = 16;
+
+// Trace records (6 bytes each) kept in RAM; the oldest are overwritten.
+constexpr uint8_t trace_buffer_record_count = 48;
+
+// Console input is consumed in bounded chunks so that it never delays the other tasks.
+constexpr nsec::scheduling::relative_time_ms console_period_ms = 50;
+constexpr uint8_t console_max_bytes_per_tick = 16;
+// Longest command line, including the terminator.
+constexpr uint8_t console_line_length = 32;
+
+// One task run out of stack_sample_period has its stack depth measured.
+constexpr uint8_t stack_sample_period = 16;
+
+// The profiler's histogram has profiler_bucket_count buckets of 1 << profiler_bucket_shift
+// bytes of flash (2 bytes of RAM each).
+constexpr unsigned int profiler_sample_rate_hz = 1000;
+constexpr uint8_t profiler_bucket_count = 64;
+constexpr uint8_t profiler_bucket_shift = 9;
+} // namespace nsec::config::diagnostics
+
 #endif // NSEC_CONFIG_HPP
@@ -0,0 +1,202 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "diagnostics/console.hpp"
+#include "globals.hpp"
+
+#include <Arduino.h>
+
+#ifdef NSEC_CONSOLE
+
+namespace nd = nsec::diagnostics;
+namespace ns = nsec::scheduling;
+
+namespace {
+const char help_command_name[] PROGMEM = "help";
+const char line_too_long_message[] PROGMEM = "Line too long";
+const char unknown_command_message[] PROGMEM = "Unknown command, try \"help\"";
+
+const __FlashStringHelper *as_flash_string(const char *str)
+{
+	return static_cast<const __FlashStringHelper *>(static_cast<const void *>(str));
+}
+
+struct {
+	unsigned long run_count;
+	unsigned long busy_time_us;
+	// Start of the measurement period.
+	unsigned long since_us;
+	// Start of the task being run.
+	unsigned long run_start_us;
+	uint16_t longest_run_us;
+	// Address of the task which ran the longest.
+	uint16_t longest_run_task;
+} scheduler_activity;
+} // anonymous namespace
+
+nd::console::console(Stream& stream, const command *commands, uint8_t command_count) noexcept :
+	periodic_task(nsec::config::diagnostics::console_period_ms),
+	_stream{ stream },
+	_commands{ commands },
+	_command_count{ command_count },
+	_line_length{ 0 },
+	_is_line_too_long{ false }
+{
+	nsec::g::the_scheduler.schedule_task(*this);
+}
+
+void nd::console::run(ns::absolute_time_ms) noexcept
+{
+	for (uint8_t i = 0; i < nsec::config::diagnostics::console_max_bytes_per_tick &&
+	     _stream.available() > 0;
+	     i++) {
+		const char c = char(_stream.read());
+
+		switch (c) {
+		case '\r':
+		case '\n':
+			if (_is_line_too_long) {
+				_stream.println(as_flash_string(line_too_long_message));
+				_print_prompt();
+			} else if (_line_length != 0) {
+				_line[_line_length] = '\0';
+				_execute_line();
+				_print_prompt();
+			}
+
+			_line_length = 0;
+			_is_line_too_long = false;
+			break;
+		case '\b':
+		case 0x7f:
+			if (_line_length != 0) {
+				_line_length--;
+			}
+
+			break;
+		default:
+			// Keep room for the terminator.
+			if (_line_length + 1 < int(sizeof(_line))) {
+				_line[_line_length++] = c;
+			} else {
+				_is_line_too_long = true;
+			}
+
+			break;
+		}
+	}
+}
+
+void nd::console::_execute_line() noexcept
+{
+	char *name = _line;
+
+	while (*name == ' ') {
+		name++;
+	}
+
+	char *arguments = strchr(name, ' ');
+
+	if (arguments) {
+		*arguments++ = '\0';
+		while (*arguments == ' ') {
+			arguments++;
+		}
+	} else {
+		arguments = name + strlen(name);
+	}
+
+	if (*name == '\0') {
+		return;
+	}
+
+	if (!strcmp_P(name, help_command_name)) {
+		_print_help();
+		return;
+	}
+
+	for (uint8_t i = 0; i < _command_count; i++) {
+		command entry;
+
+		memcpy_P(&entry, &_commands[i], sizeof(entry));
+		if (!strcmp_P(name, entry.name)) {
+			entry.handler(_stream, arguments);
+			return;
+		}
+	}
+
+	_stream.println(as_flash_string(unknown_command_message));
+}
+
+void nd::console::_print_help() noexcept
+{
+	for (uint8_t i = 0; i < _command_count; i++) {
+		command entry;
+
+		memcpy_P(&entry, &_commands[i], sizeof(entry));
+		_stream.print(as_flash_string(entry.name));
+		_stream.print(F(": "));
+		_stream.println(as_flash_string(entry.help));
+	}
+}
+
+void nd::console::_print_prompt() noexcept
+{
+	_stream.print(F("> "));
+}
+
+void nd::scheduler_statistics::on_task_run_begin(const ns::task&) noexcept
+{
+	scheduler_activity.run_start_us = micros();
+}
+
+void nd::scheduler_statistics::on_task_run_end(const ns::task& task) noexcept
+{
+	const auto run_time_us = micros() - scheduler_activity.run_start_us;
+
+	scheduler_activity.run_count++;
+	scheduler_activity.busy_time_us += run_time_us;
+	if (run_time_us > scheduler_activity.longest_run_us) {
+		scheduler_activity.longest_run_us = run_time_us < UINT16_MAX ? run_time_us :
+									       UINT16_MAX;
+		scheduler_activity.longest_run_task = uint16_t(uintptr_t(&task));
+	}
+}
+
+void nd::scheduler_statistics::print(Print& out)
+{
+	const auto elapsed_us = micros() - scheduler_activity.since_us;
+	const auto elapsed_us_per_percent = elapsed_us / 100;
+
+	out.print(F("runs: "));
+	out.println(scheduler_activity.run_count);
+	out.print(F("busy: "));
+	out.print(scheduler_activity.busy_time_us);
+	out.print(F(" us of "));
+	out.print(elapsed_us);
+	out.print(F(" us ("));
+	out.print(elapsed_us_per_percent ?
+			  scheduler_activity.busy_time_us / elapsed_us_per_percent :
+			  0);
+	out.println(F("%)"));
+	out.print(F("longest run: "));
+	out.print(scheduler_activity.longest_run_us);
+	out.print(F(" us (task 0x"));
+	out.print(scheduler_activity.longest_run_task, HEX);
+	out.println(')');
+}
+
+void nd::scheduler_statistics::reset() noexcept
+{
+	// Likely called by a task: keep the start of its run.
+	const auto run_start_us = scheduler_activity.run_start_us;
+
+	scheduler_activity = {};
+	scheduler_activity.run_start_us = run_start_us;
+	scheduler_activity.since_us = micros();
+}
+
+#endif // NSEC_CONSOLE
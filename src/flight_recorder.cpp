@@ -0,0 +1,293 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "config.hpp"
+#include "diagnostics/flight_recorder.hpp"
+#include "formatter.hpp"
+
+#include <Arduino.h>
+#include <avr/wdt.h>
+
+namespace nfr = nsec::diagnostics::flight_recorder;
+namespace ndt = nsec::diagnostics::trace;
+namespace ns = nsec::scheduling;
+
+namespace {
+constexpr uint8_t max_event_count = nsec::config::flight_recorder::event_count;
+// Tells an initialized record apart from the content of the RAM at power-on.
+constexpr uint16_t record_magic = 0xF17E;
+// The longest task runs, EEPROM writes, last a few hundred ms.
+constexpr uint8_t watchdog_timeout = WDTO_2S;
+
+struct event {
+	// Low 16 bits of millis().
+	uint16_t time_ms;
+	uint8_t id;
+	uint8_t arg0;
+	uint16_t arg1;
+} __attribute__((packed));
+
+static_assert(sizeof(event) == 6, "Flight recorder events are 6 bytes long");
+
+struct flight_record {
+	uint16_t magic;
+	bool is_preserved;
+	uint8_t watchdog_reset_count;
+	// Address of the task being run, 0 between task runs.
+	uint16_t running_task;
+	uint16_t last_task;
+	// Time of the last task run or event, which the events' times are relative to.
+	uint32_t last_update_ms;
+	// Index of the next event to write and number of valid events (the oldest are
+	// overwritten).
+	uint8_t next_event_index;
+	uint8_t event_count;
+	event events[max_event_count];
+};
+
+#ifdef __AVR__
+// Left alone by the C runtime's initialization.
+#define NSEC_NOINIT __attribute__((section(".noinit")))
+#else
+#define NSEC_NOINIT
+#endif
+
+flight_record persistent_record NSEC_NOINIT;
+// MCUSR at boot, as the register is cleared to detect the next reset's cause.
+uint8_t reset_flags NSEC_NOINIT;
+unsigned long task_run_start_ms;
+
+const char power_on_reset_name[] PROGMEM = "power-on";
+const char external_reset_name[] PROGMEM = "external";
+const char brown_out_reset_name[] PROGMEM = "brown-out";
+const char watchdog_reset_name[] PROGMEM = "watchdog";
+const char software_reset_name[] PROGMEM = "software";
+// Indexed by reset_cause.
+const char *const reset_cause_names[] PROGMEM = { power_on_reset_name,
+						  external_reset_name,
+						  brown_out_reset_name,
+						  watchdog_reset_name,
+						  software_reset_name };
+
+#define NSEC_FLIGHT_RECORDER_TRACEPOINT_NAME(name, arg0_name, arg1_name) \
+	const char name##_name[] PROGMEM = #name;
+NSEC_TRACE_TRACEPOINTS(NSEC_FLIGHT_RECORDER_TRACEPOINT_NAME)
+#undef NSEC_FLIGHT_RECORDER_TRACEPOINT_NAME
+
+#define NSEC_FLIGHT_RECORDER_TRACEPOINT_NAME_ENTRY(name, arg0_name, arg1_name) name##_name,
+const char *const tracepoint_names[] PROGMEM = { NSEC_TRACE_TRACEPOINTS(
+	NSEC_FLIGHT_RECORDER_TRACEPOINT_NAME_ENTRY) };
+#undef NSEC_FLIGHT_RECORDER_TRACEPOINT_NAME_ENTRY
+
+const __FlashStringHelper *as_flash_string(const char *str)
+{
+	return static_cast<const __FlashStringHelper *>(static_cast<const void *>(str));
+}
+
+void start_new_record() noexcept
+{
+	memset(&persistent_record, 0, sizeof(persistent_record));
+	persistent_record.magic = record_magic;
+}
+
+/*
+ * Decide what becomes of the previous boot's record. Runs before .data and .bss are
+ * initialized, so it may only use .noinit variables.
+ */
+__attribute__((noinline)) void capture_reset() noexcept
+{
+	reset_flags = MCUSR;
+	MCUSR = 0;
+	// After resetting the MCU, the watchdog remains enabled at its shortest timeout.
+	wdt_disable();
+
+	if (persistent_record.magic != record_magic || (reset_flags & _BV(PORF))) {
+		start_new_record();
+	} else if (reset_flags & _BV(WDRF)) {
+		persistent_record.is_preserved = true;
+		if (persistent_record.watchdog_reset_count < UINT8_MAX) {
+			persistent_record.watchdog_reset_count++;
+		}
+	} else if (!persistent_record.is_preserved) {
+		start_new_record();
+	}
+}
+
+#ifdef __AVR__
+__attribute__((naked, used, section(".init3"))) void capture_reset_on_boot()
+{
+	capture_reset();
+}
+#endif
+
+void print_task(Print& print, uint16_t task)
+{
+	if (task) {
+		print.print(F("0x"));
+		print.println(task, HEX);
+	} else {
+		print.println(F("none"));
+	}
+}
+} // anonymous namespace
+
+void nfr::start() noexcept
+{
+#ifndef __AVR__
+	// No init sections on the host.
+	capture_reset();
+#endif
+	wdt_enable(watchdog_timeout);
+}
+
+void nfr::feed_watchdog() noexcept
+{
+	wdt_reset();
+}
+
+void nfr::pause_watchdog() noexcept
+{
+	wdt_disable();
+}
+
+void nfr::resume_watchdog() noexcept
+{
+	wdt_enable(watchdog_timeout);
+}
+
+void nfr::record(ndt::tracepoint id, uint8_t arg0, uint16_t arg1) noexcept
+{
+	if (persistent_record.is_preserved) {
+		return;
+	}
+
+	const auto now_ms = millis();
+	auto& new_event = persistent_record.events[persistent_record.next_event_index];
+
+	new_event.time_ms = uint16_t(now_ms);
+	new_event.id = uint8_t(id);
+	new_event.arg0 = arg0;
+	new_event.arg1 = arg1;
+
+	persistent_record.last_update_ms = now_ms;
+	persistent_record.next_event_index =
+		persistent_record.next_event_index + 1 == max_event_count ?
+			0 :
+			persistent_record.next_event_index + 1;
+	if (persistent_record.event_count < max_event_count) {
+		persistent_record.event_count++;
+	}
+}
+
+void nfr::on_task_run_begin(const ns::task& task) noexcept
+{
+	if (persistent_record.is_preserved) {
+		return;
+	}
+
+	task_run_start_ms = millis();
+	persistent_record.running_task = uint16_t(uintptr_t(&task));
+	persistent_record.last_update_ms = task_run_start_ms;
+}
+
+void nfr::on_task_run_end(const ns::task& task) noexcept
+{
+	if (persistent_record.is_preserved) {
+		return;
+	}
+
+	const auto task_address = uint16_t(uintptr_t(&task));
+	const auto run_time_ms = millis() - task_run_start_ms;
+
+	persistent_record.running_task = 0;
+	persistent_record.last_task = task_address;
+	if (run_time_ms >= nsec::config::flight_recorder::slow_task_run_ms) {
+		ndt::record(ndt::tracepoint::TASK_RUN_SLOW,
+			    run_time_ms < UINT8_MAX ? run_time_ms : UINT8_MAX,
+			    task_address);
+	}
+}
+
+nfr::reset_cause nfr::last_reset_cause() noexcept
+{
+	if (reset_flags & _BV(PORF)) {
+		return reset_cause::POWER_ON;
+	} else if (reset_flags & _BV(WDRF)) {
+		return reset_cause::WATCHDOG;
+	} else if (reset_flags & _BV(BORF)) {
+		return reset_cause::BROWN_OUT;
+	} else if (reset_flags & _BV(EXTRF)) {
+		return reset_cause::EXTERNAL;
+	}
+
+	return reset_cause::SOFTWARE;
+}
+
+void nfr::print_summary(Print& print)
+{
+	char line[nsec::config::display::text_line_length];
+	nsec::formatter formatter(line);
+
+	if (!persistent_record.is_preserved) {
+		formatter.append(F("Reset: "))
+			.append_P(reinterpret_cast<const char *>(
+				pgm_read_ptr(&reset_cause_names[uint8_t(last_reset_cause())])));
+	} else if (persistent_record.running_task) {
+		formatter.append(F("Watchdog: task ")).hex(persistent_record.running_task);
+	} else {
+		formatter.append(F("Watchdog: no task"));
+	}
+
+	print.print(line);
+}
+
+void nfr::dump(Print& print)
+{
+	print.print(F("reset: "));
+	print.println(as_flash_string(reinterpret_cast<const char *>(
+		pgm_read_ptr(&reset_cause_names[uint8_t(last_reset_cause())]))));
+	print.print(F("record: "));
+	print.println(persistent_record.is_preserved ? F("preserved") : F("recording"));
+	print.print(F("watchdog resets: "));
+	print.println(persistent_record.watchdog_reset_count);
+	print.print(F("running task: "));
+	print_task(print, persistent_record.running_task);
+	print.print(F("last task: "));
+	print_task(print, persistent_record.last_task);
+	print.print(F("last update: "));
+	print.print(persistent_record.last_update_ms);
+	print.println(F(" ms"));
+
+	uint8_t index = persistent_record.next_event_index >= persistent_record.event_count ?
+		persistent_record.next_event_index - persistent_record.event_count :
+		max_event_count + persistent_record.next_event_index - persistent_record.event_count;
+
+	// Oldest first, timed relative to the last update (modulo 65536 ms).
+	for (uint8_t i = 0; i < persistent_record.event_count; i++) {
+		const auto& event = persistent_record.events[index];
+
+		print.print('-');
+		print.print(uint16_t(uint16_t(persistent_record.last_update_ms) - event.time_ms));
+		print.print(F(" ms "));
+		if (event.id < sizeof(tracepoint_names) / sizeof(*tracepoint_names)) {
+			print.print(as_flash_string(
+				reinterpret_cast<const char *>(pgm_read_ptr(&tracepoint_names[event.id]))));
+		} else {
+			print.print(event.id);
+		}
+
+		print.print(' ');
+		print.print(event.arg0);
+		print.print(F(" 0x"));
+		print.println(event.arg1, HEX);
+		index = index + 1 == max_event_count ? 0 : index + 1;
+	}
+}
+
+void nfr::clear() noexcept
+{
+	start_new_record();
+}
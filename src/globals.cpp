@@ -2,8 +2,10 @@
 //
 // SPDX-License-Identifier: MIT
 
+#include "badge.hpp"
 #include "globals.hpp"
 
-nsec::scheduling::scheduler<nsec::config::scheduler::max_scheduled_task_count>
+nsec::scheduling::scheduler<nsec::config::scheduler::max_scheduled_task_count,
+			    nsec::diagnostics::scheduler_observer>
 	nsec::g::the_scheduler;
 nsec::runtime::badge nsec::g::the_badge;
@@ -0,0 +1,134 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "config.hpp"
+#include "diagnostics/latency.hpp"
+#include "histogram.hpp"
+
+#include <Arduino.h>
+
+#ifdef NSEC_LATENCY_PROBE
+
+namespace ndl = nsec::diagnostics::latency;
+namespace ns = nsec::scheduling;
+
+namespace {
+constexpr uint8_t bucket_width_ms = nsec::config::diagnostics::latency_histogram_bucket_width_ms;
+constexpr uint8_t bucket_count = nsec::config::diagnostics::latency_histogram_bucket_count;
+
+using histogram = nsec::histogram<bucket_width_ms, bucket_count>;
+
+class measurement {
+public:
+	void start(ns::absolute_time_ms timestamp) noexcept
+	{
+		if (_in_progress) {
+			return;
+		}
+
+		_start_time_ms = timestamp;
+		_in_progress = true;
+	}
+
+	void complete(ns::absolute_time_ms timestamp) noexcept
+	{
+		if (!_in_progress) {
+			return;
+		}
+
+		_latencies.record(timestamp - _start_time_ms);
+		_in_progress = false;
+	}
+
+	const histogram& latencies() const noexcept
+	{
+		return _latencies;
+	}
+
+private:
+	histogram _latencies;
+	ns::absolute_time_ms _start_time_ms;
+	bool _in_progress;
+};
+
+measurement frame_measurement;
+measurement leds_measurement;
+
+void print_padded(Print& print, uint16_t value, uint8_t width)
+{
+	for (uint16_t limit = 10; width > 1; width--, limit *= 10) {
+		if (value < limit) {
+			print.print(' ');
+		}
+	}
+
+	print.print(value);
+}
+
+void print_percentiles(Print& print, const __FlashStringHelper *label, const histogram& latencies)
+{
+	print.print(label);
+	print_padded(print, latencies.percentile_ms(50), 5);
+	print_padded(print, latencies.percentile_ms(90), 5);
+	print_padded(print, latencies.max_ms(), 5);
+	print.println();
+}
+} // anonymous namespace
+
+void ndl::on_button_pressed(ns::absolute_time_ms timestamp) noexcept
+{
+	frame_measurement.start(timestamp);
+	leds_measurement.start(timestamp);
+}
+
+void ndl::on_frame_flushed(ns::absolute_time_ms timestamp) noexcept
+{
+	frame_measurement.complete(timestamp);
+}
+
+void ndl::on_leds_shown(ns::absolute_time_ms timestamp) noexcept
+{
+	leds_measurement.complete(timestamp);
+}
+
+void ndl::print_summary(Print& print)
+{
+	print.println(F("(ms)    p50  p90  max"));
+	print_percentiles(print, F("Frame "), frame_measurement.latencies());
+	print_percentiles(print, F("LEDs  "), leds_measurement.latencies());
+	print.print(F("Presses: "));
+	print.print(frame_measurement.latencies().sample_count());
+}
+
+void ndl::dump(Print& print)
+{
+	const auto& frame_latencies = frame_measurement.latencies();
+	const auto& leds_latencies = leds_measurement.latencies();
+
+	print.println(F("latency_ms,frame,leds"));
+	for (uint8_t i = 0; i <= bucket_count; i++) {
+		print.print(i * bucket_width_ms);
+		if (i == bucket_count) {
+			print.print('+');
+		}
+
+		print.print(',');
+		print.print(frame_latencies.bucket_sample_count(i));
+		print.print(',');
+		print.println(leds_latencies.bucket_sample_count(i));
+	}
+
+	print.print(F("max,"));
+	print.print(frame_latencies.max_ms());
+	print.print(',');
+	print.println(leds_latencies.max_ms());
+	print.print(F("count,"));
+	print.print(frame_latencies.sample_count());
+	print.print(',');
+	print.println(leds_latencies.sample_count());
+}
+
+#endif // NSEC_LATENCY_PROBE
@@ -0,0 +1,453 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "config.hpp"
+#include "formatter.hpp"
+#include "globals.hpp"
+#include "network/link_bench.hpp"
+
+#include <Arduino.h>
+
+#ifdef NSEC_LINK_BENCH
+
+namespace nc = nsec::communication;
+namespace ncl = nsec::config::link_bench;
+namespace ns = nsec::scheduling;
+
+namespace {
+static_assert(ncl::window > 0 && ncl::window <= nsec::config::communication::app_message_outbox_length,
+	      "The bench's frames fit in the outbox");
+
+const char idle_state_name[] PROGMEM = "idle";
+const char streaming_state_name[] PROGMEM = "streaming";
+const char waiting_report_state_name[] PROGMEM = "waiting report";
+const char done_state_name[] PROGMEM = "done";
+const char failed_state_name[] PROGMEM = "failed";
+// Indexed by link_bench::state.
+const char *const state_names[] PROGMEM = { idle_state_name,
+					    streaming_state_name,
+					    waiting_report_state_name,
+					    done_state_name,
+					    failed_state_name };
+
+const __FlashStringHelper *as_flash_string(const char *str)
+{
+	return static_cast<const __FlashStringHelper *>(static_cast<const void *>(str));
+}
+
+uint8_t pattern_byte(uint16_t sequence, uint8_t index) noexcept
+{
+	return uint8_t(sequence) + uint8_t(sequence >> 8) + index * 31;
+}
+
+uint32_t bytes_per_second(uint16_t frame_count, unsigned long time_ms) noexcept
+{
+	return time_ms ? uint32_t(frame_count) * sizeof(nc::message::link_bench_frame) * 1000 /
+			time_ms :
+			 0;
+}
+
+void print_direction(Print& print,
+		     const __FlashStringHelper *label,
+		     uint16_t frames_sent,
+		     uint16_t frames_received,
+		     uint16_t frames_damaged,
+		     unsigned long time_ms)
+{
+	const uint16_t intact_frames = frames_received - frames_damaged;
+	const uint32_t centi_frames_per_second =
+		time_ms ? uint32_t(intact_frames) * 100000 / time_ms : 0;
+
+	print.print(label);
+	print.print(intact_frames);
+	print.print(F(" frames, "));
+	print.print(centi_frames_per_second / 100);
+	print.print('.');
+	if (centi_frames_per_second % 100 < 10) {
+		print.print('0');
+	}
+
+	print.print(centi_frames_per_second % 100);
+	print.print(F(" frames/s, "));
+	print.print(bytes_per_second(intact_frames, time_ms));
+	print.print(F(" B/s (lost: "));
+	print.print(uint16_t(frames_sent - frames_received));
+	print.print(F(", damaged: "));
+	print.print(frames_damaged);
+	print.println(')');
+}
+} // anonymous namespace
+
+nc::link_bench::link_bench(network_handler& network) noexcept :
+	periodic_task(ncl::period_ms), _network{ network }, _state{ state::IDLE }
+{
+}
+
+void nc::link_bench::start(bool is_bidirectional) noexcept
+{
+	const auto direction =
+		_network.position() == network_handler::link_position::RIGHT_MOST ?
+		peer_relative_position::LEFT :
+		peer_relative_position::RIGHT;
+	const message::link_bench_start start_msg = { .peer_id = _network.peer_id(),
+						      .duration_s = ncl::duration_s,
+						      .is_bidirectional = is_bidirectional };
+
+	_start(millis(), direction, ncl::duration_s, is_bidirectional, true);
+	_network.enqueue_app_message(direction,
+				     uint8_t(message::type::LINK_BENCH_START),
+				     reinterpret_cast<const uint8_t *>(&start_msg));
+}
+
+void nc::link_bench::_start(ns::absolute_time_ms current_time_ms,
+			    peer_relative_position direction,
+			    uint8_t duration_s,
+			    bool is_bidirectional,
+			    bool is_initiator) noexcept
+{
+	_state = state::STREAMING;
+	_direction = uint8_t(direction);
+	_is_bidirectional = is_bidirectional;
+	_is_initiator = is_initiator;
+	_is_report_pending = false;
+	_has_peer_report = false;
+	_duration_s = duration_s;
+	_start_time_ms = current_time_ms;
+	_end_time_ms = current_time_ms;
+	_frames_sent = 0;
+	_frames_acknowledged = 0;
+	_frames_received = 0;
+	_frames_damaged = 0;
+	// Counted from here until the end of the streaming.
+	_retransmissions = _network.statistics().retransmissions;
+	_round_trip_times.clear();
+
+	revive();
+	if (!scheduled()) {
+		nsec::g::the_scheduler.schedule_task(*this);
+	}
+}
+
+void nc::link_bench::abort() noexcept
+{
+	if (_state == state::STREAMING || _state == state::WAITING_REPORT) {
+		_state = state::FAILED;
+	}
+}
+
+void nc::link_bench::on_message_received(message::type message_type,
+					 const uint8_t *payload) noexcept
+{
+	switch (message_type) {
+	case message::type::LINK_BENCH_START:
+	{
+		const auto *start_msg = reinterpret_cast<const message::link_bench_start *>(payload);
+
+		_start(millis(),
+		       start_msg->peer_id < _network.peer_id() ? peer_relative_position::LEFT :
+								 peer_relative_position::RIGHT,
+		       start_msg->duration_s,
+		       start_msg->is_bidirectional,
+		       false);
+		break;
+	}
+	case message::type::LINK_BENCH_FRAME:
+		if (_state == state::STREAMING || _state == state::WAITING_REPORT) {
+			_on_frame(*reinterpret_cast<const message::link_bench_frame *>(payload));
+		}
+
+		break;
+	case message::type::LINK_BENCH_REPORT:
+		if (_state == state::STREAMING || _state == state::WAITING_REPORT) {
+			_on_report(*reinterpret_cast<const message::link_bench_report *>(payload));
+		}
+
+		break;
+	default:
+		break;
+	}
+}
+
+void nc::link_bench::on_app_message_sent(message::type message_type) noexcept
+{
+	if (message_type != message::type::LINK_BENCH_FRAME || _frames_acknowledged == _frames_sent) {
+		return;
+	}
+
+	// Frames are acknowledged in the order they were enqueued.
+	const uint16_t enqueue_time_ms = _frame_enqueue_times_ms[_frames_acknowledged % ncl::window];
+
+	_round_trip_times.record(uint16_t(uint16_t(millis()) - enqueue_time_ms));
+	_frames_acknowledged++;
+}
+
+void nc::link_bench::_on_frame(const message::link_bench_frame& frame) noexcept
+{
+	if (_frames_received && frame.sequence == _last_frame_sequence) {
+		// Received twice: the neighbour didn't get our OK and retransmitted the frame.
+		return;
+	}
+
+	_frames_received++;
+	_last_frame_sequence = frame.sequence;
+	for (uint8_t i = 0; i < sizeof(frame.pattern); i++) {
+		if (frame.pattern[i] != pattern_byte(frame.sequence, i)) {
+			_frames_damaged++;
+			break;
+		}
+	}
+}
+
+void nc::link_bench::_on_report(const message::link_bench_report& report) noexcept
+{
+	_peer_report = report;
+	_has_peer_report = true;
+
+	if (_is_initiator) {
+		// Our report was sent first.
+		_state = state::DONE;
+		return;
+	}
+
+	/*
+	 * The initiator's report follows its last frame: stop streaming, even if our
+	 * (later) deadline hasn't passed yet, and reply.
+	 */
+	if (_state == state::STREAMING) {
+		_stop_streaming(millis());
+	}
+
+	_is_report_pending = true;
+}
+
+void nc::link_bench::_stop_streaming(ns::absolute_time_ms current_time_ms) noexcept
+{
+	_end_time_ms = current_time_ms;
+	_retransmissions = _network.statistics().retransmissions - _retransmissions;
+	_state = state::WAITING_REPORT;
+}
+
+bool nc::link_bench::_is_streaming_frames() const noexcept
+{
+	return _is_initiator || _is_bidirectional;
+}
+
+void nc::link_bench::_send_frames(ns::absolute_time_ms current_time_ms) noexcept
+{
+	while (uint16_t(_frames_sent - _frames_acknowledged) < ncl::window) {
+		message::link_bench_frame frame;
+
+		frame.sequence = _frames_sent;
+		for (uint8_t i = 0; i < sizeof(frame.pattern); i++) {
+			frame.pattern[i] = pattern_byte(frame.sequence, i);
+		}
+
+		if (_network.enqueue_app_message(peer_relative_position(_direction),
+						 uint8_t(message::type::LINK_BENCH_FRAME),
+						 reinterpret_cast<const uint8_t *>(&frame)) !=
+		    network_handler::enqueue_message_result::QUEUED) {
+			return;
+		}
+
+		_frame_enqueue_times_ms[_frames_sent % ncl::window] = uint16_t(current_time_ms);
+		_frames_sent++;
+	}
+}
+
+void nc::link_bench::_send_report() noexcept
+{
+	const message::link_bench_report report = { .frames_sent = _frames_sent,
+						    .frames_received = _frames_received,
+						    .frames_damaged = _frames_damaged,
+						    .retransmissions = _retransmissions };
+
+	if (_network.enqueue_app_message(peer_relative_position(_direction),
+					 uint8_t(message::type::LINK_BENCH_REPORT),
+					 reinterpret_cast<const uint8_t *>(&report)) !=
+	    network_handler::enqueue_message_result::QUEUED) {
+		// Retried on the next run.
+		return;
+	}
+
+	_is_report_pending = false;
+	if (!_is_initiator) {
+		// The initiator's report was received first.
+		_state = state::DONE;
+	}
+}
+
+void nc::link_bench::run(ns::absolute_time_ms current_time_ms) noexcept
+{
+	switch (_state) {
+	case state::STREAMING:
+		// Messages are handled after the scheduler's tick: their time may be later.
+		if (long(current_time_ms - _start_time_ms) >= long(_duration_s * 1000UL)) {
+			_stop_streaming(current_time_ms);
+			// The responder replies to the initiator's report.
+			_is_report_pending = _is_initiator;
+		} else if (_is_streaming_frames()) {
+			_send_frames(current_time_ms);
+		}
+
+		break;
+	case state::WAITING_REPORT:
+		if (_is_report_pending) {
+			_send_report();
+		} else if (long(current_time_ms - _end_time_ms) >= long(ncl::report_timeout_ms)) {
+			_state = state::FAILED;
+		}
+
+		break;
+	default:
+		kill();
+		break;
+	}
+}
+
+unsigned long nc::link_bench::_streaming_time_ms(ns::absolute_time_ms current_time_ms) const noexcept
+{
+	const long time_ms =
+		(_state == state::STREAMING ? current_time_ms : _end_time_ms) - _start_time_ms;
+
+	return time_ms > 0 ? time_ms : 0;
+}
+
+void nc::link_bench::print_summary(Print& print, ns::absolute_time_ms current_time_ms) const
+{
+	char line[nsec::config::display::text_line_length];
+	nsec::formatter formatter(line);
+	const auto time_ms = _streaming_time_ms(current_time_ms);
+	// Until the neighbour's report, the frames it acknowledged and nothing lost.
+	const uint16_t frames_out = _has_peer_report ?
+		_peer_report.frames_received - _peer_report.frames_damaged :
+		_frames_acknowledged;
+	const uint16_t frames_lost_out =
+		_has_peer_report ? _frames_sent - _peer_report.frames_received : 0;
+	const uint16_t frames_lost_in =
+		_has_peer_report ? _peer_report.frames_sent - _frames_received : 0;
+
+	formatter.append(F("Link bench: "));
+	if (_state == state::STREAMING) {
+		formatter.decimal(uint16_t(time_ms / 1000))
+			.append('/')
+			.decimal(uint16_t(_duration_s))
+			.append(F(" s"));
+	} else {
+		formatter.append_P(
+			reinterpret_cast<const char *>(pgm_read_ptr(&state_names[uint8_t(_state)])));
+	}
+
+	print.println(line);
+	if (_state == state::IDLE) {
+		return;
+	}
+
+	// The directions in which frames are streamed, then the retransmissions if only one.
+	formatter.clear();
+	if (_is_streaming_frames()) {
+		formatter.append(F("Out: "))
+			.decimal(bytes_per_second(frames_out, time_ms))
+			.append(F(" B/s, lost "))
+			.decimal(frames_lost_out);
+		print.println(line);
+		formatter.clear();
+	}
+
+	if (!_is_initiator || _is_bidirectional) {
+		formatter.append(F("In: "))
+			.decimal(bytes_per_second(_frames_received - _frames_damaged, time_ms))
+			.append(F(" B/s, lost "))
+			.decimal(frames_lost_in);
+		print.println(line);
+		formatter.clear();
+	}
+
+	if (!_is_bidirectional) {
+		formatter.append(F("Retransmissions: "))
+			.decimal(uint16_t(_state == state::STREAMING ?
+						  _network.statistics().retransmissions -
+							  _retransmissions :
+						  _retransmissions));
+		print.println(line);
+		formatter.clear();
+	}
+
+	formatter.append(F("RTT: "))
+		.decimal(_round_trip_times.percentile_ms(50))
+		.append(' ')
+		.decimal(_round_trip_times.percentile_ms(90))
+		.append(' ')
+		.decimal(_round_trip_times.max_ms())
+		.append(F(" ms"));
+	print.print(line);
+}
+
+void nc::link_bench::print(Print& print, ns::absolute_time_ms current_time_ms) const
+{
+	const auto time_ms = _streaming_time_ms(current_time_ms);
+
+	print.print(F("state: "));
+	print.println(as_flash_string(
+		reinterpret_cast<const char *>(pgm_read_ptr(&state_names[uint8_t(_state)]))));
+	if (_state == state::IDLE) {
+		return;
+	}
+
+	print.print(F("mode: "));
+	print.print(_is_bidirectional ? F("bidirectional") : F("one-way"));
+	print.println(_is_initiator ? F(", started here") : F(", started by the neighbour"));
+	print.print(F("time: "));
+	print.print(time_ms);
+	print.println(F(" ms"));
+
+	if (!_has_peer_report) {
+		print.print(F("sent: "));
+		print.print(_frames_sent);
+		print.print(F(" (acknowledged: "));
+		print.print(_frames_acknowledged);
+		print.println(')');
+		print.print(F("received: "));
+		print.println(_frames_received);
+		return;
+	}
+
+	if (_is_streaming_frames()) {
+		print_direction(print,
+				F("out: "),
+				_frames_sent,
+				_peer_report.frames_received,
+				_peer_report.frames_damaged,
+				time_ms);
+	}
+
+	if (!_is_initiator || _is_bidirectional) {
+		print_direction(print,
+				F("in: "),
+				_peer_report.frames_sent,
+				_frames_received,
+				_frames_damaged,
+				time_ms);
+	}
+
+	print.print(F("retransmissions: "));
+	print.print(_retransmissions);
+	print.print(F(" (neighbour: "));
+	print.print(_peer_report.retransmissions);
+	print.println(')');
+	print.print(F("rtt: p50 "));
+	print.print(_round_trip_times.percentile_ms(50));
+	print.print(F(" ms, p90 "));
+	print.print(_round_trip_times.percentile_ms(90));
+	print.print(F(" ms, p99 "));
+	print.print(_round_trip_times.percentile_ms(99));
+	print.print(F(" ms, max "));
+	print.print(_round_trip_times.max_ms());
+	print.print(F(" ms ("));
+	print.print(_round_trip_times.sample_count());
+	print.println(F(" frames)"));
+}
+
+#endif // NSEC_LINK_BENCH
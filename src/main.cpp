@@ -2,6 +2,8 @@
 //
 // SPDX-License-Identifier: MIT
 
+#include "badge.hpp"
+#include "diagnostics/flight_recorder.hpp"
 #include "globals.hpp"
 #include "ringbuffer.hpp"
 
@@ -12,5 +14,7 @@ void setup()
 
 void loop()
 {
-	nsec::g::the_scheduler.tick(millis());
+	nsec::diagnostics::flight_recorder::feed_watchdog();
+	nsec::g::the_badge.check_wake_up_sources();
+	nsec::g::the_badge.idle(nsec::g::the_scheduler.tick(millis()));
 }
@@ -4,14 +4,18 @@
  * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
  */
 
+#include "badge.hpp"
 #include "board.hpp"
 #include "config.hpp"
+#include "diagnostics/trace.hpp"
 #include "globals.hpp"
+#include "hamming.hpp"
 #include "network/network_handler.hpp"
 
 namespace ns = nsec::scheduling;
 namespace nc = nsec::communication;
 namespace ng = nsec::g;
+namespace ndt = nsec::diagnostics::trace;
 
 namespace {
 enum class wire_msg_type : uint8_t {
@@ -26,13 +30,27 @@ enum class wire_msg_type : uint8_t {
 
 	// Application messages (forwarded to the application layer)
 	// ...
+
+	/*
+	 * Offers to code the frames sent on the link (see set_forward_error_correction()), once
+	 * paired. It takes an application message type, the highest that fits in
+	 * _current_message_being_sent_type: firmware predating the coding hands it to its
+	 * application, which ignores it, instead of resetting the link.
+	 */
+	CODING_OFFER = 31,
 };
+
+static_assert(uint8_t(wire_msg_type::CODING_OFFER) >=
+		      nsec::config::communication::application_message_type_range_begin,
+	      "Coding offers must be ignored by firmware that doesn't code frames");
 }
 
 namespace {
 
 constexpr uint8_t wire_protocol_magic_1 = 0b10101111;
 constexpr uint8_t wire_protocol_magic_2 = 0b11111010;
+// Second magic byte of frames coded for forward error correction, six bits away from the other.
+constexpr uint8_t wire_protocol_coded_magic_2 = 0b10100101;
 
 struct wire_msg_header {
 	// Message start with a 16-bit magic number to re-sync on message frames.
@@ -47,6 +65,11 @@ struct wire_msg_header {
 	uint16_t checksum;
 } __attribute__((packed));
 
+/*
+ * On links coded for forward error correction, every byte following the magic number is
+ * sent as two Hamming codewords, low nibble first.
+ */
+
 struct wire_msg_announce {
 	uint8_t peer_id;
 } __attribute__((packed));
@@ -65,11 +88,20 @@ uint8_t wire_msg_payload_size(uint8_t type)
 	case wire_msg_type::MONITOR:
 	case wire_msg_type::RESET:
 	case wire_msg_type::OK:
+	case wire_msg_type::CODING_OFFER:
 		return 0;
 	default:
 		switch (nc::message::type(type)) {
 		case nc::message::type::ANNOUNCE_BADGE_ID:
 			return sizeof(nc::message::announce_badge_id);
+		case nc::message::type::PAIRING_ANIMATION_START:
+			return sizeof(nc::message::pairing_animation_start);
+		case nc::message::type::LINK_BENCH_START:
+			return sizeof(nc::message::link_bench_start);
+		case nc::message::type::LINK_BENCH_FRAME:
+			return sizeof(nc::message::link_bench_frame);
+		case nc::message::type::LINK_BENCH_REPORT:
+			return sizeof(nc::message::link_bench_report);
 		default:
 			break;
 		}
@@ -96,21 +128,85 @@ private:
 	uint8_t _sum_high = 0;
 };
 
-void send_wire_magic(SoftwareSerial& serial) noexcept
+bool is_within_one_bit_of(uint8_t value, uint8_t expected_value) noexcept
+{
+	const uint8_t difference = value ^ expected_value;
+
+	return !(difference & (difference - 1));
+}
+
+// All the bytes exchanged on the links go through these two.
+uint8_t read_raw_byte(SoftwareSerial& serial) noexcept
 {
-	serial.write(wire_protocol_magic_1);
-	serial.write(wire_protocol_magic_2);
+	const auto value = uint8_t(serial.read());
+
+	ndt::record_wire_byte(ndt::tracepoint::WIRE_BYTE_RECEIVED, value);
+	return value;
 }
 
-void send_wire_header(SoftwareSerial& serial, uint8_t msg_type, uint16_t checksum) noexcept
+void write_raw_byte(SoftwareSerial& serial, uint8_t value) noexcept
+{
+	serial.write(value);
+	ndt::record_wire_byte(ndt::tracepoint::WIRE_BYTE_SENT, value);
+}
+
+void write_wire_bytes(SoftwareSerial& serial,
+		      const uint8_t *bytes,
+		      uint8_t size,
+		      bool is_coded) noexcept
+{
+	for (uint8_t i = 0; i < size; i++) {
+		if (!is_coded) {
+			write_raw_byte(serial, bytes[i]);
+			continue;
+		}
+
+		write_raw_byte(serial, nsec::hamming::encode(bytes[i] & 0xF));
+		write_raw_byte(serial, nsec::hamming::encode(bytes[i] >> 4));
+	}
+}
+
+nsec::hamming::decode_result worst(nsec::hamming::decode_result lhs,
+				   nsec::hamming::decode_result rhs) noexcept
+{
+	return lhs > rhs ? lhs : rhs;
+}
+
+nsec::hamming::decode_result
+read_wire_byte(SoftwareSerial& serial, bool is_coded, uint8_t& value) noexcept
+{
+	if (!is_coded) {
+		value = read_raw_byte(serial);
+		return nsec::hamming::decode_result::VALID;
+	}
+
+	uint8_t low_nibble = 0, high_nibble = 0;
+	const auto low_result = nsec::hamming::decode(read_raw_byte(serial), low_nibble);
+	const auto high_result = nsec::hamming::decode(read_raw_byte(serial), high_nibble);
+
+	value = low_nibble | (high_nibble << 4);
+	return worst(low_result, high_result);
+}
+
+void send_wire_magic(SoftwareSerial& serial, bool is_coded) noexcept
+{
+	write_raw_byte(serial, wire_protocol_magic_1);
+	write_raw_byte(serial, is_coded ? wire_protocol_coded_magic_2 : wire_protocol_magic_2);
+}
+
+void send_wire_header(SoftwareSerial& serial,
+		      uint8_t msg_type,
+		      uint16_t checksum,
+		      bool is_coded) noexcept
 {
 	const wire_msg_header header = { .type = msg_type, .checksum = checksum };
 
-	send_wire_magic(serial);
-	serial.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+	send_wire_magic(serial, is_coded);
+	write_wire_bytes(serial, reinterpret_cast<const uint8_t *>(&header), sizeof(header), is_coded);
 }
 
 void send_wire_msg(SoftwareSerial& serial,
+		   bool is_coded,
 		   uint8_t msg_type,
 		   const uint8_t *msg = nullptr,
 		   uint8_t msg_payload_size = 0) noexcept
@@ -122,18 +218,19 @@ void send_wire_msg(SoftwareSerial& serial,
 		checksummer.push(msg[i]);
 	}
 
-	send_wire_header(serial, msg_type, checksummer.checksum());
-	serial.write(msg, msg_payload_size);
+	send_wire_header(serial, msg_type, checksummer.checksum(), is_coded);
+	write_wire_bytes(serial, msg, msg_payload_size, is_coded);
 }
 
 void send_wire_reset_msg(SoftwareSerial& serial) noexcept
 {
-	send_wire_msg(serial, uint8_t(wire_msg_type::RESET));
+	// A hint to a neighbour which may have lost the link: always readable.
+	send_wire_msg(serial, false, uint8_t(wire_msg_type::RESET));
 }
 
-void send_wire_ok_msg(SoftwareSerial& serial) noexcept
+void send_wire_ok_msg(SoftwareSerial& serial, bool is_coded) noexcept
 {
-	send_wire_msg(serial, uint8_t(wire_msg_type::OK));
+	send_wire_msg(serial, is_coded, uint8_t(wire_msg_type::OK));
 }
 } /* namespace */
 
@@ -147,7 +244,10 @@ nc::network_handler::network_handler() noexcept :
 		      true),
 	_is_left_connected{ false },
 	_is_right_connected{ false },
-	_current_wire_protocol_state{ uint8_t(wire_protocol_state::UNCONNECTED) }
+	_current_wire_protocol_state{ uint8_t(wire_protocol_state::UNCONNECTED) },
+	_is_forward_error_correction_enabled{
+		nsec::config::communication::forward_error_correction_enabled
+	}
 {
 	_reset();
 	ng::the_scheduler.schedule_task(*this);
@@ -182,6 +282,31 @@ nc::network_handler::link_position nc::network_handler::position() const noexcep
 	return link_position(_current_position);
 }
 
+void nc::network_handler::set_forward_error_correction(bool enable) noexcept
+{
+	_is_forward_error_correction_enabled = enable;
+}
+
+bool nc::network_handler::is_forward_error_correction_enabled() const noexcept
+{
+	return _is_forward_error_correction_enabled;
+}
+
+bool nc::network_handler::is_link_coded(peer_relative_position side) const noexcept
+{
+	return side == peer_relative_position::LEFT ? _is_left_link_coded : _is_right_link_coded;
+}
+
+void nc::network_handler::suspend() noexcept
+{
+	_listening_side_serial().stopListening();
+}
+
+void nc::network_handler::resume() noexcept
+{
+	_listening_side(_listening_side());
+}
+
 void nc::network_handler::_reset() noexcept
 {
 	_position(link_position::UNKNOWN);
@@ -234,6 +359,7 @@ nc::network_handler::check_connections_result nc::network_handler::_check_connec
 		}
 	}
 
+	_count(&link_statistics::topology_changes);
 	_reset();
 
 	_is_left_connected = left_is_connected;
@@ -313,16 +439,19 @@ void nc::network_handler::_wire_protocol_state(wire_protocol_state state) noexce
 
 	_current_wire_protocol_state = uint8_t(state);
 	_ticks_in_wire_state = 0;
+	_log_wire_protocol_state(state);
 	// Reset timeout timestamp.
 	_last_message_received_time_ms = millis();
+	period_ms(state == wire_protocol_state::UNCONNECTED ?
+			  nsec::config::communication::network_handler_base_period_ms :
+			  nsec::config::communication::network_handler_message_poll_period_ms);
 
 	if (_is_wire_protocol_in_a_running_state(previous_protocol_state) &&
 	    state == wire_protocol_state::UNCONNECTED) {
-		nsec::g::the_badge.on_disconnection();
+		nsec::g::the_badge.post_event(nsec::runtime::badge::event::disconnection());
 	}
 
 	if (state == wire_protocol_state::UNCONNECTED) {
-		_current_pending_outgoing_app_message_size = 0;
 		// We are a sad and lonely node hacking together a network protocol.
 		_peer_count = 1;
 		// Unknown peer id.
@@ -330,7 +459,12 @@ void nc::network_handler::_wire_protocol_state(wire_protocol_state state) noexce
 		_wave_front_direction(peer_relative_position::RIGHT);
 		_message_reception_state(message_reception_state::RECEIVE_MAGIC_BYTE_1);
 		_clear_outgoing_message();
-		_clear_pending_outgoing_app_message();
+		_pending_outgoing_app_messages.clear();
+		// Negotiated anew once paired.
+		_is_left_link_coded = false;
+		_is_right_link_coded = false;
+		_has_offered_left_link_coding = false;
+		_has_offered_right_link_coding = false;
 
 		/* Empty the serial buffers by switching listening side. */
 		_right_serial.listen();
@@ -340,7 +474,9 @@ void nc::network_handler::_wire_protocol_state(wire_protocol_state state) noexce
 	if (!_is_wire_protocol_in_a_running_state(previous_protocol_state) &&
 	    _is_wire_protocol_in_a_running_state(state)) {
 		// Discovery has completed.
-		nsec::g::the_badge.on_pairing_end(_peer_id, _peer_count);
+		ndt::record(ndt::tracepoint::PAIRING_END, _peer_id, _peer_count);
+		nsec::g::the_badge.post_event(
+			nsec::runtime::badge::event::pairing_end(_peer_id, _peer_count));
 	}
 }
 
@@ -363,6 +499,7 @@ nc::network_handler::_message_reception_state() const noexcept
 void nc::network_handler::_message_reception_state(message_reception_state new_state) noexcept
 {
 	_current_message_reception_state = uint8_t(new_state);
+	_log_message_reception_state(new_state);
 }
 
 nc::network_handler::message_transmission_state
@@ -374,6 +511,22 @@ nc::network_handler::_message_transmission_state() const noexcept
 void nc::network_handler::_message_transmission_state(message_transmission_state new_state) noexcept
 {
 	_current_message_transmission_state = uint8_t(new_state);
+	_log_message_transmission_state(new_state);
+}
+
+void nc::network_handler::_log_wire_protocol_state(wire_protocol_state state) noexcept
+{
+	ndt::record(ndt::tracepoint::WIRE_PROTOCOL_STATE, uint8_t(state));
+}
+
+void nc::network_handler::_log_message_reception_state(message_reception_state state) noexcept
+{
+	ndt::record(ndt::tracepoint::MESSAGE_RECEPTION_STATE, uint8_t(state));
+}
+
+void nc::network_handler::_log_message_transmission_state(message_transmission_state state) noexcept
+{
+	ndt::record(ndt::tracepoint::MESSAGE_TRANSMISSION_STATE, uint8_t(state));
 }
 
 nc::peer_relative_position nc::network_handler::_outgoing_message_direction() const noexcept
@@ -423,27 +576,6 @@ void nc::network_handler::_set_outgoing_message(nsec::scheduling::absolute_time_
 	_last_transmission_time_ms = current_time_ms;
 }
 
-nc::peer_relative_position
-nc::network_handler::_pending_outgoing_app_message_direction() const noexcept
-{
-	return peer_relative_position(_current_pending_outgoing_app_message_direction);
-}
-
-uint8_t nc::network_handler::_pending_outgoing_app_message_size() const noexcept
-{
-	return _current_pending_outgoing_app_message_size;
-}
-
-bool nc::network_handler::_has_pending_outgoing_app_message() const noexcept
-{
-	return _current_pending_outgoing_app_message_type != 0;
-}
-
-void nc::network_handler::_clear_pending_outgoing_app_message() noexcept
-{
-	_current_pending_outgoing_app_message_type = 0;
-}
-
 SoftwareSerial& nc::network_handler::_listening_side_serial() noexcept
 {
 	return _listening_side() == peer_relative_position::LEFT ? _left_serial : _right_serial;
@@ -460,8 +592,14 @@ nc::network_handler::handle_reception_result nc::network_handler::_handle_recept
 		switch (_message_reception_state()) {
 		case message_reception_state::RECEIVE_MAGIC_BYTE_1:
 		{
-			const auto front_byte = uint8_t(serial.read());
-			if (front_byte != wire_protocol_magic_1) {
+			const auto front_byte = read_raw_byte(serial);
+			/*
+			 * The magic number isn't coded: on a coded link, tolerate a flipped bit
+			 * rather than lose a frame that can otherwise be corrected.
+			 */
+			if (front_byte != wire_protocol_magic_1 &&
+			    !(is_link_coded(_listening_side()) &&
+			      is_within_one_bit_of(front_byte, wire_protocol_magic_1))) {
 				break;
 			}
 
@@ -470,9 +608,14 @@ nc::network_handler::handle_reception_result nc::network_handler::_handle_recept
 		}
 		case message_reception_state::RECEIVE_MAGIC_BYTE_2:
 		{
-			const auto front_byte = uint8_t(serial.read());
-
-			if (front_byte != wire_protocol_magic_2) {
+			const auto front_byte = read_raw_byte(serial);
+
+			// Peers code frames on the links where it was negotiated, but may send both.
+			if (front_byte == wire_protocol_magic_2) {
+				_is_receiving_coded_message = false;
+			} else if (is_within_one_bit_of(front_byte, wire_protocol_coded_magic_2)) {
+				_is_receiving_coded_message = true;
+			} else {
 				break;
 			}
 
@@ -481,22 +624,28 @@ nc::network_handler::handle_reception_result nc::network_handler::_handle_recept
 		}
 		case message_reception_state::RECEIVE_HEADER:
 		{
-			if (serial.available() < int(sizeof(wire_msg_header))) {
+			const uint8_t bytes_per_byte = _is_receiving_coded_message ? 2 : 1;
+
+			if (serial.available() < bytes_per_byte) {
 				return handle_reception_result::INCOMPLETE;
 			}
 
-			const wire_msg_header header = { .type = uint8_t(serial.peek()) };
-
-			const auto msg_type = header.type;
-
-			const auto msg_payload_size = wire_msg_payload_size(msg_type);
-			_message_reception_state(message_reception_state::RECEIVE_PAYLOAD);
 			/*
-			 * Keep the payload and the header's type byte which will allow
-			 * us to dispatch the message, and the checksym, which will allow us
-			 * to validate the message.
+			 * Keep the header's type byte, which will allow us to dispatch the message,
+			 * and wait for the checksum, which will allow us to validate the message,
+			 * and the payload.
 			 */
-			_payload_bytes_to_receive = msg_payload_size + sizeof(header);
+			if (read_wire_byte(serial, _is_receiving_coded_message, _received_message_type) ==
+			    nsec::hamming::decode_result::UNCORRECTABLE) {
+				// The payload's size is unknown: hunt for the next message.
+				_message_reception_state(message_reception_state::RECEIVE_MAGIC_BYTE_1);
+				return handle_reception_result::CORRUPTED;
+			}
+
+			const auto msg_payload_size = wire_msg_payload_size(_received_message_type);
+			_message_reception_state(message_reception_state::RECEIVE_PAYLOAD);
+			_payload_bytes_to_receive =
+				(msg_payload_size + sizeof(wire_msg_header::checksum)) * bytes_per_byte;
 			break;
 		}
 		case message_reception_state::RECEIVE_PAYLOAD:
@@ -508,9 +657,7 @@ nc::network_handler::handle_reception_result nc::network_handler::_handle_recept
 			// Get ready to receive the beginning of the next message.
 			_message_reception_state(message_reception_state::RECEIVE_MAGIC_BYTE_1);
 
-			message_type = uint8_t(serial.read());
-			const uint16_t checksum = uint16_t(serial.read()) |
-				uint16_t(serial.read()) << 8;
+			message_type = _received_message_type;
 			const auto payload_size = wire_msg_payload_size(message_type);
 
 			if (payload_size != 0 && !message_payload) {
@@ -518,20 +665,37 @@ nc::network_handler::handle_reception_result nc::network_handler::_handle_recept
 				return handle_reception_result::CORRUPTED;
 			}
 
-			if (payload_size != 0) {
-				serial.readBytes(message_payload, payload_size);
+			uint8_t checksum_low = 0, checksum_high = 0;
+			auto decode_result =
+				read_wire_byte(serial, _is_receiving_coded_message, checksum_low);
+			decode_result = worst(
+				decode_result,
+				read_wire_byte(serial, _is_receiving_coded_message, checksum_high));
+			for (uint8_t i = 0; i < payload_size; i++) {
+				decode_result = worst(decode_result,
+						      read_wire_byte(serial,
+								     _is_receiving_coded_message,
+								     message_payload[i]));
 			}
 
 			// Validate checksum.
+			const uint16_t checksum = uint16_t(checksum_low) | uint16_t(checksum_high) << 8;
 			fletcher16_checksumer checksummer;
 			checksummer.push(message_type);
 			for (uint8_t i = 0; i < payload_size; i++) {
 				checksummer.push(message_payload[i]);
 			}
 
-			return checksum == checksummer.checksum() ?
-				handle_reception_result::COMPLETE :
-				handle_reception_result::CORRUPTED;
+			if (decode_result == nsec::hamming::decode_result::UNCORRECTABLE ||
+			    checksum != checksummer.checksum()) {
+				return handle_reception_result::CORRUPTED;
+			}
+
+			if (decode_result == nsec::hamming::decode_result::CORRECTED) {
+				_count(&link_statistics::corrected_messages);
+			}
+
+			return handle_reception_result::COMPLETE;
 		}
 		}
 	}
@@ -555,9 +719,11 @@ nc::network_handler::handle_transmission_result nc::network_handler::_handle_tra
 		// Listen before send since the other side can reply OK immediately.
 		_listening_side(_outgoing_message_direction());
 		send_wire_msg(sending_serial,
+			      is_link_coded(_outgoing_message_direction()),
 			      _current_message_being_sent_type,
 			      _current_message_being_sent,
 			      _current_message_being_sent_size);
+		_count(&link_statistics::messages_sent);
 		_last_transmission_time_ms = current_time_ms;
 		_message_transmission_state(message_transmission_state::WAIT_CONFIRMATION);
 		break;
@@ -576,14 +742,22 @@ nc::network_handler::handle_transmission_result nc::network_handler::_handle_tra
 		switch (receive_result) {
 		case handle_reception_result::COMPLETE:
 		{
+			_record_confirmation_time(current_time_ms - _last_transmission_time_ms);
 			_clear_outgoing_message();
 			return handle_transmission_result::COMPLETE;
 		}
+		case handle_reception_result::INCOMPLETE:
+			/*
+			 * The reply arrived during this tick: wait for the rest rather than take the
+			 * magic number for an OK, which would leave the rest of the OK to the
+			 * reception of the next message.
+			 */
 		case handle_reception_result::NO_DATA:
 			if (current_time_ms - _last_transmission_time_ms >=
 			    nsec::config::communication::network_handler_retransmit_timeout_ms) {
 
 				// Attempt a retransmission.
+				_count(&link_statistics::retransmissions);
 				_message_transmission_state(
 					message_transmission_state::ATTEMPT_SEND);
 			}
@@ -591,6 +765,7 @@ nc::network_handler::handle_transmission_result nc::network_handler::_handle_tra
 			break;
 		default:
 			// Assume the message was "OK".
+			_record_confirmation_time(current_time_ms - _last_transmission_time_ms);
 			_clear_outgoing_message();
 			return handle_transmission_result::COMPLETE;
 			break;
@@ -608,8 +783,9 @@ nc::network_handler::enqueue_message_result nc::network_handler::enqueue_app_mes
 {
 	const auto payload_size = wire_msg_payload_size(msg_type);
 
-	if (_has_pending_outgoing_app_message() ||
-	    payload_size > sizeof(_current_pending_outgoing_app_message_payload)) {
+	if (_pending_outgoing_app_messages.full() ||
+	    payload_size > sizeof(pending_app_message::payload)) {
+		_count(&link_statistics::outbox_overflows);
 		return enqueue_message_result::FULL;
 	}
 
@@ -622,10 +798,12 @@ nc::network_handler::enqueue_message_result nc::network_handler::enqueue_app_mes
 		return enqueue_message_result::UNCONNECTED;
 	}
 
-	_current_pending_outgoing_app_message_direction = uint8_t(direction);
-	_current_pending_outgoing_app_message_size = payload_size;
-	_current_pending_outgoing_app_message_type = msg_type;
-	memcpy(_current_pending_outgoing_app_message_payload, msg_payload, payload_size);
+	pending_app_message message;
+
+	message.direction = uint8_t(direction);
+	message.type = msg_type;
+	memcpy(message.payload, msg_payload, payload_size);
+	_pending_outgoing_app_messages.push(message);
 	return enqueue_message_result::QUEUED;
 }
 
@@ -638,36 +816,64 @@ bool nc::network_handler::_is_wire_protocol_in_a_reception_state(wire_protocol_s
 		state == wire_protocol_state::RUNNING_RECEIVE_MESSAGE;
 }
 
-void nc::network_handler::_run_wire_protocol(ns::absolute_time_ms current_time_ms) noexcept
+nc::network_handler::assemble_message_result
+nc::network_handler::_assemble_message(ns::absolute_time_ms current_time_ms,
+				       uint8_t& message_type,
+				       uint8_t *message_payload) noexcept
+{
+	if (_message_transmission_state() == message_transmission_state::WAIT_CONFIRMATION) {
+		// The wire protocol reads the reply to our message.
+		return _listening_side_serial().available() ?
+			assemble_message_result::REPLY_PENDING :
+			assemble_message_result::NONE;
+	}
+
+	if (!_is_wire_protocol_in_a_reception_state(_wire_protocol_state())) {
+		return assemble_message_result::NONE;
+	}
+
+	const auto receive_result =
+		_handle_reception(_listening_side_serial(), message_type, message_payload);
+
+	if (receive_result == handle_reception_result::CORRUPTED) {
+		_count(&link_statistics::corrupted_messages);
+	}
+
+	if (receive_result != handle_reception_result::COMPLETE) {
+		/*
+		 * If the message is incomplete, we wait for the remaining data. If the message is
+		 * corrupted, we wait for a retransmission.
+		 */
+		return assemble_message_result::NONE;
+	}
+
+	_count(&link_statistics::messages_received);
+	_last_message_received_time_ms = current_time_ms;
+	send_wire_ok_msg(_listening_side_serial(), is_link_coded(_listening_side()));
+	return assemble_message_result::RECEIVED;
+}
+
+void nc::network_handler::_run_wire_protocol(ns::absolute_time_ms current_time_ms,
+					     bool has_received_message,
+					     uint8_t message_type,
+					     const uint8_t *message_payload) noexcept
 {
 	if (_last_message_received_time_ms < current_time_ms &&
 	    (current_time_ms - _last_message_received_time_ms) >
 		    nsec::config::communication::network_handler_timeout_ms &&
 	    _wire_protocol_state() != wire_protocol_state ::UNCONNECTED) {
 		// No activity for a while... reset.
+		_count(&link_statistics::timeouts);
 		_reset();
 		return;
 	}
 
-	uint8_t message_type;
-	uint8_t message_payload[nsec::config::communication::protocol_max_message_size -
-				sizeof(wire_msg_header)];
-
 	if (_is_wire_protocol_in_a_reception_state(_wire_protocol_state())) {
-		const auto receive_result =
-			_handle_reception(_listening_side_serial(), message_type, message_payload);
-
-		if (receive_result != handle_reception_result::COMPLETE) {
-			/*
-			 * If the message is incomplete, we wait for the remaining data. If the
-			 * message is corrupted, we wait for a retransmission.
-			 */
+		if (!has_received_message) {
+			// Still waiting for a message, assembled by _assemble_message().
 			return;
 		}
 
-		_last_message_received_time_ms = current_time_ms;
-		send_wire_ok_msg(_listening_side_serial());
-
 		if (wire_msg_type(message_type) == wire_msg_type::RESET) {
 			_reset();
 			return;
@@ -818,10 +1024,20 @@ void nc::network_handler::_run_wire_protocol(ns::absolute_time_ms current_time_m
 		break;
 	case wire_protocol_state::RUNNING_RECEIVE_MESSAGE:
 	{
-		if (message_type >=
+		if (wire_msg_type(message_type) == wire_msg_type::CODING_OFFER) {
+			// Code the frames sent to that neighbour if we enabled it too.
+			if (_listening_side() == peer_relative_position::LEFT) {
+				_is_left_link_coded = _is_forward_error_correction_enabled;
+			} else {
+				_is_right_link_coded = _is_forward_error_correction_enabled;
+			}
+		} else if (message_type >=
 		    nsec::config::communication::application_message_type_range_begin) {
 			// Process app-level message
-			nsec::g::the_badge.on_message_received(nc::message::type(message_type), message_payload);
+			ndt::record(ndt::tracepoint::APP_MESSAGE_RECEIVED, message_type);
+			_count(&link_statistics::app_messages_received);
+			nsec::g::the_badge.post_event(nsec::runtime::badge::event::message_received(
+				nc::message::type(message_type), message_payload));
 		} else if (wire_msg_type(message_type) == wire_msg_type::MONITOR) {
 			_wire_protocol_state(wire_protocol_state::RUNNING_SEND_APP_MESSAGE);
 		} else {
@@ -836,15 +1052,37 @@ void nc::network_handler::_run_wire_protocol(ns::absolute_time_ms current_time_m
 	{
 		const auto is_middle_peer = position() ==
 			nc::network_handler::link_position::MIDDLE;
-		const auto pending_matches_wave_front_direction =
-			_pending_outgoing_app_message_direction() == _wave_front_direction();
-
-		if (_has_pending_outgoing_app_message() &&
-		    (!is_middle_peer || (is_middle_peer && pending_matches_wave_front_direction))) {
-			_set_outgoing_message(current_time_ms,
-					      _current_pending_outgoing_app_message_type,
-					      _current_pending_outgoing_app_message_payload);
-			_clear_pending_outgoing_app_message();
+		const auto direction = is_middle_peer ?
+			_wave_front_direction() :
+			(position() == link_position::LEFT_MOST ? peer_relative_position::RIGHT :
+								  peer_relative_position::LEFT);
+		const bool has_offered_coding = direction == peer_relative_position::LEFT ?
+			_has_offered_left_link_coding :
+			_has_offered_right_link_coding;
+
+		if (_is_forward_error_correction_enabled && !has_offered_coding) {
+			// Once per link, ahead of the application's messages. No reply is expected.
+			if (direction == peer_relative_position::LEFT) {
+				_has_offered_left_link_coding = true;
+			} else {
+				_has_offered_right_link_coding = true;
+			}
+
+			_set_outgoing_message(current_time_ms, uint8_t(wire_msg_type::CODING_OFFER));
+			// Not an application message: skip the confirmation step.
+			_wire_protocol_state(wire_protocol_state::RUNNING_SEND_MONITOR);
+		} else if (!_pending_outgoing_app_messages.empty() &&
+			   (!is_middle_peer ||
+			    peer_relative_position(_pending_outgoing_app_messages.front().direction) ==
+				    _wave_front_direction())) {
+			/*
+			 * Messages are sent in order: a middle peer holds the outbox until the wave
+			 * front goes in the direction of the oldest message.
+			 */
+			pending_app_message message;
+
+			_pending_outgoing_app_messages.pop(message);
+			_set_outgoing_message(current_time_ms, message.type, message.payload);
 			_wire_protocol_state(wire_protocol_state::RUNNING_CONFIRM_APP_MESSAGE);
 		} else {
 			// Nothing sent, skip the confirmation step.
@@ -854,7 +1092,10 @@ void nc::network_handler::_run_wire_protocol(ns::absolute_time_ms current_time_m
 		break;
 	}
 	case wire_protocol_state::RUNNING_CONFIRM_APP_MESSAGE:
-		nsec::g::the_badge.on_app_message_sent();
+		ndt::record(ndt::tracepoint::APP_MESSAGE_SENT, _current_message_being_sent_type);
+		_count(&link_statistics::app_messages_sent);
+		nsec::g::the_badge.post_event(nsec::runtime::badge::event::app_message_sent(
+			nc::message::type(_current_message_being_sent_type)));
 		_wire_protocol_state(wire_protocol_state::RUNNING_SEND_MONITOR);
 		break;
 	case wire_protocol_state::RUNNING_SEND_MONITOR:
@@ -873,19 +1114,43 @@ void nc::network_handler::_run_wire_protocol(ns::absolute_time_ms current_time_m
 
 void nc::network_handler::run(ns::absolute_time_ms current_time_ms) noexcept
 {
-	if (_check_connections() == check_connections_result::TOPOLOGY_CHANGED) {
-		/*
-		 * The protocol state has been reset. Resume on the next tick
-		 * to allow our peers enough time to detect the change.
-		 */
-		return;
+	const bool is_wire_protocol_step_due = current_time_ms - _last_wire_protocol_step_time_ms >=
+		nsec::config::communication::network_handler_base_period_ms;
+
+	if (is_wire_protocol_step_due) {
+		_last_wire_protocol_step_time_ms = current_time_ms;
+		if (_check_connections() == check_connections_result::TOPOLOGY_CHANGED) {
+			/*
+			 * The protocol state has been reset. Resume on the next tick
+			 * to allow our peers enough time to detect the change.
+			 */
+			return;
+		}
 	}
 
 	if (_wire_protocol_state() == wire_protocol_state::UNCONNECTED) {
 		return;
 	}
 
-	_run_wire_protocol(current_time_ms);
+	uint8_t message_type;
+	uint8_t message_payload[nsec::config::communication::protocol_max_message_size -
+				sizeof(wire_msg_header)];
+	const auto assemble_result =
+		_assemble_message(current_time_ms, message_type, message_payload);
+
+	if (assemble_result == assemble_message_result::NONE && !is_wire_protocol_step_due) {
+		return;
+	}
+
+	/*
+	 * Act on a received message or reply right away. The next step then follows a full base
+	 * period later, as our neighbours expect.
+	 */
+	_last_wire_protocol_step_time_ms = current_time_ms;
+	_run_wire_protocol(current_time_ms,
+			   assemble_result == assemble_message_result::RECEIVED,
+			   message_type,
+			   message_payload);
 
 	/*
 	 * The network activity LED is "on" when it is this node's turn to broadcast.
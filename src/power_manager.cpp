@@ -0,0 +1,215 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "board.hpp"
+#include "config.hpp"
+#include "diagnostics/flight_recorder.hpp"
+#include "globals.hpp"
+#include "power/manager.hpp"
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+
+namespace np = nsec::power;
+namespace ns = nsec::scheduling;
+namespace ncp = nsec::config::power;
+
+namespace {
+static_assert(ncp::dim_delay_ms < ncp::display_off_delay_ms &&
+		      ncp::display_off_delay_ms < ncp::deep_sleep_delay_ms,
+	      "The power states are entered in order");
+
+// Dark LEDs still draw their idle current.
+constexpr uint32_t dark_leds_current_ua =
+	uint32_t(NUMPIXELS) * nsec::config::led::led_idle_current_ma * 1000;
+
+uint8_t led_scale(np::manager::state state) noexcept
+{
+	switch (state) {
+	case np::manager::state::ACTIVE:
+		return 255;
+	case np::manager::state::DIMMED:
+		return ncp::dimmed_led_scale;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Power down until a pin change of the buttons or the connection lines (left RX, D2, and
+ * right sense, D7). Their interrupt vectors are defined by SoftwareSerial, which ignores
+ * them while no instance is listening.
+ */
+void power_down() noexcept
+{
+	const uint8_t pcicr = PCICR;
+	const uint8_t pcmsk1 = PCMSK1;
+	const uint8_t pcmsk2 = PCMSK2;
+	const uint8_t adcsra = ADCSRA;
+	uint8_t wake_up_groups = _BV(PCIE1) | _BV(PCIE2);
+
+	// UP, RIGHT, DOWN and LEFT.
+	PCMSK1 |= _BV(PCINT8) | _BV(PCINT9) | _BV(PCINT10) | _BV(PCINT11);
+	PCMSK2 |= _BV(PCINT18) | _BV(PCINT23);
+#if defined(__AVR_ATmega328PB__)
+	// OK and CANCEL, already enabled by the button watcher.
+	wake_up_groups |= _BV(PCIE3);
+#endif
+
+	// Forget the edges latched while awake (PCIFn and PCIEn are at the same positions).
+	PCIFR = wake_up_groups;
+	PCICR |= wake_up_groups;
+	// The ADC would keep drawing current.
+	ADCSRA = 0;
+
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	noInterrupts();
+	sleep_enable();
+	// The instruction following sei() runs before any pending interrupt: an edge that
+	// occurred in the meantime wakes the MCU right away.
+	interrupts();
+	sleep_cpu();
+	sleep_disable();
+
+	ADCSRA = adcsra;
+	PCICR = pcicr;
+	PCMSK1 = pcmsk1;
+	PCMSK2 = pcmsk2;
+}
+} // anonymous namespace
+
+np::manager::manager(display::renderer& renderer,
+		     led::strip_animator& strip_animator,
+		     communication::network_handler& network_handler,
+		     button::watcher& button_watcher) noexcept :
+	periodic_task(ncp::manager_period_ms),
+	_renderer{ renderer },
+	_strip_animator{ strip_animator },
+	_network_handler{ network_handler },
+	_button_watcher{ button_watcher },
+	_last_activity_ms{ 0 },
+	_current_state{ state::ACTIVE }
+{
+	nsec::g::the_scheduler.schedule_task(*this);
+}
+
+void np::manager::on_activity() noexcept
+{
+	_last_activity_ms = millis();
+	if (_current_state == state::DISPLAY_OFF || _current_state == state::DEEP_SLEEP) {
+		// The buttons pressed while the display was off must not act on the screen.
+		_button_watcher.drop_pending_events();
+	}
+
+	_state(state::ACTIVE);
+}
+
+void np::manager::check_wake_up_sources() noexcept
+{
+	if (_current_state != state::ACTIVE && _button_watcher.has_pending_events()) {
+		on_activity();
+	}
+}
+
+void np::manager::idle(ns::relative_time_ms time_to_next_tick) noexcept
+{
+	if (time_to_next_tick == 0) {
+		return;
+	}
+
+	// Timer0's overflow interrupt, which drives millis(), ends the sleep within 1.024 ms.
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_mode();
+}
+
+ns::absolute_time_ms np::manager::inactive_time_ms() const noexcept
+{
+	return millis() - _last_activity_ms;
+}
+
+uint32_t np::manager::estimated_current_ua(state for_state) const noexcept
+{
+	uint32_t current_ua = for_state == state::DEEP_SLEEP ? ncp::mcu_power_down_current_ua :
+							       ncp::mcu_idle_current_ua;
+
+	switch (for_state) {
+	case state::ACTIVE:
+		current_ua += ncp::display_on_current_ua;
+		break;
+	case state::DIMMED:
+		current_ua += ncp::display_dimmed_current_ua;
+		break;
+	default:
+		current_ua += ncp::display_off_current_ua;
+		break;
+	}
+
+	// Scale the current drawn by the frames being shown to the state's LED scale.
+	const uint32_t leds_current_ua = uint32_t(_strip_animator.average_current_ma()) * 1000;
+	const uint32_t frames_current_ua =
+		leds_current_ua > dark_leds_current_ua ? leds_current_ua - dark_leds_current_ua : 0;
+	const uint8_t current_scale = led_scale(_current_state);
+
+	current_ua += dark_leds_current_ua;
+	if (current_scale) {
+		current_ua += frames_current_ua * led_scale(for_state) / current_scale;
+	}
+
+	return current_ua;
+}
+
+void np::manager::run(ns::absolute_time_ms current_time_ms) noexcept
+{
+	const auto inactive_time_ms = current_time_ms - _last_activity_ms;
+
+	if (inactive_time_ms >= ncp::deep_sleep_delay_ms &&
+	    _network_handler.position() ==
+		    communication::network_handler::link_position::UNKNOWN) {
+		_deep_sleep();
+	} else if (inactive_time_ms >= ncp::display_off_delay_ms) {
+		_state(state::DISPLAY_OFF);
+	} else if (inactive_time_ms >= ncp::dim_delay_ms) {
+		_state(state::DIMMED);
+	}
+}
+
+void np::manager::_state(state new_state) noexcept
+{
+	if (new_state == _current_state) {
+		return;
+	}
+
+	_current_state = new_state;
+	_strip_animator.power_save_scale(led_scale(new_state));
+	switch (new_state) {
+	case state::ACTIVE:
+		_renderer.set_power_mode(display::renderer::power_mode::NORMAL);
+		break;
+	case state::DIMMED:
+		_renderer.set_power_mode(display::renderer::power_mode::DIMMED);
+		break;
+	case state::DISPLAY_OFF:
+	case state::DEEP_SLEEP:
+		_renderer.set_power_mode(display::renderer::power_mode::OFF);
+		break;
+	}
+}
+
+void np::manager::_deep_sleep() noexcept
+{
+	// The LEDs went dark while the display was off.
+	_state(state::DEEP_SLEEP);
+	_network_handler.suspend();
+	// The watchdog would wake the badge up, through a reset.
+	nsec::diagnostics::flight_recorder::pause_watchdog();
+	power_down();
+	nsec::diagnostics::flight_recorder::resume_watchdog();
+	_network_handler.resume();
+
+	// The pin change that woke the MCU was consumed by its interrupt.
+	_button_watcher.wake_up();
+	on_activity();
+}
@@ -0,0 +1,169 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "config.hpp"
+#include "diagnostics/profiler.hpp"
+#include "unique_id.hpp"
+
+#include <Arduino.h>
+
+#ifdef NSEC_PROFILER
+
+namespace ndp = nsec::diagnostics::profiler;
+
+namespace {
+constexpr uint8_t bucket_count = nsec::config::diagnostics::profiler_bucket_count;
+constexpr uint8_t bucket_shift = nsec::config::diagnostics::profiler_bucket_shift;
+constexpr uint8_t dump_format_version = 1;
+// Timer2 runs at F_CPU / 64 in CTC mode.
+constexpr unsigned long timer_prescaler = 64;
+constexpr unsigned long timer_top =
+	F_CPU / timer_prescaler / nsec::config::diagnostics::profiler_sample_rate_hz - 1;
+
+static_assert(timer_top <= UINT8_MAX, "The sample rate is too low for Timer2");
+static_assert((uint32_t(bucket_count) << bucket_shift) > FLASHEND,
+	      "The profiler's buckets must cover the flash");
+
+// Only written by the interrupt handler while sampling.
+uint16_t histogram[bucket_count];
+bool is_full;
+
+// Called by the interrupt handler with the interrupted program counter (in words).
+void record_sample(uint16_t pc) noexcept
+{
+	auto& count = histogram[pc >> (bucket_shift - 1)];
+
+	if (++count == UINT16_MAX) {
+		// Stop here rather than distort the proportions.
+		is_full = true;
+		TIMSK2 = 0;
+	}
+}
+
+void pause() noexcept
+{
+	TIMSK2 = 0;
+}
+
+void resume() noexcept
+{
+	if (!is_full) {
+		TIMSK2 = _BV(OCIE2A);
+	}
+}
+
+void print_hex_word(Print& print, uint16_t value)
+{
+	for (int8_t shift = 12; shift >= 0; shift -= 4) {
+		print.print((value >> shift) & 0xF, HEX);
+	}
+}
+} // anonymous namespace
+
+/*
+ * The interrupted program counter is the handler's return address: it is pushed, most
+ * significant byte last, just before the registers saved here. The registers clobbered by
+ * a call are saved by hand since a regular handler's prologue varies with its code.
+ */
+ISR(TIMER2_COMPA_vect, ISR_NAKED)
+{
+	asm volatile("push r1\n\t"
+		     "push r0\n\t"
+		     "in r0, __SREG__\n\t"
+		     "push r0\n\t"
+		     "clr r1\n\t"
+		     "push r18\n\t"
+		     "push r19\n\t"
+		     "push r20\n\t"
+		     "push r21\n\t"
+		     "push r22\n\t"
+		     "push r23\n\t"
+		     "push r24\n\t"
+		     "push r25\n\t"
+		     "push r26\n\t"
+		     "push r27\n\t"
+		     "push r30\n\t"
+		     "push r31\n\t"
+		     // SP points below the last byte pushed; 15 bytes were saved above.
+		     "in r30, __SP_L__\n\t"
+		     "in r31, __SP_H__\n\t"
+		     "ldd r25, Z+16\n\t"
+		     "ldd r24, Z+17\n\t"
+		     "call %x[record_sample]\n\t"
+		     "pop r31\n\t"
+		     "pop r30\n\t"
+		     "pop r27\n\t"
+		     "pop r26\n\t"
+		     "pop r25\n\t"
+		     "pop r24\n\t"
+		     "pop r23\n\t"
+		     "pop r22\n\t"
+		     "pop r21\n\t"
+		     "pop r20\n\t"
+		     "pop r19\n\t"
+		     "pop r18\n\t"
+		     "pop r0\n\t"
+		     "out __SREG__, r0\n\t"
+		     "pop r0\n\t"
+		     "pop r1\n\t"
+		     "reti" ::[record_sample] "i"(record_sample));
+}
+
+void ndp::start() noexcept
+{
+	// Timer2 is otherwise unused: the badge drives none of its PWM outputs.
+	TIMSK2 = 0;
+	TCCR2A = _BV(WGM21);
+	TCCR2B = _BV(CS22);
+	OCR2A = timer_top;
+	TCNT2 = 0;
+	TIFR2 = _BV(OCF2A);
+	resume();
+}
+
+void ndp::dump(Print& print)
+{
+	pause();
+
+	print.print(F("nsec-profile "));
+	print.println(dump_format_version);
+
+	print.print(F("badge "));
+	for (uint8_t i = 0; i < UniqueIDsize; i++) {
+		if (UniqueID[i] < 0x10) {
+			print.print('0');
+		}
+
+		print.print(UniqueID[i], HEX);
+	}
+
+	print.println();
+	print.print(F("sample_rate_hz "));
+	print.println(nsec::config::diagnostics::profiler_sample_rate_hz);
+	print.print(F("bucket_shift "));
+	print.println(bucket_shift);
+	print.print(F("full "));
+	print.println(is_full ? 1 : 0);
+
+	// "bucket <first byte address> <sample count>", for the buckets holding samples.
+	for (uint8_t i = 0; i < bucket_count; i++) {
+		if (!histogram[i]) {
+			continue;
+		}
+
+		print.print(F("bucket "));
+		print_hex_word(print, uint16_t(i) << bucket_shift);
+		print.print(' ');
+		print.println(histogram[i]);
+		histogram[i] = 0;
+	}
+
+	print.println(F("end"));
+	is_full = false;
+	resume();
+}
+
+#endif // NSEC_PROFILER
@@ -0,0 +1,46 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+/*
+ * Size of the classes making up the static RAM usage, reported after each build by
+ * scripts/ram_report.py.
+ *
+ * The sizes are emitted in a non-allocated section of the ELF file: they take no room in
+ * flash or RAM. Each entry is the class name, null-terminated, followed by its size as a
+ * 16-bit little-endian word.
+ */
+
+#include "badge.hpp"
+#include "globals.hpp"
+
+#define NSEC_RAM_REPORT_CLASS(type)                                  \
+	asm volatile(".pushsection .nsec.ram_report, \"\"\n\t"       \
+		     ".asciz \"" #type "\"\n\t"                      \
+		     ".2byte %c0\n\t"                                \
+		     ".popsection" ::"n"(sizeof(type)))
+
+namespace {
+using badge_scheduler = decltype(nsec::g::the_scheduler);
+
+// Never called: only its assembly matters.
+__attribute__((used)) void report_class_sizes()
+{
+	NSEC_RAM_REPORT_CLASS(nsec::runtime::badge);
+	NSEC_RAM_REPORT_CLASS(badge_scheduler);
+	NSEC_RAM_REPORT_CLASS(nsec::display::renderer);
+	NSEC_RAM_REPORT_CLASS(nsec::communication::network_handler);
+	NSEC_RAM_REPORT_CLASS(SoftwareSerial);
+	NSEC_RAM_REPORT_CLASS(nsec::led::strip_animator);
+	NSEC_RAM_REPORT_CLASS(nsec::button::watcher);
+	NSEC_RAM_REPORT_CLASS(nsec::display::menu_screen);
+	NSEC_RAM_REPORT_CLASS(nsec::display::main_menu_choices);
+	NSEC_RAM_REPORT_CLASS(nsec::display::string_property_editor_screen);
+	NSEC_RAM_REPORT_CLASS(nsec::display::splash_screen);
+	NSEC_RAM_REPORT_CLASS(nsec::display::scroll_screen);
+	NSEC_RAM_REPORT_CLASS(nsec::display::text_screen);
+	NSEC_RAM_REPORT_CLASS(nsec::diagnostics::console);
+}
+} // anonymous namespace
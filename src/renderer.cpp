@@ -5,6 +5,8 @@
  */
 
 #include "board.hpp"
+#include "diagnostics/latency.hpp"
+#include "diagnostics/trace.hpp"
 #include "display/renderer.hpp"
 #include "globals.hpp"
 
@@ -15,11 +17,13 @@ namespace {
 constexpr uint16_t render_time_sampling_period = 300;
 };
 
-nd::renderer::renderer(nd::screen **focused_screen) noexcept :
+nd::renderer::renderer(nd::screen **focused_screen, nd::input_dispatcher dispatch_input) noexcept :
 	periodic_task(nsec::config::display::refresh_period_ms),
 	_display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET),
 	_render_time_sampling_counter{ 0 },
-	_focused_screen{ focused_screen }
+	_power_mode{ power_mode::NORMAL },
+	_focused_screen{ focused_screen },
+	_dispatch_input{ dispatch_input }
 {
 	nsec::g::the_scheduler.schedule_task(*this);
 }
@@ -33,22 +37,101 @@ void nd::renderer::setup() noexcept
 	_display.display();
 }
 
+void nd::renderer::set_power_mode(power_mode mode) noexcept
+{
+	if (mode == _power_mode) {
+		return;
+	}
+
+	if (_power_mode == power_mode::OFF) {
+		_display.ssd1306_command(SSD1306_DISPLAYON);
+		revive();
+		if (!scheduled()) {
+			nsec::g::the_scheduler.schedule_task(*this);
+		}
+	}
+
+	_power_mode = mode;
+	switch (mode) {
+	case power_mode::NORMAL:
+		_display.dim(false);
+		period_ms(nsec::config::display::refresh_period_ms);
+		break;
+	case power_mode::DIMMED:
+		_display.dim(true);
+		period_ms(nsec::config::power::dimmed_refresh_period_ms);
+		break;
+	case power_mode::OFF:
+		_display.ssd1306_command(SSD1306_DISPLAYOFF);
+		kill();
+		break;
+	}
+}
+
 void nd::renderer::run(scheduling::absolute_time_ms current_time_ms) noexcept
 {
+	// May change the focused screen.
+	_dispatch_input(current_time_ms);
+
 	if (!focused_screen().is_damaged()) {
 		return;
 	}
 
-	if (focused_screen().cleared_on_every_frame()) {
+	const bool flush_frame = focused_screen().cleared_on_every_frame();
+#ifdef NSEC_CONSOLE
+	const auto frame_start_us = micros();
+#endif
+
+	nsec::diagnostics::trace::record(nsec::diagnostics::trace::tracepoint::RENDER_BEGIN);
+	if (flush_frame) {
 		_display.clearDisplay();
 	}
 
 	focused_screen().render(current_time_ms, _display);
-	if (focused_screen().cleared_on_every_frame()) {
+	if (flush_frame) {
 		_display.display();
 	}
 
+	nsec::diagnostics::trace::record(nsec::diagnostics::trace::tracepoint::RENDER_END,
+					 flush_frame);
+#ifdef NSEC_CONSOLE
+	const auto frame_time_us = micros() - frame_start_us;
+
+	_statistics.frame_count++;
+	_statistics.flushed_frame_count += flush_frame;
+	_statistics.total_frame_time_us += frame_time_us;
+	if (frame_time_us > _statistics.longest_frame_us) {
+		_statistics.longest_frame_us = frame_time_us < UINT16_MAX ? frame_time_us :
+									    UINT16_MAX;
+	}
+#endif
+
+	nsec::diagnostics::latency::on_frame_flushed(millis());
+
 	if (++_render_time_sampling_counter == render_time_sampling_period) {
 		_render_time_sampling_counter = 0;
 	}
 }
+
+#ifdef NSEC_CONSOLE
+void nd::renderer::benchmark(uint8_t iterations,
+			     unsigned long& render_time_us,
+			     unsigned long& flush_time_us) noexcept
+{
+	const auto render_start_us = micros();
+
+	for (uint8_t i = 0; i < iterations; i++) {
+		_display.clearDisplay();
+		focused_screen().render(millis(), _display);
+	}
+
+	const auto flush_start_us = micros();
+
+	for (uint8_t i = 0; i < iterations; i++) {
+		_display.display();
+	}
+
+	render_time_us = (flush_start_us - render_start_us) / iterations;
+	flush_time_us = (micros() - flush_start_us) / iterations;
+}
+#endif
@@ -7,59 +7,16 @@
 
 #include "display/menu/main_menu_choices.hpp"
 
-#include <Arduino.h>
-
 namespace nd = nsec::display;
 
-namespace {
-const char user_name_entry_option_name[] PROGMEM = "Set name";
-const char badge_id_option_name[] PROGMEM = "Badge information";
-const char factory_reset_option_name[] PROGMEM = "Factory reset";
-
-const __FlashStringHelper *as_flash_string(const char *str)
-{
-	return static_cast<const __FlashStringHelper *>(static_cast<const void *>(str));
-}
-} // anonymous namespace
-
-nd::main_menu_choices::main_menu_choices(const choice_action& set_name_action,
-					 const choice_action& show_badge_info_action,
-					 const choice_action& factory_reset_action) noexcept :
-	_set_name_action{ set_name_action },
-	_show_badge_info_action{ show_badge_info_action },
-	_factory_reset_action{ factory_reset_action },
-	_choices{
-		nd::menu_screen::choices::choice(
-			as_flash_string(user_name_entry_option_name),
-			nd::menu_screen::choices::choice::menu_choice_action(
-				[](void *data) {
-					reinterpret_cast<nd::main_menu_choices *>(data)
-						->_set_name_action();
-				},
-				this)),
-		nd::menu_screen::choices::choice(
-			as_flash_string(badge_id_option_name),
-			nd::menu_screen::choices::choice::menu_choice_action(
-				[](void *data) {
-					reinterpret_cast<nd::main_menu_choices *>(data)
-						->_show_badge_info_action();
-				},
-				this)),
-		nd::menu_screen::choices::choice(
-			as_flash_string(factory_reset_option_name),
-			nd::menu_screen::choices::choice::menu_choice_action(
-				[](void *data) {
-					reinterpret_cast<nd::main_menu_choices *>(data)
-						->_factory_reset_action();
-				},
-				this)),
-	}
+nd::main_menu_choices::main_menu_choices(const choice *choices, uint8_t count) noexcept :
+	_choices{ choices }, _count{ count }
 {
 }
 
 uint8_t nd::main_menu_choices::count() const noexcept
 {
-	return sizeof(_choices) / sizeof(_choices[0]);
+	return _count;
 }
 
 const nd::menu_screen::choices::choice&
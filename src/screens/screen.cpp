@@ -4,6 +4,7 @@
  * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
  */
 
+#include "badge.hpp"
 #include "display/screen.hpp"
 #include "globals.hpp"
 
@@ -13,5 +14,5 @@ nsec::display::screen::screen() noexcept : _cleared_on_every_frame{ true }
 
 void nsec::display::screen::_release_focus() noexcept
 {
-	nsec::g::the_badge.relase_focus_current_screen();
+	nsec::g::the_badge.post_event(nsec::runtime::badge::event::release_focus());
 }
\ No newline at end of file
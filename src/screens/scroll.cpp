@@ -4,6 +4,7 @@
  * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
  */
 
+#include "badge.hpp"
 #include "display/screen.hpp"
 #include "display/scroll.hpp"
 #include "display/utils.hpp"
@@ -83,17 +84,17 @@ void nd::scroll_screen::button_event(nb::id id, nb::event event) noexcept
 
 	// Shortcut to the text screen
 	if (id == nb::id::UP && event == nb::event::DOWN_REPEAT) {
-		nsec::g::the_badge.show_badge_info();
+		nsec::g::the_badge.post_event(nsec::runtime::badge::event::show_badge_info());
 
 		// Queue a redraw on next rendering tick.
 		damage();
 	}
 
 	if (id == nb::id::LEFT || id == nb::id::RIGHT) {
-		nsec::g::the_badge.cycle_selected_animation(
+		nsec::g::the_badge.post_event(nsec::runtime::badge::event::cycle_selected_animation(
 			id == nb::id::LEFT ?
 				nsec::runtime::badge::cycle_animation_direction::PREVIOUS :
-				nsec::runtime::badge::cycle_animation_direction::NEXT);
+				nsec::runtime::badge::cycle_animation_direction::NEXT));
 	}
 }
 
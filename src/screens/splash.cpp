@@ -4,6 +4,7 @@
  * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
  */
 
+#include "badge.hpp"
 #include "display/splash.hpp"
 #include "display/utils.hpp"
 #include "globals.hpp"
@@ -30,7 +31,7 @@ void nd::splash_screen::_render(scheduling::absolute_time_ms current_time_ms [[m
 void nd::splash_screen::one_shot_timer_task::run(ns::absolute_time_ms current_time
 						 [[maybe_unused]]) noexcept
 {
-	nsec::g::the_badge.on_splash_complete();
+	nsec::g::the_badge.post_event(nsec::runtime::badge::event::splash_complete());
 }
 
 void nd::splash_screen::focused() noexcept
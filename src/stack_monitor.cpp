@@ -0,0 +1,181 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "config.hpp"
+#include "diagnostics/stack_monitor.hpp"
+
+#include <Arduino.h>
+
+#ifdef NSEC_STACK_MONITOR
+
+namespace nsm = nsec::diagnostics::stack_monitor;
+namespace ns = nsec::scheduling;
+
+// Provided by the avr-libc linker script and malloc.
+extern "C" {
+extern uint8_t __data_start;
+extern uint8_t __heap_start;
+extern uint8_t __stack;
+extern char *__brkval;
+}
+
+namespace {
+constexpr uint8_t canary = 0xC5;
+constexpr uint8_t tracked_task_count = nsec::config::scheduler::max_scheduled_task_count;
+
+struct task_stack_usage {
+	const ns::task *task;
+	uint16_t deepest_bytes;
+};
+
+task_stack_usage task_usages[tracked_task_count];
+// Deepest stack use since boot, all contexts included.
+uint16_t deepest_stack_bytes;
+uint8_t runs_since_last_sample;
+bool is_sampling;
+
+/*
+ * Runs before .data and .bss are initialized, once the stack pointer and the zero
+ * register are set: nothing lives on the stack yet.
+ */
+__attribute__((naked, used, section(".init3"))) void paint_free_ram()
+{
+	for (auto *byte = &__heap_start; byte <= &__stack; byte++) {
+		*byte = canary;
+	}
+}
+
+const uint8_t *heap_end() noexcept
+{
+	return __brkval ? reinterpret_cast<const uint8_t *>(__brkval) : &__heap_start;
+}
+
+uint8_t *stack_pointer() noexcept
+{
+	return reinterpret_cast<uint8_t *>(SP);
+}
+
+// Lowest byte written since it was painted (the stack pointer if none was).
+uint8_t *lowest_used_byte() noexcept
+{
+	auto *byte = const_cast<uint8_t *>(heap_end());
+	const auto *const top = stack_pointer();
+
+	while (byte < top && *byte == canary) {
+		byte++;
+	}
+
+	return byte;
+}
+
+uint16_t depth_bytes(const uint8_t *lowest_byte) noexcept
+{
+	return uint16_t(&__stack - lowest_byte) + 1;
+}
+
+// Update the deepest stack use since boot and return the lowest used byte.
+uint8_t *update_deepest_stack_use() noexcept
+{
+	auto *const lowest_byte = lowest_used_byte();
+	const auto depth = depth_bytes(lowest_byte);
+
+	if (depth > deepest_stack_bytes) {
+		deepest_stack_bytes = depth;
+	}
+
+	return lowest_byte;
+}
+
+void record_task_depth(const ns::task& task, uint16_t depth) noexcept
+{
+	for (auto& usage : task_usages) {
+		if (usage.task != &task && usage.task != nullptr) {
+			continue;
+		}
+
+		usage.task = &task;
+		if (depth > usage.deepest_bytes) {
+			usage.deepest_bytes = depth;
+		}
+
+		return;
+	}
+}
+
+void print_bytes(Print& print, const __FlashStringHelper *label, uint16_t bytes)
+{
+	print.print(label);
+	print.print(bytes);
+	print.print(F(" B"));
+}
+} // anonymous namespace
+
+void nsm::on_task_run_begin(const ns::task&) noexcept
+{
+	if (++runs_since_last_sample < nsec::config::diagnostics::stack_sample_period) {
+		return;
+	}
+
+	runs_since_last_sample = 0;
+
+	// Catch what ran since the last sample, then repaint the bytes it used.
+	auto *byte = update_deepest_stack_use();
+	const auto *const top = stack_pointer();
+
+	while (byte < top) {
+		*byte++ = canary;
+	}
+
+	is_sampling = true;
+}
+
+void nsm::on_task_run_end(const ns::task& task) noexcept
+{
+	if (!is_sampling) {
+		return;
+	}
+
+	is_sampling = false;
+	record_task_depth(task, depth_bytes(update_deepest_stack_use()));
+}
+
+void nsm::print_summary(Print& print)
+{
+	update_deepest_stack_use();
+
+	const auto free_bytes = uint16_t(&__stack - heap_end()) + 1;
+
+	print_bytes(print, F("Static: "), uint16_t(&__heap_start - &__data_start));
+	print.println();
+	print_bytes(print, F("Heap:   "), uint16_t(heap_end() - &__heap_start));
+	print.println();
+	print_bytes(print, F("Stack:  "), deepest_stack_bytes);
+	print.println();
+	// Between the heap and the deepest stack use since boot.
+	print_bytes(print,
+		    F("Unused: "),
+		    free_bytes > deepest_stack_bytes ? free_bytes - deepest_stack_bytes : 0);
+}
+
+void nsm::dump(Print& print)
+{
+	print_summary(print);
+	print.println();
+
+	for (const auto& usage : task_usages) {
+		if (!usage.task) {
+			break;
+		}
+
+		print.print(F("task 0x"));
+		print.print(uint16_t(uintptr_t(usage.task)), HEX);
+		print.print(F(": "));
+		print.print(usage.deepest_bytes);
+		print.println(F(" B"));
+	}
+}
+
+#endif // NSEC_STACK_MONITOR
@@ -5,25 +5,37 @@
  */
 
 #include "board.hpp"
+#include "diagnostics/latency.hpp"
 #include "globals.hpp"
 #include "led/strip_animator.hpp"
+#include "unique_id.hpp"
 
+namespace nc = nsec::config;
 namespace nl = nsec::led;
 namespace ns = nsec::scheduling;
 namespace ng = nsec::g;
 
 #define ARRAY_LENGTH(array) (sizeof(array)/sizeof(*array))
 
+#ifdef NSEC_LED_PREVIEW
+/* Cost counters of the host-side previewer (see tools/led_preview). */
+#include "led_preview_probes.hpp"
+#else
+#define NSEC_LED_PREVIEW_PROBE(counter)
+#endif
+
 namespace {
 constexpr int16_t scaling_factor = 1024;
 
 // Linear interpolation in RGB space: not terrible, not great...
-nl::strip_animator::led_color interpolate(const nl::strip_animator::keyframe& origin,
-					  const nl::strip_animator::keyframe& destination,
-					  uint16_t current_time)
+NSEC_BENCHMARKED nl::strip_animator::led_color
+interpolate(const nl::strip_animator::keyframe& origin,
+	    const nl::strip_animator::keyframe& destination,
+	    uint16_t current_time)
 {
 	nl::strip_animator::led_color new_color;
 
+	NSEC_LED_PREVIEW_PROBE(interpolate);
 	if (current_time >= destination.time) {
 		return destination.color;
 	}
@@ -43,6 +55,69 @@ nl::strip_animator::led_color interpolate(const nl::strip_animator::keyframe& or
 	return new_color;
 }
 
+// xorshift16: cheap enough to draw a number every time a spark dies out.
+uint16_t next_random(uint16_t& state) noexcept
+{
+	state ^= state << 7;
+	state ^= state >> 9;
+	state ^= state << 8;
+	return state;
+}
+
+constexpr uint8_t dim_brightness = 50;
+constexpr uint8_t bright_brightness = 120;
+
+#ifndef NSEC_LED_COLOR_CORRECTION_TABLE_IN_RAM
+/*
+ * Gamma correction (gamma = 2.6, as used by the NeoPixel library's gamma8()) and brightness
+ * scaling folded in a single lookup, one bank per brightness used by the animations.
+ */
+// Generated by scripts/color_correction_tables.py, brightness = 50.
+const uint8_t PROGMEM dim_color_correction_table[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5,
+	5, 6, 6, 6, 6, 6, 6, 6, 7, 7, 7, 7, 7, 7, 8, 8,
+	8, 8, 8, 8, 9, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11,
+	11, 11, 11, 12, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14,
+	15, 15, 15, 15, 16, 16, 16, 16, 17, 17, 17, 17, 18, 18, 18, 19,
+	19, 19, 19, 20, 20, 20, 21, 21, 21, 22, 22, 22, 22, 23, 23, 23,
+	24, 24, 24, 25, 25, 25, 26, 26, 27, 27, 27, 28, 28, 28, 29, 29,
+	29, 30, 30, 31, 31, 31, 32, 32, 33, 33, 33, 34, 34, 35, 35, 35,
+	36, 36, 37, 37, 38, 38, 38, 39, 39, 40, 40, 41, 41, 42, 42, 42,
+	43, 43, 44, 44, 45, 45, 46, 46, 47, 47, 48, 48, 49, 49, 50, 50,
+};
+
+// Generated by scripts/color_correction_tables.py, brightness = 120.
+const uint8_t PROGMEM bright_color_correction_table[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3,
+	3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5,
+	6, 6, 6, 6, 6, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 9,
+	9, 9, 9, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12, 13, 13, 13,
+	14, 14, 14, 15, 15, 16, 16, 16, 17, 17, 17, 17, 18, 18, 19, 19,
+	19, 20, 20, 21, 21, 22, 22, 23, 23, 24, 24, 25, 25, 25, 26, 26,
+	27, 27, 28, 28, 29, 29, 30, 30, 31, 32, 32, 33, 33, 34, 34, 35,
+	35, 36, 36, 37, 38, 38, 39, 40, 40, 41, 42, 42, 43, 43, 44, 45,
+	45, 46, 47, 48, 48, 49, 50, 51, 51, 52, 52, 53, 54, 55, 56, 56,
+	57, 58, 59, 60, 60, 61, 62, 63, 64, 64, 65, 66, 67, 68, 69, 69,
+	70, 71, 72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85,
+	86, 86, 87, 88, 90, 91, 92, 93, 94, 95, 96, 97, 98, 99, 100, 101,
+	103, 103, 105, 106, 107, 108, 109, 111, 112, 113, 114, 115, 116, 118, 119, 120,
+};
+#endif
+
+uint8_t scale_to_brightness(uint8_t component, uint8_t brightness) noexcept
+{
+	return (component * (brightness + 1)) >> 8;
+}
+
 nl::strip_animator::keyframe keyframe_from_flash(const nl::strip_animator::keyframe *src_keyframe)
 {
 	const auto r = pgm_read_byte(&src_keyframe->color.r());
@@ -208,8 +283,8 @@ shooting_star_parameters shooting_star_parameters_from_flash(const shooting_star
 	value.shooting_star_count = pgm_read_byte(&params->shooting_star_count);
 	value.delay_advance_ms = pgm_read_word(&params->delay_advance_ms);
 
-	static_assert(sizeof(value.keyframes) == sizeof(uint16_t));
-	value.keyframes = reinterpret_cast<const nl::strip_animator::keyframe*>(pgm_read_word(&params->keyframes));
+	value.keyframes = reinterpret_cast<const nl::strip_animator::keyframe *>(
+		pgm_read_ptr(&params->keyframes));
 	value.keyframe_count = pgm_read_byte(&params->keyframe_count);
 
 	return value;
@@ -603,9 +678,8 @@ color_cycle_parameters color_cycle_parameters_from_flash(const color_cycle_param
 
 	value.active_pattern = pgm_read_word(&params->active_pattern);
 	value.cycle_offset = pgm_read_byte(&params->cycle_offset);
-	static_assert(sizeof(value.keyframes) == sizeof(uint16_t));
 	value.keyframes = reinterpret_cast<const nl::strip_animator::keyframe *>(
-		pgm_read_word(&params->keyframes));
+		pgm_read_ptr(&params->keyframes));
 	value.keyframe_count = pgm_read_byte(&params->keyframe_count);
 
 	return value;
@@ -613,19 +687,85 @@ color_cycle_parameters color_cycle_parameters_from_flash(const color_cycle_param
 
 } // namespace color_cycle
 
+namespace sparks {
+struct sparks_parameters {
+	const nl::strip_animator::keyframe *keyframes;
+	uint8_t keyframe_count;
+	// A spark is born on each LED after a random delay of [0, max_birth_delay_ms[.
+	uint16_t max_birth_delay_ms;
+};
+
+/*
+ * The spark keyframes end with a long pause so that they can be used as cycles. That pause
+ * is dropped here since the delay between sparks is random.
+ */
+const sparks_parameters PROGMEM params[] = {
+	{ color_cycle::color_cycle_spark_1_keyframes,
+	  ARRAY_LENGTH(color_cycle::color_cycle_spark_1_keyframes) - 1,
+	  4000 },
+	{ color_cycle::color_cycle_spark_1_keyframes,
+	  ARRAY_LENGTH(color_cycle::color_cycle_spark_1_keyframes) - 1,
+	  1500 },
+	{ color_cycle::color_cycle_spark_2_keyframes,
+	  ARRAY_LENGTH(color_cycle::color_cycle_spark_2_keyframes) - 1,
+	  4000 },
+	{ color_cycle::color_cycle_spark_2_keyframes,
+	  ARRAY_LENGTH(color_cycle::color_cycle_spark_2_keyframes) - 1,
+	  1500 },
+	{ color_cycle::color_cycle_spark_3_keyframes,
+	  ARRAY_LENGTH(color_cycle::color_cycle_spark_3_keyframes) - 1,
+	  4000 },
+	{ color_cycle::color_cycle_spark_3_keyframes,
+	  ARRAY_LENGTH(color_cycle::color_cycle_spark_3_keyframes) - 1,
+	  1500 },
+};
+
+sparks_parameters sparks_parameters_from_flash(const sparks_parameters *params)
+{
+	sparks_parameters value;
+
+	value.keyframes = reinterpret_cast<const nl::strip_animator::keyframe *>(
+		pgm_read_ptr(&params->keyframes));
+	value.keyframe_count = pgm_read_byte(&params->keyframe_count);
+	value.max_birth_delay_ms = pgm_read_word(&params->max_birth_delay_ms);
+
+	return value;
+}
+} // namespace sparks
 
 } // namespace keyframes
 
 nl::strip_animator::strip_animator() noexcept :
 	ns::periodic_task(100) /* Set by the various animations. */,
-	_pixels(NUMPIXELS, P_NEOP, NEO_GRB + NEO_KHZ800)
+	_pixels(NUMPIXELS, P_NEOP, NEO_GRB + NEO_KHZ800),
+	_power_limit_scale(255),
+	_power_save_scale(255),
+	_is_suspended(false),
+	_average_current_ma_x16(0)
 {
+#ifdef NSEC_LED_COLOR_CORRECTION_TABLE_IN_RAM
+	// Force the computation of the initial table.
+	_color_correction_table_brightness = ~dim_brightness;
+#endif
+	_brightness(dim_brightness);
+
 	ng::the_scheduler.schedule_task(*this);
 }
 
 void nl::strip_animator::setup() noexcept
 {
 	_pixels.begin();
+
+	// Seed the random number generator so that no two badges sparkle alike.
+	_random_state = 1;
+	for (uint8_t i = 0; i < UniqueIDsize; i++) {
+		_random_state = (_random_state << 5) + _random_state + UniqueID[i];
+	}
+
+	if (_random_state == 0) {
+		// xorshift never leaves the zero state.
+		_random_state = 0xACE1;
+	}
 }
 
 uint8_t nl::strip_animator::_get_keyframe_index(const indice_storage_element *indices,
@@ -652,112 +792,138 @@ void nl::strip_animator::_set_keyframe_index(indice_storage_element *indices,
 void nl::strip_animator::_keyframe_animation_tick(
 	const scheduling::absolute_time_ms& current_time_ms) noexcept
 {
+	// Keyframe times are 16-bit wide, so are the animation start times.
+	const uint16_t now_ms = uint16_t(current_time_ms);
+
 	// Animation specific setup
 	switch (_config.keyframed._animation) {
 	case keyframed_animation::SHOOTING_STAR:
-		if (_state.keyframed.shooting_star.ticks_in_position ==
-		    _config.keyframed.shooting_star.ticks_before_advance) {
-			_state.keyframed.shooting_star.ticks_in_position = 0;
+	{
+		auto& star_state = _state.keyframed.shooting_star;
+		const auto advance_interval_ms = _config.keyframed.shooting_star.advance_interval_ms;
+
+		if (uint16_t(now_ms - star_state.last_advance_time_ms) >= 16 * advance_interval_ms) {
+			// Too far behind to catch up meaningfully, resume from the current time.
+			star_state.last_advance_time_ms = now_ms - advance_interval_ms;
+		}
+
+		/*
+		 * Advance the stars as many times as needed to keep up with the current time
+		 * when a tick was late.
+		 */
+		while (uint16_t(now_ms - star_state.last_advance_time_ms) >= advance_interval_ms) {
+			star_state.last_advance_time_ms += advance_interval_ms;
 			// Stored on 4 bits, wraps around at 15.
-			_state.keyframed.shooting_star.position++;
+			star_state.position++;
 
 			const auto led_interval = 16 / _config.keyframed.shooting_star.star_count;
 			for (uint8_t i = 0; i < _config.keyframed.shooting_star.star_count; i++) {
-				const auto position = (_state.keyframed.shooting_star.position +
-						       (led_interval * i)) %
-					16;
+				const auto position = (star_state.position + (led_interval * i)) % 16;
 
 				_set_keyframe_index(
 					_state.keyframed.origin_keyframe_index, position, 0);
 				_set_keyframe_index(
 					_state.keyframed.destination_keyframe_index, position, 0);
 
-				_state.keyframed.ticks_since_start_of_animation[position] = 0;
+				_state.keyframed.animation_start_time_ms[position] =
+					star_state.last_advance_time_ms;
 				_config.keyframed.active |= 1 << position;
 			}
 		}
 
-		_state.keyframed.shooting_star.ticks_in_position++;
+		break;
+	}
+	case keyframed_animation::SPARKS:
+		// Births are scheduled when sparks die out; only compare with the current time.
+		for (uint8_t i = 0; i < 16; i++) {
+			if (!((_config.keyframed.active >> i) & 1) &&
+			    int16_t(now_ms - _state.keyframed.animation_start_time_ms[i]) >= 0) {
+				_config.keyframed.active |= 1 << i;
+			}
+		}
+
 		break;
 	default:
 		break;
 	}
 
-	_pixels.setBrightness(_config.keyframed.brightness);
-
 	for (uint8_t i = 0; i < 16; i++) {
-		const auto origin_keyframe_index =
+		auto origin_keyframe_index =
 			_get_keyframe_index(_state.keyframed.origin_keyframe_index, i);
-		const auto destination_keyframe_index =
+		auto destination_keyframe_index =
 			_get_keyframe_index(_state.keyframed.destination_keyframe_index, i);
 
-		const auto origin_keyframe =
+		auto origin_keyframe =
 			keyframe_from_flash(&_config.keyframed.keyframes[origin_keyframe_index]);
 		const bool led_animation_is_active = (_config.keyframed.active >> i) & 1;
 
 		if (!led_animation_is_active) {
 			// Inactive, repeat the origin keyframe.
-			_pixels.setPixelColor(i,
-					      origin_keyframe.color.r(),
-					      origin_keyframe.color.g(),
-					      origin_keyframe.color.b());
+			_set_uncorrected_pixel_color(i, origin_keyframe.color);
 			continue;
 		}
 
-		const auto time_since_animation_start =
-			_state.keyframed.ticks_since_start_of_animation[i] * period_ms();
+		auto& animation_start_time_ms = _state.keyframed.animation_start_time_ms[i];
+		uint16_t time_since_animation_start = now_ms - animation_start_time_ms;
+		auto destination_keyframe =
+			keyframe_from_flash(&_config.keyframed.keyframes[destination_keyframe_index]);
+
+		/*
+		 * Advance keyframes if needed. More than one keyframe may have elapsed
+		 * if this tick was late; the animation's speed is preserved by skipping them.
+		 */
+		for (uint8_t advance_count = 0; time_since_animation_start >= destination_keyframe.time &&
+		     advance_count < _config.keyframed.keyframe_count;
+		     advance_count++) {
+			if (destination_keyframe_index + 1 >= _config.keyframed.keyframe_count) {
+				if (_config.keyframed._animation == keyframed_animation::SPARKS) {
+					// The spark died out.
+					_schedule_spark_birth(i, now_ms);
+					break;
+				}
+
+				/*
+				 * Loop back to the configured loop point. Move the start of the
+				 * animation forward by the looped-over duration so that LEDs
+				 * remain in phase.
+				 */
+				origin_keyframe_index = _config.keyframed.loop_point_index;
+				origin_keyframe = keyframe_from_flash(
+					&_config.keyframed.keyframes[origin_keyframe_index]);
+				animation_start_time_ms += destination_keyframe.time - origin_keyframe.time;
+				time_since_animation_start = now_ms - animation_start_time_ms;
+
+				destination_keyframe_index = min(origin_keyframe_index + 1,
+								 _config.keyframed.keyframe_count - 1);
+			} else {
+				origin_keyframe_index = destination_keyframe_index;
+				origin_keyframe = destination_keyframe;
+				destination_keyframe_index++;
+			}
 
-		if (_state.keyframed.ticks_since_start_of_animation[i] != 255) {
-			// Saturate counter.
-			_state.keyframed.ticks_since_start_of_animation[i]++;
+			destination_keyframe = keyframe_from_flash(
+				&_config.keyframed.keyframes[destination_keyframe_index]);
 		}
 
-		// Interpolate to find the current color.
-		const auto destination_keyframe = keyframe_from_flash(
-			&_config.keyframed.keyframes[destination_keyframe_index]);
-
-		// destination_keyframe.color.log(F("destination keyframe: "));
-
-		const auto new_color = interpolate(origin_keyframe,
-						   destination_keyframe,
-						   uint16_t(time_since_animation_start));
-		// new_color.log(F("interpolated color: "));
-
-		_pixels.setPixelColor(i,
-				      _pixels.gamma8(new_color.r()),
-				      _pixels.gamma8(new_color.g()),
-				      _pixels.gamma8(new_color.b()));
-
-		// Advance keyframes if needed.
-		if (time_since_animation_start < destination_keyframe.time) {
+		if (!((_config.keyframed.active >> i) & 1)) {
+			// Deactivated while advancing, show the first keyframe until reactivated.
+			_set_uncorrected_pixel_color(
+				i, keyframe_from_flash(&_config.keyframed.keyframes[0]).color);
 			continue;
 		}
 
-		uint8_t new_origin_keyframe_index = destination_keyframe_index;
-		uint8_t new_destination_keyframe_index = destination_keyframe_index + 1;
-		if (new_destination_keyframe_index >= _config.keyframed.keyframe_count) {
-			// Loop back to the configured loop point. Move the current animation time
-			// in the past.
-			new_origin_keyframe_index = _config.keyframed.loop_point_index;
-			new_destination_keyframe_index = min(new_origin_keyframe_index + 1,
-							     _config.keyframed.keyframe_count - 1);
-			// Round up to make sure the time isn't _before_ the origin keyframe.
-			_state.keyframed.ticks_since_start_of_animation[i] =
-				((keyframe_from_flash(
-					  &_config.keyframed.keyframes[new_origin_keyframe_index])
-					  .time +
-				  (period_ms() - 1)) /
-				 period_ms());
-		} else {
-			new_origin_keyframe_index = destination_keyframe_index;
-			new_destination_keyframe_index = destination_keyframe_index + 1;
-		}
-
+		_set_keyframe_index(_state.keyframed.origin_keyframe_index, i, origin_keyframe_index);
 		_set_keyframe_index(
-			_state.keyframed.origin_keyframe_index, i, new_origin_keyframe_index);
-		_set_keyframe_index(_state.keyframed.destination_keyframe_index,
-				    i,
-				    new_destination_keyframe_index);
+			_state.keyframed.destination_keyframe_index, i, destination_keyframe_index);
+
+		// Interpolate to find the current color.
+		const auto new_color =
+			interpolate(origin_keyframe, destination_keyframe, time_since_animation_start);
+
+		_pixels.setPixelColor(i,
+				      _corrected_color_component(new_color.r()),
+				      _corrected_color_component(new_color.g()),
+				      _corrected_color_component(new_color.b()));
 	}
 }
 
@@ -766,6 +932,7 @@ void nl::strip_animator::run(scheduling::absolute_time_ms current_time_ms) noexc
 	switch (_current_animation_type) {
 	case animation_type::KEYFRAMED:
 		_keyframe_animation_tick(current_time_ms);
+		_limit_power();
 		break;
 	default:
 		break;
@@ -773,6 +940,114 @@ void nl::strip_animator::run(scheduling::absolute_time_ms current_time_ms) noexc
 
 	// Send the updated pixel colors to the hardware.
 	_pixels.show();
+	nsec::diagnostics::latency::on_leds_shown(millis());
+
+	if (_power_save_scale == 0 && _power_limit_scale == 0) {
+		// The strip is dark: stop until the power manager raises the scale.
+		_is_suspended = true;
+		kill();
+	}
+}
+
+void nl::strip_animator::power_save_scale(uint8_t scale) noexcept
+{
+	_power_save_scale = scale;
+	if (!scale || !_is_suspended) {
+		return;
+	}
+
+	_is_suspended = false;
+	revive();
+	if (!scheduled()) {
+		ng::the_scheduler.schedule_task(*this);
+	}
+}
+
+void nl::strip_animator::_brightness(uint8_t new_brightness) noexcept
+{
+	_config.keyframed.brightness = new_brightness;
+
+#ifdef NSEC_LED_COLOR_CORRECTION_TABLE_IN_RAM
+	if (_color_correction_table_brightness == new_brightness) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < 256; i++) {
+		_color_correction_table[i] = scale_to_brightness(_pixels.gamma8(i), new_brightness);
+	}
+
+	_color_correction_table_brightness = new_brightness;
+#else
+	_color_correction_table = new_brightness == bright_brightness ?
+		bright_color_correction_table :
+		dim_color_correction_table;
+#endif
+}
+
+uint8_t nl::strip_animator::_corrected_color_component(uint8_t component) const noexcept
+{
+#ifdef NSEC_LED_COLOR_CORRECTION_TABLE_IN_RAM
+	return _color_correction_table[component];
+#else
+	return pgm_read_byte(&_color_correction_table[component]);
+#endif
+}
+
+void nl::strip_animator::_set_uncorrected_pixel_color(uint8_t led_id,
+						      const led_color& color) noexcept
+{
+	// Only brightness is applied, as was done by the strip before color correction tables.
+	const auto brightness = _config.keyframed.brightness;
+
+	_pixels.setPixelColor(led_id,
+			      scale_to_brightness(color.r(), brightness),
+			      scale_to_brightness(color.g(), brightness),
+			      scale_to_brightness(color.b(), brightness));
+}
+
+/*
+ * Estimate the current drawn by the frame about to be shown and dim it if it exceeds the
+ * budget. The dimming scale moves gradually towards its target so that changes of the
+ * frames' brightness are not visible as steps.
+ */
+void nl::strip_animator::_limit_power() noexcept
+{
+	uint8_t *const components = _pixels.getPixels();
+	uint16_t component_sum = 0;
+
+	for (uint8_t i = 0; i < NUMPIXELS * 3; i++) {
+		component_sum += components[i];
+	}
+
+	const uint16_t requested_current_ma =
+		(uint32_t(component_sum) * nc::led::channel_full_scale_current_ma) / 255 +
+		NUMPIXELS * nc::led::led_idle_current_ma;
+
+	uint8_t target_scale = _power_save_scale;
+	if (requested_current_ma > nc::led::current_budget_ma) {
+		target_scale = min(target_scale,
+				   uint8_t((uint32_t(nc::led::current_budget_ma) * 255) /
+					   requested_current_ma));
+	}
+
+	if (target_scale < _power_limit_scale) {
+		_power_limit_scale -=
+			min(uint8_t(_power_limit_scale - target_scale), nc::led::power_limit_dim_step);
+	} else {
+		_power_limit_scale += min(uint8_t(target_scale - _power_limit_scale),
+					  nc::led::power_limit_recovery_step);
+	}
+
+	uint16_t current_ma = requested_current_ma;
+	if (_power_limit_scale != 255) {
+		for (uint8_t i = 0; i < NUMPIXELS * 3; i++) {
+			components[i] = scale_to_brightness(components[i], _power_limit_scale);
+		}
+
+		current_ma = (uint32_t(requested_current_ma) * (_power_limit_scale + 1)) >> 8;
+	}
+
+	_average_current_ma_x16 += current_ma - (_average_current_ma_x16 >> 4);
 }
 
 nl::strip_animator::led_color nl::strip_animator::_color(uint8_t led_id) const noexcept
@@ -780,6 +1055,13 @@ nl::strip_animator::led_color nl::strip_animator::_color(uint8_t led_id) const n
 	return led_color(&_pixels.getPixels()[led_id * 3]);
 }
 
+uint8_t nl::strip_animator::idle_animation_count() noexcept
+{
+	return ARRAY_LENGTH(keyframes::shooting_star::params) +
+		ARRAY_LENGTH(keyframes::color_cycle::params) +
+		ARRAY_LENGTH(keyframes::sparks::params);
+}
+
 void nl::strip_animator::set_idle_animation(uint8_t id) noexcept
 {
 	/*
@@ -789,7 +1071,19 @@ void nl::strip_animator::set_idle_animation(uint8_t id) noexcept
 	const auto shooting_star_animations_count = ARRAY_LENGTH(keyframes::shooting_star::params);
 	const auto color_cycle_animations_count = ARRAY_LENGTH(keyframes::color_cycle::params);
 
-	id = id % (shooting_star_animations_count + color_cycle_animations_count);
+	id = id % idle_animation_count();
+
+	// Sparks come after the other animations so that existing ids keep their animation.
+	if (id >= shooting_star_animations_count + color_cycle_animations_count) {
+		const auto sparks_params = keyframes::sparks::sparks_parameters_from_flash(
+			&keyframes::sparks::params[id - shooting_star_animations_count -
+						   color_cycle_animations_count]);
+
+		_set_sparks_animation(sparks_params.keyframes,
+				      sparks_params.keyframe_count,
+				      sparks_params.max_birth_delay_ms);
+		return;
+	}
 
 	if (id / 2 < shooting_star_animations_count && id / 2 < color_cycle_animations_count) {
 		if (id % 2) {
@@ -864,13 +1158,20 @@ void nl::strip_animator::set_red_to_green_led_progress_bar(uint8_t active_led_co
 		_config.keyframed.keyframe_count = ARRAY_LENGTH(keyframes::red_to_green_progress_bar_keyframe_template);
 		_config.keyframed.keyframes = keyframes::red_to_green_progress_bar_keyframe_template;
 		_config.keyframed.loop_point_index = 2;
-		_config.keyframed.brightness = 120;
+		_brightness(bright_brightness);
 
 		// Clear its state.
 		_reset_keyframed_animation_state();
 	}
 
+	const uint16_t now_ms = uint16_t(millis());
 	for (uint8_t i = 0; i < active_led_count; i++) {
+		if ((_config.keyframed.active >> i) & 1) {
+			continue;
+		}
+
+		// The LED's animation starts when it becomes active.
+		_state.keyframed.animation_start_time_ms[i] = now_ms;
 		_config.keyframed.active |= (1 << i);
 	}
 }
@@ -931,9 +1232,10 @@ void nl::strip_animator::_set_shooting_star_animation(uint8_t star_count,
 	_config.keyframed.keyframes = keyframes;
 
 	_config.keyframed.loop_point_index = 0;
-	_config.keyframed.brightness = 50;
-	_config.keyframed.shooting_star.ticks_before_advance = advance_interval_ms / period_ms();
+	_brightness(dim_brightness);
+	_config.keyframed.shooting_star.advance_interval_ms = max(advance_interval_ms, 1U);
 	_config.keyframed.shooting_star.star_count = star_count;
+	_state.keyframed.shooting_star.last_advance_time_ms = uint16_t(millis());
 }
 
 void nl::strip_animator::_set_keyframed_cycle_animation(const keyframe *keyframe,
@@ -955,16 +1257,58 @@ void nl::strip_animator::_set_keyframed_cycle_animation(const keyframe *keyframe
 	_config.keyframed.keyframe_count = keyframe_count;
 	_config.keyframed.keyframes = keyframe;
 
-	// Apply an offset between LEDs to achieve a "sparkle" effect.
+	/*
+	 * Apply an offset between LEDs to achieve a "sparkle" effect. The offset is
+	 * expressed in refresh periods.
+	 */
+	const uint16_t now_ms = uint16_t(millis());
+	const uint16_t cycle_length_in_periods =
+		keyframe_from_flash(&_config.keyframed.keyframes[_config.keyframed.keyframe_count - 1])
+			.time /
+		period_ms();
 	for (uint8_t i = 0; i < 16; i++) {
-		_state.keyframed.ticks_since_start_of_animation[i] =
-			(i * cycle_offset_between_frames) %
-			(keyframe_from_flash(
-				 &_config.keyframed.keyframes[_config.keyframed.keyframe_count - 1])
-				 .time /
-			 period_ms());
+		const uint16_t offset_ms =
+			(uint16_t(i * cycle_offset_between_frames) % cycle_length_in_periods) *
+			period_ms();
+
+		_state.keyframed.animation_start_time_ms[i] = now_ms - offset_ms;
 	}
 
 	_config.keyframed.loop_point_index = loop_point_index;
-	_config.keyframed.brightness = 50;
+	_brightness(dim_brightness);
+}
+
+void nl::strip_animator::_set_sparks_animation(const keyframe *keyframes,
+					       uint8_t keyframe_count,
+					       uint16_t max_birth_delay_ms) noexcept
+{
+	period_ms(20);
+	_current_animation_type = animation_type::KEYFRAMED;
+	_config.keyframed._animation = keyframed_animation::SPARKS;
+	_config.keyframed.active = 0;
+	_reset_keyframed_animation_state();
+	_config.keyframed.keyframe_count = keyframe_count;
+	_config.keyframed.keyframes = keyframes;
+	_config.keyframed.loop_point_index = 0;
+	_brightness(dim_brightness);
+	_config.keyframed.sparks.max_birth_delay_ms = max(max_birth_delay_ms, uint16_t(1));
+
+	const uint16_t now_ms = uint16_t(millis());
+	for (uint8_t i = 0; i < 16; i++) {
+		_schedule_spark_birth(i, now_ms);
+	}
+}
+
+void nl::strip_animator::_schedule_spark_birth(uint8_t led_id, uint16_t now_ms) noexcept
+{
+	_config.keyframed.active &= ~(1 << led_id);
+	_set_keyframe_index(_state.keyframed.origin_keyframe_index, led_id, 0);
+	_set_keyframe_index(_state.keyframed.destination_keyframe_index, led_id, 0);
+
+	/*
+	 * The start time of an inactive LED's animation is in the future: it is activated once
+	 * the current time reaches it.
+	 */
+	_state.keyframed.animation_start_time_ms[led_id] =
+		now_ms + next_random(_random_state) % _config.keyframed.sparks.max_birth_delay_ms;
 }
@@ -0,0 +1,130 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "config.hpp"
+#include "diagnostics/trace.hpp"
+#include "unique_id.hpp"
+
+#include <Arduino.h>
+
+#ifdef NSEC_TRACE
+
+namespace ndt = nsec::diagnostics::trace;
+
+namespace {
+constexpr uint8_t buffer_record_count = nsec::config::diagnostics::trace_buffer_record_count;
+constexpr uint8_t dump_format_version = 1;
+
+struct trace_record {
+	uint16_t timestamp_delta_us;
+	uint8_t id;
+	uint8_t arg0;
+	uint16_t arg1;
+} __attribute__((packed));
+
+static_assert(sizeof(trace_record) == 6, "Trace records are 6 bytes long");
+
+// "<NAME> <arg0 name> <arg1 name>" for each tracepoint, in id order.
+#define NSEC_TRACE_TRACEPOINT_DESCRIPTION(name, arg0_name, arg1_name) \
+	const char name##_description[] PROGMEM = #name " " #arg0_name " " #arg1_name;
+NSEC_TRACE_TRACEPOINTS(NSEC_TRACE_TRACEPOINT_DESCRIPTION)
+#undef NSEC_TRACE_TRACEPOINT_DESCRIPTION
+
+#define NSEC_TRACE_TRACEPOINT_DESCRIPTION_ENTRY(name, arg0_name, arg1_name) name##_description,
+const char *const tracepoint_descriptions[] PROGMEM = { NSEC_TRACE_TRACEPOINTS(
+	NSEC_TRACE_TRACEPOINT_DESCRIPTION_ENTRY) };
+#undef NSEC_TRACE_TRACEPOINT_DESCRIPTION_ENTRY
+
+trace_record records[buffer_record_count];
+// Index of the next record to write and number of valid records (the oldest are overwritten).
+uint8_t next_record_index;
+uint8_t record_count;
+// Time of the last record.
+unsigned long last_record_time_us;
+
+void append(uint16_t timestamp_delta_us, ndt::tracepoint id, uint8_t arg0, uint16_t arg1) noexcept
+{
+	auto& new_record = records[next_record_index];
+
+	new_record.timestamp_delta_us = timestamp_delta_us;
+	new_record.id = uint8_t(id);
+	new_record.arg0 = arg0;
+	new_record.arg1 = arg1;
+
+	next_record_index = next_record_index + 1 == buffer_record_count ? 0 :
+									  next_record_index + 1;
+	if (record_count < buffer_record_count) {
+		record_count++;
+	}
+}
+
+void print_hex(Print& print, const uint8_t *bytes, uint8_t size)
+{
+	for (uint8_t i = 0; i < size; i++) {
+		if (bytes[i] < 0x10) {
+			print.print('0');
+		}
+
+		print.print(bytes[i], HEX);
+	}
+}
+} // anonymous namespace
+
+void ndt::buffer(tracepoint id, uint8_t arg0, uint16_t arg1) noexcept
+{
+	const auto now_us = micros();
+	const auto delta_us = now_us - last_record_time_us;
+
+	last_record_time_us = now_us;
+	if (delta_us > UINT16_MAX) {
+		append(uint16_t(delta_us), tracepoint::CLOCK_ADVANCE, 0, uint16_t(delta_us >> 16));
+		append(0, id, arg0, arg1);
+	} else {
+		append(uint16_t(delta_us), id, arg0, arg1);
+	}
+}
+
+void ndt::dump(Print& print)
+{
+	print.print(F("nsec-trace "));
+	print.println(dump_format_version);
+
+	print.print(F("badge "));
+	print_hex(print, UniqueID, UniqueIDsize);
+	print.println();
+
+	for (uint8_t i = 0; i < sizeof(tracepoint_descriptions) / sizeof(*tracepoint_descriptions);
+	     i++) {
+		print.print(F("tracepoint "));
+		print.print(i);
+		print.print(' ');
+		print.println(reinterpret_cast<const __FlashStringHelper *>(
+			pgm_read_ptr(&tracepoint_descriptions[i])));
+	}
+
+	// Records only hold deltas: the time of the last one anchors them all.
+	print.print(F("end_time_us "));
+	print.println(last_record_time_us);
+	print.print(F("records "));
+	print.println(record_count);
+
+	uint8_t index = next_record_index >= record_count ?
+		next_record_index - record_count :
+		buffer_record_count + next_record_index - record_count;
+
+	for (uint8_t i = 0; i < record_count; i++) {
+		print_hex(print,
+			  reinterpret_cast<const uint8_t *>(&records[index]),
+			  sizeof(records[index]));
+		print.println();
+		index = index + 1 == buffer_record_count ? 0 : index + 1;
+	}
+
+	print.println(F("end"));
+	record_count = 0;
+}
+
+#endif // NSEC_TRACE
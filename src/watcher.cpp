@@ -7,6 +7,7 @@
 #include "board.hpp"
 #include "button/watcher.hpp"
 #include "config.hpp"
+#include "diagnostics/latency.hpp"
 #include "globals.hpp"
 
 #include <Arduino.h>
@@ -15,9 +16,61 @@ namespace nb = nsec::button;
 namespace ns = nsec::scheduling;
 namespace ng = nsec::g;
 
+namespace {
+#if defined(__AVR_ATmega328PB__)
+/*
+ * UP, RIGHT, DOWN and LEFT are on port C (PCINT8-11), OK and CANCEL on port E
+ * (PCINT26-27). Only the pin change flags are used to latch the first edge while
+ * the watcher is asleep: the pin change interrupt vectors are all defined by
+ * SoftwareSerial, so the interrupts themselves are left disabled.
+ */
+constexpr bool buttons_can_wake_up_watcher = true;
+constexpr uint8_t button_pin_change_flags = _BV(PCIF1) | _BV(PCIF3);
+
+void enable_button_pin_change_detection() noexcept
+{
+	PCMSK1 |= _BV(PCINT8) | _BV(PCINT9) | _BV(PCINT10) | _BV(PCINT11);
+	PCMSK3 |= _BV(PCINT26) | _BV(PCINT27);
+}
+#else
+/*
+ * OK and CANCEL are on analog-only pins (A6, A7) which can't detect pin changes:
+ * the buttons have to be polled continuously.
+ */
+constexpr bool buttons_can_wake_up_watcher = false;
+constexpr uint8_t button_pin_change_flags = 0;
+
+void enable_button_pin_change_detection() noexcept
+{
+}
+#endif
+
+constexpr uint8_t idle_ticks_before_sleep =
+	nsec::config::button::idle_time_before_sleep_ms / nsec::config::button::polling_period_ms;
+
+void clear_button_pin_change_flags() noexcept
+{
+	// Flags are cleared by writing a one to them.
+	PCIFR = button_pin_change_flags;
+}
+
+bool button_pin_changed() noexcept
+{
+	return PCIFR & button_pin_change_flags;
+}
+} // anonymous namespace
+
 nb::watcher::watcher(nb::new_button_event_notifier new_button_notifier) noexcept :
 	ns::periodic_task(nsec::config::button::polling_period_ms),
-	_notify_new_event{ new_button_notifier }
+	_notify_new_event{ new_button_notifier },
+	_pending_events{},
+	_debounced_state{ 0 },
+	_change_counter_low{ 0 },
+	_change_counter_high{ 0 },
+	_ticks_before_repeat{},
+	_dropped_buttons{ 0 },
+	_idle_ticks{ 0 },
+	_is_asleep{ false }
 {
 	ng::the_scheduler.schedule_task(*this);
 }
@@ -31,102 +84,170 @@ void nb::watcher::setup() noexcept
 	pinMode(BTN_LEFT, INPUT_PULLUP);
 	pinMode(BTN_OK, INPUT_PULLUP);
 	pinMode(BTN_CANCEL, INPUT_PULLUP);
+
+	enable_button_pin_change_detection();
 }
 
-void nb::watcher::run([[maybe_unused]] ns::absolute_time_ms current_time_ms) noexcept
+void nb::watcher::wake_up_on_button_activity() noexcept
 {
-	const unsigned int btn_pins[] = {
-		BTN_UP, BTN_RIGHT, BTN_DOWN, BTN_LEFT, BTN_OK, BTN_CANCEL
-	};
-	constexpr auto btn_count = sizeof(btn_pins) / sizeof(*btn_pins);
-
-	// Check the state of all button pins and debounce as needed
-	for (auto btn_idx = 0U; btn_idx < btn_count; btn_idx++) {
-		auto& debouncer = _button_debouncers[btn_idx];
-		const auto pin = btn_pins[btn_idx];
-
-		const auto new_event = debouncer.update(digitalRead(pin) == LOW);
-		if (new_event == debouncer::event::NONE) {
-			continue;
-		}
+	if (!_is_asleep || !button_pin_changed()) {
+		return;
+	}
 
-		_notify_new_event(static_cast<id>(btn_idx), static_cast<event>(new_event));
+	wake_up();
+}
+
+void nb::watcher::wake_up() noexcept
+{
+	if (!_is_asleep) {
+		return;
 	}
+
+	_is_asleep = false;
+	_idle_ticks = 0;
+	revive();
+
+	// Sample right away rather than a full polling period later.
+	ng::the_scheduler.schedule_task(*this);
 }
 
-nb::watcher::debouncer::debouncer()
+void nb::watcher::_sleep() noexcept
 {
-	transition_to_state(state::NONE);
+	_is_asleep = true;
+	kill();
 }
 
-void nb::watcher::debouncer::transition_to_state(nb::watcher::debouncer::state new_state)
+void nb::watcher::_queue_event(nb::id button,
+			       nb::event event,
+			       ns::absolute_time_ms timestamp) noexcept
 {
-	_state = new_state;
-	_ticks_in_state = 0;
+	if (event == nb::event::DOWN) {
+		nsec::diagnostics::latency::on_button_pressed(timestamp);
+	}
+
+	/*
+	 * The UI drains the queue every frame: it can only fill up if event handling
+	 * stalls for a long time, in which case the newest events are dropped.
+	 */
+	_pending_events.push({ .button = uint8_t(button),
+			       .type = uint8_t(event),
+			       .timestamp_ms = uint16_t(timestamp) });
 }
 
-nb::watcher::debouncer::event nb::watcher::debouncer::update(bool button_state) noexcept
+void nb::watcher::dispatch_events(ns::absolute_time_ms current_time_ms,
+				  uint8_t max_event_count) noexcept
 {
-	const auto state_on_entry = _state;
+	queued_event queued;
 
-	_ticks_in_state++;
+	while (max_event_count-- && _pending_events.pop(queued)) {
+		// Events are at most a few frames old: the truncated timestamp is unambiguous.
+		const uint16_t age_ms = uint16_t(current_time_ms) - queued.timestamp_ms;
 
-	switch (state_on_entry) {
-	case state::NONE:
-		if (button_state) {
-			transition_to_state(state::DOWN_CANDIDATE);
-		}
+		_notify_new_event(static_cast<id>(queued.button),
+				  static_cast<event>(queued.type),
+				  current_time_ms - age_ms);
+	}
+}
 
-		break;
-	case state::UP_CANDIDATE:
-	case state::DOWN_CANDIDATE:
-		// Up and down candidate states have values 0 and 1 respectively.
-		if (button_state != static_cast<bool>(state_on_entry)) {
-			// bouncing detected, reset.
-			transition_to_state(state::NONE);
-		} else {
-			if (_ticks_in_state == nsec::config::button::debounce_ticks - 1) {
-				// transition confirmed, trigger and move to next state.
-				transition_to_state(state_on_entry == state::UP_CANDIDATE ?
-							    state::NONE :
-							    state::DOWN_WAIT_FIRST_REPEAT);
-				return state_on_entry == state::UP_CANDIDATE ?
-					nb::watcher::debouncer::event::UP :
-					nb::watcher::debouncer::event::DOWN;
-			}
-		}
+void nb::watcher::drop_pending_events() noexcept
+{
+	_pending_events.clear();
+	// Including the buttons not debounced yet, such as the one which woke the MCU up.
+	_dropped_buttons = _debounced_state | _sample_buttons();
+}
+
+/*
+ * Read all the buttons at once from their ports:
+ *   - UP: PC1, RIGHT: PC0, DOWN: PC2, LEFT: PC3;
+ *   - OK: PE3 (A7), CANCEL: PE2 (A6) on the ATmega328PB.
+ * The buttons are active low.
+ */
+uint8_t nb::watcher::_sample_buttons() noexcept
+{
+	static_assert(uint8_t(id::UP) == 0 && uint8_t(id::RIGHT) == 1 && uint8_t(id::DOWN) == 2 &&
+		      uint8_t(id::LEFT) == 3 && uint8_t(id::OK) == 4 && uint8_t(id::CANCEL) == 5);
+
+	const uint8_t port_c = ~PINC;
+	uint8_t pressed = (port_c & 0b1100) | ((port_c >> 1) & 0b1) | ((port_c & 0b1) << 1);
+
+#if defined(__AVR_ATmega328PB__)
+	const uint8_t port_e = ~PINE;
 
-		break;
-	case state::DOWN_WAIT_FIRST_REPEAT:
-	case state::DOWN_REPEAT:
-	{
-		constexpr auto ticks_before_first_repeat =
+	pressed |= ((port_e & _BV(PINE3)) << 1) | ((port_e & _BV(PINE2)) << 3);
+#else
+	constexpr auto threshold = nsec::config::button::analog_button_pressed_threshold;
+
+	pressed |= (analogRead(BTN_OK) < threshold) << 4;
+	pressed |= (analogRead(BTN_CANCEL) < threshold) << 5;
+#endif
+
+	return pressed;
+}
+
+void nb::watcher::run(ns::absolute_time_ms current_time_ms) noexcept
+{
+	/*
+	 * Clear the pin change flags before sampling: any edge happening after the
+	 * samples are taken will be latched and wake the watcher if it goes to sleep.
+	 */
+	clear_button_pin_change_flags();
+
+	const uint8_t changed = _sample_buttons() ^ _debounced_state;
+
+	// Count the consecutive polls during which each button differed from its state.
+	_change_counter_high = (_change_counter_high ^ _change_counter_low) & changed;
+	_change_counter_low = ~_change_counter_low & changed;
+
+	// Buttons whose counter reached debounce_ticks.
+	constexpr auto debounce_ticks = nsec::config::button::debounce_ticks;
+	const uint8_t toggled =
+		(debounce_ticks & 0b10 ? _change_counter_high : ~_change_counter_high) &
+		(debounce_ticks & 0b01 ? _change_counter_low : ~_change_counter_low);
+
+	_debounced_state ^= toggled;
+	_change_counter_low &= ~toggled;
+	_change_counter_high &= ~toggled;
+
+	if (toggled | _debounced_state) {
+		constexpr uint8_t ticks_before_first_repeat =
 			nsec::config::button::button_down_first_repeat_delay_ms /
 			nsec::config::button::polling_period_ms;
-		constexpr auto ticks_before_repeat =
+		constexpr uint8_t ticks_before_repeat =
 			nsec::config::button::button_down_repeat_delay_ms /
 			nsec::config::button::polling_period_ms;
 
-		const auto ticks_to_wait = state_on_entry == state::DOWN_WAIT_FIRST_REPEAT ?
-			ticks_before_first_repeat :
-			ticks_before_repeat;
+		for (uint8_t button_idx = 0; button_idx < button_count; button_idx++) {
+			const uint8_t button_mask = 1 << button_idx;
+			const bool is_pressed = _debounced_state & button_mask;
+			auto& ticks_before_repeat_event = _ticks_before_repeat[button_idx];
 
-		if (!button_state) {
-			transition_to_state(state::UP_CANDIDATE);
-			break;
-		}
+			if (_dropped_buttons & button_mask) {
+				continue;
+			}
 
-		if (_ticks_in_state == ticks_to_wait) {
-			transition_to_state(state::DOWN_REPEAT);
-			return nb::watcher::debouncer::event::DOWN_REPEAT;
+			if (toggled & button_mask) {
+				ticks_before_repeat_event = ticks_before_first_repeat;
+				_queue_event(static_cast<id>(button_idx),
+					     is_pressed ? event::DOWN : event::UP,
+					     current_time_ms);
+			} else if (is_pressed && --ticks_before_repeat_event == 0) {
+				ticks_before_repeat_event = ticks_before_repeat;
+				_queue_event(static_cast<id>(button_idx),
+					     event::DOWN_REPEAT,
+					     current_time_ms);
+			}
 		}
-
-		break;
 	}
-	default:
-		// Unreachable or the cosmic rays are hitting pretty hard...
-		break;
+
+	// Stop dropping the events of the buttons released (or which only bounced).
+	_dropped_buttons &= _debounced_state | _change_counter_low | _change_counter_high;
+
+	if (_debounced_state | _change_counter_low | _change_counter_high) {
+		_idle_ticks = 0;
+		return;
 	}
 
-	return nb::watcher::debouncer::event::NONE;
-}
\ No newline at end of file
+	if (buttons_can_wake_up_watcher && ++_idle_ticks >= idle_ticks_before_sleep) {
+		_sleep();
+	}
+}
@@ -0,0 +1,205 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+/*
+ * The complete firmware, built against the host shims. The badge is a global: the tests
+ * run in order, as a single power-up of the badge.
+ */
+
+#include "badge.hpp"
+#include "board.hpp"
+#include "globals.hpp"
+#include "host_clock.hpp"
+#include "host_oled.hpp"
+#include "host_pins.hpp"
+
+#include <Adafruit_NeoPixel.h>
+#include <EEPROM.h>
+#include <avr/sleep.h>
+
+#include <algorithm>
+#include <unity.h>
+#include <vector>
+
+namespace ns = nsec::scheduling;
+
+namespace {
+unsigned long led_show_count;
+bool has_powered_down;
+
+void on_led_show(const Adafruit_NeoPixel&)
+{
+	led_show_count++;
+}
+
+// The main loop of src/main.cpp, skipping the time during which the badge is idle.
+void run_until(unsigned long end_time_ms)
+{
+	while (millis() < end_time_ms) {
+		const auto tick_time_ms = millis();
+
+		nsec::g::the_badge.check_wake_up_sources();
+
+		const auto time_to_next_tick =
+			std::max<ns::relative_time_ms>(nsec::g::the_scheduler.tick(tick_time_ms), 1);
+		const auto next_tick_time_ms =
+			std::min<unsigned long>(tick_time_ms + time_to_next_tick, end_time_ms);
+
+		if (next_tick_time_ms * 1000ULL > nsec::host::time_us()) {
+			nsec::host::set_time_ms(next_tick_time_ms);
+		}
+	}
+}
+
+void press(uint8_t pin)
+{
+	nsec::host::drive_pin(pin, false);
+	run_until(millis() + 100);
+	nsec::host::release_pin(pin);
+	run_until(millis() + 100);
+}
+
+std::vector<bool> panel_content()
+{
+	std::vector<bool> content;
+
+	for (uint8_t y = 0; y < SCREEN_HEIGHT; y++) {
+		for (uint8_t x = 0; x < SCREEN_WIDTH; x++) {
+			content.push_back(nsec::host::oled::pixel(x, y));
+		}
+	}
+
+	return content;
+}
+} // namespace
+
+void test_boot_shows_splash_screen()
+{
+	nsec::host::oled::attach(SCREEN_ADDRESS);
+	Adafruit_NeoPixel::set_show_observer(on_led_show);
+	nsec::g::the_badge.setup();
+	run_until(millis() + 500);
+
+	TEST_ASSERT_TRUE_MESSAGE(nsec::host::oled::is_on(), "Panel turned on by the renderer");
+	TEST_ASSERT_TRUE_MESSAGE(nsec::host::oled::frame_count() > 0, "Splash screen flushed");
+
+	const auto content = panel_content();
+
+	TEST_ASSERT_TRUE_MESSAGE(std::find(content.begin(), content.end(), true) != content.end(),
+				 "Splash screen drawn");
+	TEST_ASSERT_TRUE_MESSAGE(led_show_count > 0, "LED strip animated");
+}
+
+void test_first_boot_formats_id_storage()
+{
+	// The EEPROM starts erased: the badge ID ring buffer isn't marked as clean.
+	TEST_ASSERT_TRUE_MESSAGE(EEPROM.write_count() > 0, "Badge ID storage formatted");
+}
+
+void test_cancel_opens_main_menu()
+{
+	// Leave the splash screen for the name screen.
+	run_until(millis() + nsec::config::splash::splash_screen_wait_time_ms + 500);
+
+	const auto name_screen = panel_content();
+	const auto frame_count = nsec::host::oled::frame_count();
+
+	press(BTN_CANCEL);
+	TEST_ASSERT_TRUE_MESSAGE(nsec::host::oled::frame_count() > frame_count,
+				 "Frame flushed after the button press");
+	TEST_ASSERT_FALSE_MESSAGE(panel_content() == name_screen, "Main menu shown");
+
+	const auto main_menu = panel_content();
+
+	press(BTN_DOWN);
+	TEST_ASSERT_FALSE_MESSAGE(panel_content() == main_menu, "Menu selection moved");
+
+	press(BTN_CANCEL);
+	TEST_ASSERT_TRUE_MESSAGE(panel_content() != main_menu, "Menu closed");
+}
+
+void test_inactivity_dims_then_turns_display_off()
+{
+	const auto contrast = nsec::host::oled::contrast();
+
+	run_until(millis() + nsec::config::power::dim_delay_ms +
+		  nsec::config::power::manager_period_ms);
+	TEST_ASSERT_TRUE_MESSAGE(nsec::host::oled::contrast() < contrast, "Panel dimmed");
+	TEST_ASSERT_TRUE_MESSAGE(nsec::host::oled::is_on(), "Panel still on while dimmed");
+
+	run_until(millis() + nsec::config::power::display_off_delay_ms);
+	TEST_ASSERT_FALSE_MESSAGE(nsec::host::oled::is_on(), "Panel turned off");
+
+	const auto led_show_count_while_off = led_show_count;
+
+	run_until(millis() + 1000);
+	TEST_ASSERT_EQUAL_MESSAGE(
+		led_show_count_while_off, led_show_count, "LED strip stopped while off");
+
+	press(BTN_DOWN);
+	TEST_ASSERT_TRUE_MESSAGE(nsec::host::oled::is_on(), "Panel woken up by a button");
+	TEST_ASSERT_EQUAL_MESSAGE(contrast, nsec::host::oled::contrast(), "Contrast restored");
+	TEST_ASSERT_TRUE_MESSAGE(led_show_count > led_show_count_while_off,
+				 "LED strip animated again");
+}
+
+void test_wake_up_press_is_dropped()
+{
+	// From the name screen to the main menu, whose first choice is selected.
+	press(BTN_CANCEL);
+
+	const auto main_menu = panel_content();
+
+	run_until(millis() + nsec::config::power::display_off_delay_ms +
+		  nsec::config::power::manager_period_ms);
+	TEST_ASSERT_FALSE_MESSAGE(nsec::host::oled::is_on(), "Panel turned off");
+
+	press(BTN_OK);
+	TEST_ASSERT_TRUE_MESSAGE(nsec::host::oled::is_on(), "Panel woken up by a button");
+	TEST_ASSERT_TRUE_MESSAGE(panel_content() == main_menu, "Wake-up press dropped");
+
+	press(BTN_DOWN);
+	TEST_ASSERT_FALSE_MESSAGE(panel_content() == main_menu, "Buttons work once awake");
+}
+
+void test_deep_sleep_wake_up_press_is_dropped()
+{
+	const auto menu = panel_content();
+	const auto deadline_ms = millis() + nsec::config::power::deep_sleep_delay_ms +
+		nsec::config::power::manager_period_ms;
+
+	// Wake the badge up with OK, held across the power-down.
+	nsec::host::set_power_down_observer([] {
+		has_powered_down = true;
+		nsec::host::drive_pin(BTN_OK, false);
+	});
+	while (!has_powered_down && millis() < deadline_ms) {
+		run_until(millis() + 100);
+	}
+
+	nsec::host::set_power_down_observer(nullptr);
+	TEST_ASSERT_TRUE_MESSAGE(has_powered_down, "Badge powered down");
+
+	run_until(millis() + 100);
+	nsec::host::release_pin(BTN_OK);
+	run_until(millis() + 100);
+	TEST_ASSERT_TRUE_MESSAGE(nsec::host::oled::is_on(), "Panel woken up by a button");
+	TEST_ASSERT_TRUE_MESSAGE(panel_content() == menu, "Wake-up press dropped");
+}
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv)
+{
+	UNITY_BEGIN();
+
+	RUN_TEST(test_boot_shows_splash_screen);
+	RUN_TEST(test_first_boot_formats_id_storage);
+	RUN_TEST(test_cancel_opens_main_menu);
+	RUN_TEST(test_inactivity_dims_then_turns_display_off);
+	RUN_TEST(test_wake_up_press_is_dropped);
+	RUN_TEST(test_deep_sleep_wake_up_press_is_dropped);
+
+	return UNITY_END();
+}
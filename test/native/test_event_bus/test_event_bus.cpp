@@ -0,0 +1,149 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "event_bus.hpp"
+
+#include <unity.h>
+#include <vector>
+
+namespace {
+
+struct test_event {
+	uint8_t priority() const noexcept
+	{
+		return event_priority;
+	}
+
+	uint8_t event_priority;
+	uint8_t value;
+};
+
+using test_bus = nsec::event_bus<test_event, 4, 2>;
+
+class recording_handler {
+public:
+	void operator()(const test_event& event)
+	{
+		values.push_back(event.value);
+	}
+
+	std::vector<uint8_t> values;
+};
+
+void test_new_bus_is_empty()
+{
+	test_bus bus;
+	recording_handler handler;
+
+	TEST_ASSERT_TRUE_MESSAGE(bus.empty(), "New bus is empty");
+	TEST_ASSERT_EQUAL_MESSAGE(
+		0, bus.dispatch(handler, 10), "No event dispatched from an empty bus");
+}
+
+void test_events_dispatched_by_priority_then_order()
+{
+	test_bus bus;
+	recording_handler handler;
+
+	bus.post({ 1, 10 });
+	bus.post({ 0, 1 });
+	bus.post({ 1, 11 });
+	bus.post({ 0, 2 });
+
+	TEST_ASSERT_EQUAL(4, bus.dispatch(handler, 10));
+	TEST_ASSERT_TRUE_MESSAGE(handler.values == std::vector<uint8_t>({ 1, 2, 10, 11 }),
+				 "Events dispatched by priority, then in posting order");
+	TEST_ASSERT_TRUE(bus.empty());
+}
+
+void test_dispatch_budget()
+{
+	test_bus bus;
+	recording_handler handler;
+
+	bus.post({ 0, 1 });
+	bus.post({ 0, 2 });
+	bus.post({ 1, 3 });
+
+	TEST_ASSERT_EQUAL_MESSAGE(
+		2, bus.dispatch(handler, 2), "Dispatch stops once the budget is spent");
+	TEST_ASSERT_FALSE(bus.empty());
+	TEST_ASSERT_EQUAL(1, bus.dispatch(handler, 2));
+	TEST_ASSERT_TRUE(handler.values == std::vector<uint8_t>({ 1, 2, 3 }));
+}
+
+void test_full_priority_queue()
+{
+	test_bus bus;
+
+	for (uint8_t i = 0; i < 4; i++) {
+		TEST_ASSERT_TRUE(bus.post({ 1, i }));
+	}
+
+	TEST_ASSERT_FALSE_MESSAGE(bus.post({ 1, 4 }), "Can't post to a full priority queue");
+	TEST_ASSERT_TRUE_MESSAGE(bus.post({ 0, 5 }),
+				 "Can post to another priority when one is full");
+}
+
+void test_available_per_priority()
+{
+	test_bus bus;
+
+	TEST_ASSERT_EQUAL_MESSAGE(4, bus.available(1), "New bus has room for its capacity");
+	bus.post({ 1, 10 });
+	bus.post({ 0, 1 });
+	bus.post({ 1, 11 });
+
+	TEST_ASSERT_EQUAL_MESSAGE(2, bus.available(1), "Posted events take room in their queue");
+	TEST_ASSERT_EQUAL_MESSAGE(3, bus.available(0), "Other priorities have their own room");
+}
+
+class reposting_handler {
+public:
+	explicit reposting_handler(test_bus& bus) : _bus{ bus }
+	{
+	}
+
+	void operator()(const test_event& event)
+	{
+		values.push_back(event.value);
+		if (event.value == 1) {
+			_bus.post({ 0, 2 });
+		}
+	}
+
+	std::vector<uint8_t> values;
+
+private:
+	test_bus& _bus;
+};
+
+void test_handler_can_post()
+{
+	test_bus bus;
+	reposting_handler handler(bus);
+
+	bus.post({ 1, 1 });
+	TEST_ASSERT_EQUAL(2, bus.dispatch(handler, 10));
+	TEST_ASSERT_TRUE_MESSAGE(handler.values == std::vector<uint8_t>({ 1, 2 }),
+				 "Events posted by a handler are dispatched in the same pass");
+}
+
+} // anonymous namespace
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv)
+{
+	UNITY_BEGIN();
+
+	RUN_TEST(test_new_bus_is_empty);
+	RUN_TEST(test_events_dispatched_by_priority_then_order);
+	RUN_TEST(test_dispatch_budget);
+	RUN_TEST(test_full_priority_queue);
+	RUN_TEST(test_available_per_priority);
+	RUN_TEST(test_handler_can_post);
+
+	return UNITY_END();
+}
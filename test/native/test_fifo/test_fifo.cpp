@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "fifo.hpp"
+
+#include <unity.h>
+
+namespace {
+
+void test_new_fifo_is_empty()
+{
+	nsec::fifo<uint8_t, 4> queue;
+	uint8_t element;
+
+	TEST_ASSERT_TRUE_MESSAGE(queue.empty(), "New fifo is empty");
+	TEST_ASSERT_EQUAL_MESSAGE(0, queue.size(), "New fifo has no elements");
+	TEST_ASSERT_FALSE_MESSAGE(queue.pop(element), "Can't pop from an empty fifo");
+}
+
+void test_elements_popped_in_order()
+{
+	nsec::fifo<uint8_t, 4> queue;
+	uint8_t element;
+
+	queue.push(1);
+	queue.push(2);
+	queue.push(3);
+	TEST_ASSERT_EQUAL_MESSAGE(3, queue.size(), "Fifo has three elements after three pushes");
+
+	for (uint8_t expected = 1; expected <= 3; expected++) {
+		TEST_ASSERT_TRUE(queue.pop(element));
+		TEST_ASSERT_EQUAL_MESSAGE(expected, element, "Elements are popped in push order");
+	}
+
+	TEST_ASSERT_TRUE_MESSAGE(queue.empty(), "Fifo is empty once all elements are popped");
+}
+
+void test_push_to_full_fifo_fails()
+{
+	nsec::fifo<uint8_t, 4> queue;
+	uint8_t element;
+
+	for (uint8_t i = 0; i < 4; i++) {
+		TEST_ASSERT_TRUE(queue.push(i));
+	}
+
+	TEST_ASSERT_TRUE_MESSAGE(queue.full(), "Fifo is full after pushing its capacity");
+	TEST_ASSERT_FALSE_MESSAGE(queue.push(4), "Can't push to a full fifo");
+
+	TEST_ASSERT_TRUE(queue.pop(element));
+	TEST_ASSERT_EQUAL_MESSAGE(0, element, "Failed push didn't overwrite the oldest element");
+	TEST_ASSERT_TRUE_MESSAGE(queue.push(4), "Can push once an element is popped");
+}
+
+void test_positions_wrap_around()
+{
+	nsec::fifo<uint16_t, 8> queue;
+	uint16_t element;
+
+	// Go around the 8-bit positions a few times with a partially filled queue.
+	for (uint16_t i = 0; i < 1000; i++) {
+		TEST_ASSERT_TRUE(queue.push(i));
+		if (i >= 5) {
+			TEST_ASSERT_TRUE(queue.pop(element));
+			TEST_ASSERT_EQUAL_MESSAGE(i - 5, element, "Elements are popped in order");
+		}
+
+		TEST_ASSERT_EQUAL(i >= 5 ? 5 : i + 1, queue.size());
+	}
+}
+
+void test_front_doesnt_pop()
+{
+	nsec::fifo<uint8_t, 4> queue;
+	uint8_t element;
+
+	queue.push(1);
+	queue.push(2);
+	TEST_ASSERT_EQUAL_MESSAGE(1, queue.front(), "Front is the oldest element");
+	TEST_ASSERT_EQUAL_MESSAGE(2, queue.size(), "Front leaves the element in the fifo");
+
+	TEST_ASSERT_TRUE(queue.pop(element));
+	TEST_ASSERT_EQUAL_MESSAGE(2, queue.front(), "Front follows pops");
+}
+
+void test_clear()
+{
+	nsec::fifo<uint8_t, 4> queue;
+
+	queue.push(1);
+	queue.push(2);
+	queue.clear();
+	TEST_ASSERT_TRUE_MESSAGE(queue.empty(), "Fifo is empty after clear");
+	TEST_ASSERT_TRUE_MESSAGE(queue.push(3), "Can push after clear");
+	TEST_ASSERT_EQUAL(1, queue.size());
+}
+
+} // anonymous namespace
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv)
+{
+	UNITY_BEGIN();
+
+	RUN_TEST(test_new_fifo_is_empty);
+	RUN_TEST(test_elements_popped_in_order);
+	RUN_TEST(test_push_to_full_fifo_fails);
+	RUN_TEST(test_positions_wrap_around);
+	RUN_TEST(test_front_doesnt_pop);
+	RUN_TEST(test_clear);
+
+	return UNITY_END();
+}
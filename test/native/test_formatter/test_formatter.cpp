@@ -0,0 +1,107 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "formatter.hpp"
+
+#include <unity.h>
+
+namespace {
+
+void test_new_formatter_is_empty()
+{
+	char buffer[4] = { 'x', 'x', 'x', 'x' };
+	nsec::formatter formatter(buffer);
+
+	TEST_ASSERT_EQUAL_STRING("", formatter.c_str());
+	TEST_ASSERT_EQUAL_MESSAGE(0, formatter.length(), "New formatter is empty");
+	TEST_ASSERT_FALSE(formatter.truncated());
+}
+
+void test_decimal()
+{
+	char buffer[16];
+	nsec::formatter formatter(buffer);
+
+	formatter.decimal(uint16_t(0));
+	TEST_ASSERT_EQUAL_STRING("0", buffer);
+
+	formatter.clear();
+	formatter.decimal(uint16_t(10)).append(' ').decimal(uint16_t(UINT16_MAX));
+	TEST_ASSERT_EQUAL_STRING("10 65535", buffer);
+
+	formatter.clear();
+	formatter.decimal(int16_t(-42)).append(' ').decimal(int16_t(INT16_MIN));
+	TEST_ASSERT_EQUAL_STRING("-42 -32768", buffer);
+
+	formatter.clear();
+	formatter.decimal(uint32_t(65536)).append(' ').decimal(uint32_t(1000000));
+	TEST_ASSERT_EQUAL_STRING("65536 1000000", buffer);
+
+	formatter.clear();
+	formatter.decimal(uint32_t(UINT32_MAX));
+	TEST_ASSERT_EQUAL_STRING("4294967295", buffer);
+
+	formatter.clear();
+	formatter.decimal(int32_t(INT32_MIN));
+	TEST_ASSERT_EQUAL_STRING("-2147483648", buffer);
+}
+
+void test_hex()
+{
+	char buffer[16];
+	nsec::formatter formatter(buffer);
+
+	formatter.hex(0).append(' ').hex(0xA).append(' ').hex(0xBEEF);
+	TEST_ASSERT_EQUAL_STRING("0 A BEEF", buffer);
+
+	formatter.clear();
+	formatter.hex(0x5, 2).append(' ').hex(0x1F, 4);
+	TEST_ASSERT_EQUAL_STRING_MESSAGE("05 001F", buffer, "Hex padded with zeros");
+}
+
+void test_strings()
+{
+	char buffer[16];
+	nsec::formatter formatter(buffer);
+
+	formatter.append("Level ").append_P("12");
+	TEST_ASSERT_EQUAL_STRING("Level 12", buffer);
+	TEST_ASSERT_EQUAL(8, formatter.length());
+}
+
+void test_overflow_is_truncated()
+{
+	char buffer[6] = {};
+	// Canary past the formatter's end of the buffer.
+	buffer[5] = '!';
+	nsec::formatter formatter(buffer, 5);
+
+	formatter.append("abc").decimal(uint16_t(1234));
+	TEST_ASSERT_EQUAL_STRING("abc1", buffer);
+	TEST_ASSERT_TRUE_MESSAGE(formatter.truncated(), "Overflow is reported");
+	TEST_ASSERT_EQUAL_MESSAGE('!', buffer[5], "Nothing written past the end of the buffer");
+
+	formatter.append('x');
+	TEST_ASSERT_EQUAL_STRING("abc1", buffer);
+
+	formatter.clear();
+	TEST_ASSERT_FALSE_MESSAGE(formatter.truncated(), "Clear resets the overflow");
+}
+
+} // anonymous namespace
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv)
+{
+	UNITY_BEGIN();
+
+	RUN_TEST(test_new_formatter_is_empty);
+	RUN_TEST(test_decimal);
+	RUN_TEST(test_hex);
+	RUN_TEST(test_strings);
+	RUN_TEST(test_overflow_is_truncated);
+
+	return UNITY_END();
+}
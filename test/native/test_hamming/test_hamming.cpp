@@ -0,0 +1,93 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "hamming.hpp"
+
+#include <unity.h>
+
+namespace nh = nsec::hamming;
+
+namespace {
+
+static_assert(nh::encode(0x0) == 0x00 && nh::encode(0xF) == 0xFF,
+	      "Encoding is usable in constant expressions");
+
+uint8_t bit_count(uint8_t value)
+{
+	uint8_t count = 0;
+
+	for (; value; value &= value - 1) {
+		count++;
+	}
+
+	return count;
+}
+
+void test_codewords_are_four_bits_apart()
+{
+	for (uint8_t lhs = 0; lhs < 16; lhs++) {
+		for (uint8_t rhs = lhs + 1; rhs < 16; rhs++) {
+			TEST_ASSERT_GREATER_OR_EQUAL(4, bit_count(nh::encode(lhs) ^ nh::encode(rhs)));
+		}
+	}
+}
+
+void test_valid_codewords_decode()
+{
+	for (uint8_t value = 0; value < 16; value++) {
+		uint8_t nibble = 0xFF;
+
+		TEST_ASSERT_EQUAL(uint8_t(nh::decode_result::VALID),
+				  uint8_t(nh::decode(nh::encode(value), nibble)));
+		TEST_ASSERT_EQUAL(value, nibble);
+	}
+}
+
+void test_single_bit_errors_are_corrected()
+{
+	for (uint8_t value = 0; value < 16; value++) {
+		for (uint8_t bit = 0; bit < 8; bit++) {
+			uint8_t nibble = 0xFF;
+
+			TEST_ASSERT_EQUAL_MESSAGE(
+				uint8_t(nh::decode_result::CORRECTED),
+				uint8_t(nh::decode(nh::encode(value) ^ (1 << bit), nibble)),
+				"Single-bit error is corrected");
+			TEST_ASSERT_EQUAL(value, nibble);
+		}
+	}
+}
+
+void test_double_bit_errors_are_detected()
+{
+	for (uint8_t value = 0; value < 16; value++) {
+		for (uint8_t first_bit = 0; first_bit < 8; first_bit++) {
+			for (uint8_t second_bit = first_bit + 1; second_bit < 8; second_bit++) {
+				const uint8_t error = (1 << first_bit) | (1 << second_bit);
+				uint8_t nibble;
+
+				TEST_ASSERT_EQUAL_MESSAGE(
+					uint8_t(nh::decode_result::UNCORRECTABLE),
+					uint8_t(nh::decode(nh::encode(value) ^ error, nibble)),
+					"Double-bit error is detected");
+			}
+		}
+	}
+}
+
+} // anonymous namespace
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv)
+{
+	UNITY_BEGIN();
+
+	RUN_TEST(test_codewords_are_four_bits_apart);
+	RUN_TEST(test_valid_codewords_decode);
+	RUN_TEST(test_single_bit_errors_are_corrected);
+	RUN_TEST(test_double_bit_errors_are_detected);
+
+	return UNITY_END();
+}
@@ -0,0 +1,91 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#include "histogram.hpp"
+
+#include <unity.h>
+
+namespace {
+
+using test_histogram = nsec::histogram<10, 4>;
+
+void test_empty_histogram()
+{
+	test_histogram histogram = {};
+
+	TEST_ASSERT_EQUAL(0, histogram.sample_count());
+	TEST_ASSERT_EQUAL(0, histogram.max_ms());
+	TEST_ASSERT_EQUAL(0, histogram.percentile_ms(50));
+}
+
+void test_samples_land_in_their_bucket()
+{
+	test_histogram histogram = {};
+
+	histogram.record(0);
+	histogram.record(9);
+	histogram.record(10);
+	histogram.record(39);
+	histogram.record(40);
+	histogram.record(100000);
+
+	TEST_ASSERT_EQUAL(2, histogram.bucket_sample_count(0));
+	TEST_ASSERT_EQUAL(1, histogram.bucket_sample_count(1));
+	TEST_ASSERT_EQUAL(0, histogram.bucket_sample_count(2));
+	TEST_ASSERT_EQUAL(1, histogram.bucket_sample_count(3));
+	TEST_ASSERT_EQUAL_MESSAGE(
+		2, histogram.bucket_sample_count(4), "Last bucket holds the longer durations");
+	TEST_ASSERT_EQUAL(6, histogram.sample_count());
+	TEST_ASSERT_EQUAL_MESSAGE(UINT16_MAX, histogram.max_ms(), "Maximum saturates");
+}
+
+void test_percentiles()
+{
+	test_histogram histogram = {};
+
+	for (uint8_t i = 0; i < 9; i++) {
+		histogram.record(12);
+	}
+
+	histogram.record(25);
+
+	TEST_ASSERT_EQUAL(19, histogram.percentile_ms(50));
+	TEST_ASSERT_EQUAL(19, histogram.percentile_ms(90));
+	TEST_ASSERT_EQUAL_MESSAGE(
+		25, histogram.percentile_ms(99), "Percentile is capped to the maximum");
+
+	histogram.record(1000);
+	TEST_ASSERT_EQUAL_MESSAGE(
+		1000, histogram.percentile_ms(99), "Percentile past the range is the maximum");
+}
+
+void test_clear()
+{
+	test_histogram histogram = {};
+
+	histogram.record(5);
+	histogram.record(500);
+	histogram.clear();
+
+	TEST_ASSERT_EQUAL(0, histogram.sample_count());
+	TEST_ASSERT_EQUAL(0, histogram.max_ms());
+	TEST_ASSERT_EQUAL(0, histogram.bucket_sample_count(0));
+	TEST_ASSERT_EQUAL(0, histogram.bucket_sample_count(4));
+}
+
+} // anonymous namespace
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv)
+{
+	UNITY_BEGIN();
+
+	RUN_TEST(test_empty_histogram);
+	RUN_TEST(test_samples_land_in_their_bucket);
+	RUN_TEST(test_percentiles);
+	RUN_TEST(test_clear);
+
+	return UNITY_END();
+}
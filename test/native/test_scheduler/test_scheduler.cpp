@@ -353,6 +353,51 @@ void test_task_die()
 
 } // namespace periodic_scheduling
 
+namespace observed_scheduling {
+
+// Log of the notifications and task runs, in order.
+std::vector<std::string> log;
+
+struct logging_observer {
+	static void on_task_run_begin(const nsec::scheduling::task&) noexcept
+	{
+		log.emplace_back("begin");
+	}
+
+	static void on_task_run_end(const nsec::scheduling::task&) noexcept
+	{
+		log.emplace_back("end");
+	}
+};
+
+class logging_task : public nsec::scheduling::task {
+public:
+	void run([[maybe_unused]] nsec::scheduling::absolute_time_ms current_time) noexcept override
+	{
+		log.emplace_back("run");
+	}
+};
+
+void test_observer_notified_around_task_run()
+{
+	nsec::scheduling::scheduler<16, logging_observer> scheduler;
+	logging_task my_task;
+
+	log.clear();
+	scheduler.tick(1);
+	scheduler.schedule_task(my_task, 100);
+	scheduler.tick(50);
+	TEST_ASSERT_EQUAL_MESSAGE(0, log.size(), "Observer not notified when no task runs");
+
+	scheduler.tick(101);
+	TEST_ASSERT_EQUAL_MESSAGE(3, log.size(), "Observer notified once before and after run");
+	TEST_ASSERT_EQUAL_STRING("begin", log[0].c_str());
+	TEST_ASSERT_EQUAL_STRING("run", log[1].c_str());
+	TEST_ASSERT_EQUAL_STRING("end", log[2].c_str());
+}
+
+} // namespace observed_scheduling
+
 int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv)
 {
 	UNITY_BEGIN();
@@ -372,5 +417,7 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv)
 	RUN_TEST(periodic_scheduling::test_task_rescheduled);
 	RUN_TEST(periodic_scheduling::test_task_die);
 
+	RUN_TEST(observed_scheduling::test_observer_notified_around_task_run);
+
 	return UNITY_END();
 }
@@ -0,0 +1,1240 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+/*
+ * Host simulation of a chain of badges, each running the complete firmware (as
+ * tools/host_badge does) in its own process.
+ *
+ * The badges are connected from left to right once booted: their connection lines are
+ * driven and the bytes sent on a side reach the neighbour when their transmission ends,
+ * after flipping each of their bits with the link's bit-error rate. The badges run in
+ * lockstep on a shared virtual clock: the badge whose next scheduler tick is the earliest
+ * runs it, after receiving the bytes that reached it by then. Runs are reproducible for a
+ * given seed.
+ *
+ *   chain_sim [--badges <count>] [--duration <ms>] [--seed <n>] [--ber <rate>]...
+ *             [--uncoded <index>]... [--bench one-way|both] [--capture <prefix>]
+ *   chain_sim --replay <capture> [--badge <index>] [--until <ms>] [--print]
+ *
+ * Each bit-error rate is simulated with and without forward error correction (see
+ * network_handler.hpp). The effective goodput is the number of frames received intact per
+ * second and per link, once connected, as counted by the badges' "link" console command.
+ * The badges given with --uncoded never enable the coding, as if they ran firmware that
+ * predates it: their neighbours must fall back to uncoded frames.
+ *
+ * With --bench, the left-most badge runs the link bench (see link_bench.hpp) with its
+ * neighbour once paired, instead of the chain idling for the given duration, and the
+ * bench's results are reported.
+ *
+ * With --capture, each run's wire traffic is logged to "<prefix>-<rate>-fec-<on|off>.wire":
+ * one line per byte received (after the bit errors) or transmitted by a badge, per pin
+ * driven by the simulator and per console input byte, with its time. --replay feeds the
+ * inputs of one of the captured badges to a single badge, on the same virtual clock, and
+ * checks that it transmits the captured bytes at the same times: the replay is
+ * deterministic, so the network handler can be instrumented and the run stopped at any
+ * point (--until) to bisect a slow or stuck discovery. The replayed badge's "link"
+ * console output is printed at the end.
+ */
+
+#include "badge.hpp"
+#include "board.hpp"
+#include "globals.hpp"
+#include "host_clock.hpp"
+#include "host_pins.hpp"
+#include "unique_id.hpp"
+
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace ns = nsec::scheduling;
+
+namespace {
+constexpr unsigned int default_badge_count = 3;
+constexpr unsigned int max_badge_count = 16;
+constexpr unsigned long default_duration_ms = 60000;
+constexpr unsigned long default_seed = 1;
+const double default_bit_error_rates[] = { 0, 1e-4, 1e-3, 3e-3, 1e-2 };
+
+// Once booted, the coding is set through the console and the badges are connected.
+constexpr unsigned long configuration_time_ms = 1000;
+constexpr unsigned long connection_time_ms = 3000;
+// Left to the badges to print their counters at the end of the run.
+constexpr unsigned long report_time_ms = 500;
+// The link bench's console command is typed at this period until it starts, then completes.
+constexpr unsigned long bench_poll_period_ms = 1000;
+constexpr unsigned long pairing_timeout_ms = 60000;
+constexpr unsigned long bench_timeout_ms =
+	nsec::config::link_bench::duration_s * 1000UL + 2 * nsec::config::link_bench::report_timeout_ms;
+
+/* Exchanged with the badges' processes through pipes. */
+enum class command_type : uint8_t { DRIVE_PIN, RECEIVE_BYTE, SERIAL_INPUT, TICK, QUIT };
+enum class report_type : uint8_t { TRANSMITTED_BYTE, SERIAL_OUTPUT, TICKED };
+
+struct command {
+	command_type type;
+	uint8_t pin;
+	uint8_t value;
+	// TICK: time of the tick.
+	unsigned long long time_us;
+};
+
+struct report {
+	report_type type;
+	uint8_t pin;
+	uint8_t value;
+	// TRANSMITTED_BYTE: end of the byte's transmission. TICKED: time of the next tick.
+	unsigned long long time_us;
+};
+
+/*
+ * Line of a capture: "<time_us> <badge> <type> <pin> <value>", the value in hexadecimal.
+ * DRIVE and SERIAL_INPUT are timed at the tick they precede, RECEIVED at the byte's
+ * arrival and TRANSMITTED at the end of its transmission.
+ */
+enum class capture_event_type : uint8_t { DRIVE, SERIAL_INPUT, RECEIVED, TRANSMITTED };
+const char *const capture_event_type_names[] = { "drive", "serial", "rx", "tx" };
+constexpr unsigned int capture_format_version = 1;
+
+struct capture_event {
+	unsigned long long time_us;
+	unsigned int badge;
+	capture_event_type type;
+	uint8_t pin;
+	uint8_t value;
+};
+
+bool write_all(int fd, const void *data, size_t size)
+{
+	const auto *bytes = static_cast<const uint8_t *>(data);
+
+	while (size) {
+		const auto written = write(fd, bytes, size);
+
+		if (written < 0 && errno == EINTR) {
+			continue;
+		} else if (written <= 0) {
+			return false;
+		}
+
+		bytes += written;
+		size -= written;
+	}
+
+	return true;
+}
+
+bool read_all(int fd, void *data, size_t size)
+{
+	auto *bytes = static_cast<uint8_t *>(data);
+
+	while (size) {
+		const auto bytes_read = read(fd, bytes, size);
+
+		if (bytes_read < 0 && errno == EINTR) {
+			continue;
+		} else if (bytes_read <= 0) {
+			return false;
+		}
+
+		bytes += bytes_read;
+		size -= bytes_read;
+	}
+
+	return true;
+}
+
+/* Badge side, in the badge's process. */
+
+int the_report_fd = -1;
+
+void send_report(report_type type, uint8_t pin, uint8_t value, unsigned long long time_us)
+{
+	const report new_report = { type, pin, value, time_us };
+
+	if (!write_all(the_report_fd, &new_report, sizeof(new_report))) {
+		_exit(EXIT_FAILURE);
+	}
+}
+
+void on_transmit(const SoftwareSerial& serial, uint8_t byte)
+{
+	send_report(report_type::TRANSMITTED_BYTE,
+		    serial.transmit_pin(),
+		    byte,
+		    nsec::host::time_us());
+}
+
+void on_serial_output(uint8_t byte)
+{
+	send_report(report_type::SERIAL_OUTPUT, 0, byte, nsec::host::time_us());
+}
+
+// Returns the time of the next tick, as the host badge's main loop.
+unsigned long long tick()
+{
+	const auto tick_time_ms = millis();
+
+	nsec::g::the_badge.check_wake_up_sources();
+
+	const auto time_to_next_tick = nsec::g::the_scheduler.tick(tick_time_ms);
+	const auto next_tick_time_us =
+		(tick_time_ms + std::max<ns::relative_time_ms>(time_to_next_tick, 1)) * 1000ULL;
+
+	// Blocking transfers may have consumed that time already.
+	return std::max(next_tick_time_us, nsec::host::time_us());
+}
+
+[[noreturn]] void run_badge(uint8_t index, int command_fd, int report_fd)
+{
+	the_report_fd = report_fd;
+	// Tell the badges apart.
+	UniqueID[UniqueIDsize - 1] = index;
+	SoftwareSerial::set_transmit_observer(on_transmit);
+	HardwareSerial::set_output_observer(on_serial_output);
+	nsec::g::the_badge.setup();
+	send_report(report_type::TICKED, 0, 0, nsec::host::time_us());
+
+	command next_command;
+
+	while (read_all(command_fd, &next_command, sizeof(next_command))) {
+		switch (next_command.type) {
+		case command_type::DRIVE_PIN:
+			nsec::host::drive_pin(next_command.pin, next_command.value);
+			break;
+		case command_type::RECEIVE_BYTE:
+			SoftwareSerial::deliver(next_command.pin, next_command.value);
+			break;
+		case command_type::SERIAL_INPUT:
+			Serial.receive(&next_command.value, 1);
+			break;
+		case command_type::TICK:
+			if (next_command.time_us > nsec::host::time_us()) {
+				nsec::host::set_time_us(next_command.time_us);
+			}
+
+			send_report(report_type::TICKED, 0, 0, tick());
+			break;
+		case command_type::QUIT:
+			_exit(EXIT_SUCCESS);
+		}
+	}
+
+	_exit(EXIT_FAILURE);
+}
+
+/* Simulator side. */
+
+struct incoming_byte {
+	unsigned long long time_us;
+	uint8_t pin;
+	uint8_t value;
+};
+
+struct simulated_badge {
+	pid_t pid;
+	int command_fd;
+	int report_fd;
+	unsigned long long next_tick_time_us;
+	// Bytes on their way to the badge, in the order they were sent.
+	std::vector<incoming_byte> incoming;
+	std::string serial_output;
+};
+
+bool send_command(simulated_badge& badge, const command& new_command)
+{
+	return write_all(badge.command_fd, &new_command, sizeof(new_command));
+}
+
+// Fork the badge's process; it reports its first tick once booted.
+bool spawn_badge(unsigned int index, simulated_badge& badge)
+{
+	int command_pipe[2], report_pipe[2];
+
+	std::fflush(stdout);
+	if (pipe(command_pipe) || pipe(report_pipe)) {
+		return false;
+	}
+
+	const auto pid = fork();
+
+	if (pid < 0) {
+		return false;
+	} else if (pid == 0) {
+		close(command_pipe[1]);
+		close(report_pipe[0]);
+		run_badge(uint8_t(index), command_pipe[0], report_pipe[1]);
+	}
+
+	close(command_pipe[0]);
+	close(report_pipe[1]);
+	badge = { pid, command_pipe[1], report_pipe[0], 0, {}, {} };
+	return true;
+}
+
+void stop_badge(simulated_badge& badge)
+{
+	send_command(badge, { command_type::QUIT, 0, 0, 0 });
+	close(badge.command_fd);
+	close(badge.report_fd);
+	waitpid(badge.pid, nullptr, 0);
+}
+
+void print_capture_event(FILE *file, const capture_event& event)
+{
+	std::fprintf(file,
+		     "%llu %u %s %u %02x\n",
+		     event.time_us,
+		     event.badge,
+		     capture_event_type_names[unsigned(event.type)],
+		     unsigned(event.pin),
+		     unsigned(event.value));
+}
+
+bool parse_capture_event(const char *line, capture_event& event)
+{
+	char type_name[8];
+	unsigned int pin, value;
+
+	if (std::sscanf(line,
+			"%llu %u %7s %u %x",
+			&event.time_us,
+			&event.badge,
+			type_name,
+			&pin,
+			&value) != 5 ||
+	    pin > UINT8_MAX || value > UINT8_MAX) {
+		return false;
+	}
+
+	const auto *const type_names_begin = std::begin(capture_event_type_names);
+	const auto *const type_names_end = std::end(capture_event_type_names);
+	const auto type_name_position =
+		std::find_if(type_names_begin, type_names_end, [&type_name](const char *name) {
+			return !std::strcmp(name, type_name);
+		});
+
+	if (type_name_position == type_names_end) {
+		return false;
+	}
+
+	event.type = capture_event_type(type_name_position - type_names_begin);
+	event.pin = uint8_t(pin);
+	event.value = uint8_t(value);
+	return true;
+}
+
+struct wire {
+	unsigned int from;
+	uint8_t from_pin;
+	unsigned int to;
+	uint8_t to_pin;
+};
+
+enum class bench_mode : uint8_t { NONE, ONE_WAY, BOTH };
+
+struct run_parameters {
+	unsigned int badge_count;
+	unsigned long duration_ms;
+	unsigned long seed;
+	double bit_error_rate;
+	bool is_forward_error_correction_enabled;
+	// Bit i set when the coding is never enabled on badge i.
+	uint16_t uncoded_badges;
+	bench_mode bench;
+	// Null when the runs aren't captured.
+	const char *capture_prefix;
+};
+
+struct replay_parameters {
+	const char *capture_path;
+	unsigned int badge;
+	// Zero to replay the whole capture.
+	unsigned long until_ms;
+	// Print the replayed events in the capture's format.
+	bool print;
+};
+
+// Sums of the badges' link counters.
+struct run_statistics {
+	unsigned long messages_received;
+	unsigned long retransmissions;
+	unsigned long corrupted_messages;
+	unsigned long corrected_messages;
+	unsigned long timeouts;
+	// Average of the badges' median confirmation time and worst 90th percentile.
+	unsigned long confirmation_time_p50_ms;
+	unsigned long confirmation_time_p90_ms;
+};
+
+// Results of the link bench, as printed by the "linkbench" console command.
+struct bench_statistics {
+	unsigned long time_ms;
+	unsigned long frames_out;
+	unsigned long frames_in;
+	unsigned long frames_lost;
+	unsigned long frames_damaged;
+	unsigned long retransmissions;
+	unsigned long round_trip_time_p50_ms;
+	unsigned long round_trip_time_p90_ms;
+	unsigned long round_trip_time_p99_ms;
+};
+
+class chain {
+public:
+	chain(const run_parameters& parameters) :
+		_parameters{ parameters }, _generator(parameters.seed),
+		_bit_error(parameters.bit_error_rate)
+	{
+		// Each badge's right side to its neighbour's left side: TX to RX both ways.
+		for (unsigned int i = 0; i + 1 < parameters.badge_count; i++) {
+			_wires.push_back({ i, SIG_R1, i + 1, SIG_L1 });
+			_wires.push_back({ i + 1, SIG_L2, i, SIG_R2 });
+		}
+	}
+
+	bool start()
+	{
+		if (_parameters.capture_prefix && !_open_capture()) {
+			return false;
+		}
+
+		for (unsigned int i = 0; i < _parameters.badge_count; i++) {
+			simulated_badge new_badge;
+
+			if (!spawn_badge(i, new_badge)) {
+				return false;
+			}
+
+			_badges.push_back(new_badge);
+			if (!_wait_for_tick(_badges.back())) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Run until end_time_ms, applying the chain's events as their time comes.
+	bool run_until(unsigned long end_time_ms)
+	{
+		const auto end_time_us = end_time_ms * 1000ULL;
+
+		while (true) {
+			auto& badge = *std::min_element(
+				_badges.begin(), _badges.end(), [](const auto& lhs, const auto& rhs) {
+					return lhs.next_tick_time_us < rhs.next_tick_time_us;
+				});
+
+			if (badge.next_tick_time_us >= end_time_us) {
+				return true;
+			}
+
+			if (!_deliver(badge) || !_send(badge, { command_type::TICK, 0, 0, badge.next_tick_time_us }) ||
+			    !_wait_for_tick(badge)) {
+				return false;
+			}
+		}
+	}
+
+	bool type(const char *line)
+	{
+		for (unsigned int i = 0; i < _badges.size(); i++) {
+			if (!type(i, line)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool type(unsigned int index, const char *line)
+	{
+		auto& badge = _badges[index];
+
+		for (const char *c = line; *c; c++) {
+			if (!_send(badge, { command_type::SERIAL_INPUT, 0, uint8_t(*c), 0 })) {
+				return false;
+			}
+		}
+
+		return _send(badge, { command_type::SERIAL_INPUT, 0, '\n', 0 });
+	}
+
+	bool connect()
+	{
+		_are_connected = true;
+		for (unsigned int i = 0; i + 1 < _badges.size(); i++) {
+			// The right neighbour's TX line idles low, and its left sense line is low.
+			if (!_send(_badges[i + 1], { command_type::DRIVE_PIN, SIG_L1, LOW, 0 }) ||
+			    !_send(_badges[i], { command_type::DRIVE_PIN, SIG_R3, LOW, 0 })) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void clear_serial_output()
+	{
+		for (auto& badge : _badges) {
+			badge.serial_output.clear();
+		}
+	}
+
+	const std::string& serial_output(unsigned int index) const
+	{
+		return _badges[index].serial_output;
+	}
+
+	~chain()
+	{
+		for (auto& badge : _badges) {
+			stop_badge(badge);
+		}
+
+		if (_capture) {
+			std::fclose(_capture);
+		}
+	}
+
+private:
+	bool _open_capture()
+	{
+		char path[256];
+
+		std::snprintf(path,
+			      sizeof(path),
+			      "%s-%g-fec-%s.wire",
+			      _parameters.capture_prefix,
+			      _parameters.bit_error_rate,
+			      _parameters.is_forward_error_correction_enabled ? "on" : "off");
+		_capture = std::fopen(path, "w");
+		if (!_capture) {
+			std::fprintf(stderr, "Failed to open %s\n", path);
+			return false;
+		}
+
+		std::fprintf(_capture,
+			     "# nsec-wire-capture %u\n"
+			     "# %u badges, bit-error rate %g, FEC %s, seed %lu\n",
+			     capture_format_version,
+			     _parameters.badge_count,
+			     _parameters.bit_error_rate,
+			     _parameters.is_forward_error_correction_enabled ? "on" : "off",
+			     _parameters.seed);
+		return true;
+	}
+
+	void _capture_event(const simulated_badge& badge,
+			    capture_event_type type,
+			    uint8_t pin,
+			    uint8_t value,
+			    unsigned long long time_us)
+	{
+		if (_capture) {
+			print_capture_event(
+				_capture,
+				{ time_us, unsigned(&badge - _badges.data()), type, pin, value });
+		}
+	}
+
+	// Inputs are captured as they are sent, in the order the badge receives them.
+	bool _send(simulated_badge& badge, const command& new_command)
+	{
+		switch (new_command.type) {
+		case command_type::DRIVE_PIN:
+			_capture_event(badge,
+				       capture_event_type::DRIVE,
+				       new_command.pin,
+				       new_command.value,
+				       badge.next_tick_time_us);
+			break;
+		case command_type::SERIAL_INPUT:
+			_capture_event(badge,
+				       capture_event_type::SERIAL_INPUT,
+				       0,
+				       new_command.value,
+				       badge.next_tick_time_us);
+			break;
+		default:
+			break;
+		}
+
+		return send_command(badge, new_command);
+	}
+
+	// Deliver the bytes that reached the badge by its next tick.
+	bool _deliver(simulated_badge& badge)
+	{
+		auto& incoming = badge.incoming;
+
+		std::stable_sort(incoming.begin(), incoming.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.time_us < rhs.time_us;
+		});
+
+		const auto end = std::find_if(incoming.begin(), incoming.end(), [&badge](const auto& byte) {
+			return byte.time_us > badge.next_tick_time_us;
+		});
+
+		for (auto byte = incoming.begin(); byte != end; byte++) {
+			_capture_event(badge,
+				       capture_event_type::RECEIVED,
+				       byte->pin,
+				       byte->value,
+				       byte->time_us);
+			if (!_send(badge, { command_type::RECEIVE_BYTE, byte->pin, byte->value, 0 })) {
+				return false;
+			}
+		}
+
+		incoming.erase(incoming.begin(), end);
+		return true;
+	}
+
+	bool _wait_for_tick(simulated_badge& badge)
+	{
+		report next_report;
+
+		while (read_all(badge.report_fd, &next_report, sizeof(next_report))) {
+			switch (next_report.type) {
+			case report_type::TRANSMITTED_BYTE:
+				_capture_event(badge,
+					       capture_event_type::TRANSMITTED,
+					       next_report.pin,
+					       next_report.value,
+					       next_report.time_us);
+				_route(badge, next_report.pin, next_report.value, next_report.time_us);
+				break;
+			case report_type::SERIAL_OUTPUT:
+				badge.serial_output += char(next_report.value);
+				break;
+			case report_type::TICKED:
+				badge.next_tick_time_us = next_report.time_us;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void _route(const simulated_badge& badge,
+		    uint8_t pin,
+		    uint8_t value,
+		    unsigned long long time_us)
+	{
+		const auto from = static_cast<unsigned int>(&badge - _badges.data());
+
+		if (!_are_connected) {
+			return;
+		}
+
+		for (const auto& connection : _wires) {
+			if (connection.from != from || connection.from_pin != pin) {
+				continue;
+			}
+
+			for (uint8_t bit = 0; bit < 8; bit++) {
+				if (_parameters.bit_error_rate > 0 && _bit_error(_generator)) {
+					value ^= 1 << bit;
+				}
+			}
+
+			_badges[connection.to].incoming.push_back({ time_us, connection.to_pin, value });
+		}
+	}
+
+	const run_parameters _parameters;
+	std::vector<simulated_badge> _badges;
+	std::vector<wire> _wires;
+	bool _are_connected = false;
+	std::mt19937 _generator;
+	std::bernoulli_distribution _bit_error;
+	FILE *_capture = nullptr;
+};
+
+// The number following a label, searched for from a position of the output.
+unsigned long
+counter_after(const std::string& output, std::string::size_type position, const char *label)
+{
+	const auto label_position =
+		position == std::string::npos ? position : output.find(label, position);
+
+	if (label_position == std::string::npos) {
+		return 0;
+	}
+
+	return std::strtoul(output.c_str() + label_position + std::strlen(label), nullptr, 10);
+}
+
+// The number following a label in the output of the "link" console command.
+unsigned long link_counter(const std::string& output, const char *label)
+{
+	return counter_after(output, output.rfind("position: "), label);
+}
+
+// Boot the badges, set their coding and connect them.
+bool connect(chain& badges, const run_parameters& parameters)
+{
+	if (!badges.start() || !badges.run_until(configuration_time_ms)) {
+		return false;
+	}
+
+	for (unsigned int i = 0; i < parameters.badge_count; i++) {
+		const bool is_coded = parameters.is_forward_error_correction_enabled &&
+			!(parameters.uncoded_badges & (1U << i));
+
+		if (!badges.type(i, is_coded ? "link fec on" : "link fec off")) {
+			return false;
+		}
+	}
+
+	return badges.run_until(connection_time_ms) && badges.connect();
+}
+
+bool simulate(const run_parameters& parameters, run_statistics& stats)
+{
+	chain badges(parameters);
+
+	if (!connect(badges, parameters) || !badges.run_until(parameters.duration_ms)) {
+		return false;
+	}
+
+	badges.clear_serial_output();
+	if (!badges.type("link") || !badges.run_until(parameters.duration_ms + report_time_ms)) {
+		return false;
+	}
+
+	stats = {};
+	for (unsigned int i = 0; i < parameters.badge_count; i++) {
+		const auto& output = badges.serial_output(i);
+
+		stats.messages_received += link_counter(output, "\nreceived: ");
+		stats.retransmissions += link_counter(output, "retransmitted: ");
+		stats.corrupted_messages += link_counter(output, "corrupted: ");
+		stats.corrected_messages += link_counter(output, "corrected: ");
+		stats.timeouts += link_counter(output, "timeouts: ");
+		stats.confirmation_time_p50_ms += link_counter(output, "confirmation: p50 ");
+		stats.confirmation_time_p90_ms =
+			std::max(stats.confirmation_time_p90_ms, link_counter(output, "p90 "));
+	}
+
+	stats.confirmation_time_p50_ms /= parameters.badge_count;
+
+	return true;
+}
+
+/*
+ * Type the command on the left-most badge every bench_poll_period_ms until its output holds
+ * one of the expected strings, or the deadline passes.
+ */
+bool poll(chain& badges,
+	  unsigned long& time_ms,
+	  unsigned long deadline_ms,
+	  const char *command,
+	  std::initializer_list<const char *> expected_outputs)
+{
+	while (time_ms < deadline_ms) {
+		badges.clear_serial_output();
+		time_ms += bench_poll_period_ms;
+		if (!badges.type(0, command) || !badges.run_until(time_ms)) {
+			return false;
+		}
+
+		for (const auto *expected_output : expected_outputs) {
+			if (badges.serial_output(0).find(expected_output) != std::string::npos) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool bench(const run_parameters& parameters, bench_statistics& stats)
+{
+	chain badges(parameters);
+	unsigned long time_ms = connection_time_ms;
+
+	if (!connect(badges, parameters) ||
+	    !poll(badges,
+		  time_ms,
+		  connection_time_ms + pairing_timeout_ms,
+		  parameters.bench == bench_mode::BOTH ? "linkbench both" : "linkbench start",
+		  { "started" }) ||
+	    !poll(badges,
+		  time_ms,
+		  time_ms + bench_timeout_ms,
+		  "linkbench",
+		  { "state: done", "state: failed" })) {
+		return false;
+	}
+
+	// Output of the "linkbench" console command.
+	const auto& output = badges.serial_output(0);
+	const auto report_position = output.rfind("state: ");
+	const auto out_position = output.find("\nout: ", report_position);
+	const auto in_position = output.find("\nin: ", report_position);
+
+	stats.time_ms = counter_after(output, report_position, "time: ");
+	stats.frames_out = counter_after(output, out_position, "out: ");
+	stats.frames_in = counter_after(output, in_position, "in: ");
+	stats.frames_lost = counter_after(output, out_position, "lost: ") +
+		counter_after(output, in_position, "lost: ");
+	stats.frames_damaged = counter_after(output, out_position, "damaged: ") +
+		counter_after(output, in_position, "damaged: ");
+	stats.retransmissions = counter_after(output, report_position, "retransmissions: ") +
+		counter_after(output, report_position, "neighbour: ");
+	stats.round_trip_time_p50_ms = counter_after(output, report_position, "p50 ");
+	stats.round_trip_time_p90_ms = counter_after(output, report_position, "p90 ");
+	stats.round_trip_time_p99_ms = counter_after(output, report_position, "p99 ");
+	return output.find("state: done") != std::string::npos;
+}
+
+/*
+ * Feed the captured inputs of a badge to a new one, each before the first tick following
+ * its time, and compare the bytes it transmits to the captured ones.
+ */
+class replay_driver {
+public:
+	explicit replay_driver(const replay_parameters& parameters) : _parameters{ parameters }
+	{
+	}
+
+	~replay_driver()
+	{
+		if (_is_started) {
+			stop_badge(_badge);
+		}
+	}
+
+	bool load()
+	{
+		auto *file = std::fopen(_parameters.capture_path, "r");
+		char line[128];
+		unsigned int line_number = 0;
+
+		if (!file) {
+			std::fprintf(stderr, "Failed to open %s\n", _parameters.capture_path);
+			return false;
+		}
+
+		while (std::fgets(line, sizeof(line), file)) {
+			capture_event event;
+
+			line_number++;
+			if (line[0] == '#') {
+				continue;
+			} else if (!parse_capture_event(line, event)) {
+				std::fprintf(stderr,
+					     "%s:%u: malformed event\n",
+					     _parameters.capture_path,
+					     line_number);
+				std::fclose(file);
+				return false;
+			} else if (event.badge != _parameters.badge) {
+				continue;
+			}
+
+			_end_time_us = std::max(_end_time_us, event.time_us);
+			(event.type == capture_event_type::TRANSMITTED ? _transmitted : _inputs)
+				.push_back(event);
+		}
+
+		std::fclose(file);
+		if (_parameters.until_ms) {
+			_end_time_us = _parameters.until_ms * 1000ULL;
+		}
+
+		return true;
+	}
+
+	// Returns false if the badge failed or diverged from the capture.
+	bool run()
+	{
+		if (!spawn_badge(_parameters.badge, _badge)) {
+			return false;
+		}
+
+		_is_started = true;
+		if (!_wait_for_tick()) {
+			return false;
+		}
+
+		while (_badge.next_tick_time_us < _end_time_us) {
+			while (_next_input < _inputs.size() &&
+			       _inputs[_next_input].time_us <= _badge.next_tick_time_us) {
+				if (!_send(_inputs[_next_input++])) {
+					return false;
+				}
+			}
+
+			if (!send_command(_badge,
+					  { command_type::TICK, 0, 0, _badge.next_tick_time_us }) ||
+			    !_wait_for_tick()) {
+				return false;
+			}
+		}
+
+		if (_next_transmitted < _transmitted.size() &&
+		    _transmitted[_next_transmitted].time_us < _end_time_us) {
+			_diverge(nullptr);
+			return false;
+		}
+
+		std::printf("# badge %u replayed for %llu ms: %zu inputs, %zu bytes transmitted as "
+			    "captured\n",
+			    _parameters.badge,
+			    _end_time_us / 1000,
+			    _next_input,
+			    _next_transmitted);
+		return true;
+	}
+
+	// Print the badge's "link" console output.
+	bool print_link_state()
+	{
+		const auto end_time_us = _end_time_us + report_time_ms * 1000ULL;
+
+		_badge.serial_output.clear();
+		for (const char *c = "link\n"; *c; c++) {
+			const command input = { command_type::SERIAL_INPUT, 0, uint8_t(*c), 0 };
+
+			if (!send_command(_badge, input)) {
+				return false;
+			}
+		}
+
+		// Past the capture's end.
+		_is_checking = false;
+		while (_badge.next_tick_time_us < end_time_us) {
+			if (!send_command(_badge,
+					  { command_type::TICK, 0, 0, _badge.next_tick_time_us }) ||
+			    !_wait_for_tick()) {
+				return false;
+			}
+		}
+
+		std::fputs(_badge.serial_output.c_str(), stdout);
+		return true;
+	}
+
+private:
+	bool _send(const capture_event& event)
+	{
+		if (_parameters.print) {
+			print_capture_event(stdout, event);
+		}
+
+		command input = { command_type::DRIVE_PIN, event.pin, event.value, 0 };
+
+		switch (event.type) {
+		case capture_event_type::DRIVE:
+			break;
+		case capture_event_type::SERIAL_INPUT:
+			input.type = command_type::SERIAL_INPUT;
+			break;
+		case capture_event_type::RECEIVED:
+			input.type = command_type::RECEIVE_BYTE;
+			break;
+		case capture_event_type::TRANSMITTED:
+			return false;
+		}
+
+		return send_command(_badge, input);
+	}
+
+	bool _wait_for_tick()
+	{
+		report next_report;
+
+		while (read_all(_badge.report_fd, &next_report, sizeof(next_report))) {
+			switch (next_report.type) {
+			case report_type::TRANSMITTED_BYTE:
+				if (!_check_transmission(next_report)) {
+					return false;
+				}
+
+				break;
+			case report_type::SERIAL_OUTPUT:
+				_badge.serial_output += char(next_report.value);
+				break;
+			case report_type::TICKED:
+				_badge.next_tick_time_us = next_report.time_us;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool _check_transmission(const report& transmission)
+	{
+		const capture_event event = { transmission.time_us,
+					      _parameters.badge,
+					      capture_event_type::TRANSMITTED,
+					      transmission.pin,
+					      transmission.value };
+
+		if (!_is_checking) {
+			return true;
+		}
+
+		if (_parameters.print) {
+			print_capture_event(stdout, event);
+		}
+
+		if (_next_transmitted < _transmitted.size()) {
+			const auto& expected = _transmitted[_next_transmitted];
+
+			if (expected.time_us == event.time_us && expected.pin == event.pin &&
+			    expected.value == event.value) {
+				_next_transmitted++;
+				return true;
+			}
+		}
+
+		_diverge(&event);
+		return false;
+	}
+
+	// The badge transmitted an unexpected byte, or none when the captured one was due.
+	void _diverge(const capture_event *transmitted)
+	{
+		std::printf("# badge %u diverged from the capture\n", _parameters.badge);
+		if (_next_transmitted < _transmitted.size()) {
+			std::printf("# captured:    ");
+			print_capture_event(stdout, _transmitted[_next_transmitted]);
+		}
+
+		std::printf("# transmitted: ");
+		if (transmitted) {
+			print_capture_event(stdout, *transmitted);
+		} else {
+			std::printf("nothing\n");
+		}
+	}
+
+	const replay_parameters _parameters;
+	simulated_badge _badge;
+	bool _is_started = false;
+	bool _is_checking = true;
+	std::vector<capture_event> _inputs;
+	std::vector<capture_event> _transmitted;
+	std::size_t _next_input = 0;
+	std::size_t _next_transmitted = 0;
+	unsigned long long _end_time_us = 0;
+};
+
+int replay(const replay_parameters& parameters)
+{
+	replay_driver driver(parameters);
+
+	if (!driver.load()) {
+		return EXIT_FAILURE;
+	}
+
+	const bool is_faithful = driver.run();
+
+	return driver.print_link_state() && is_faithful ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int usage(const char *program_name)
+{
+	std::fprintf(stderr,
+		     "Usage:\n"
+		     "  %s [--badges <count>] [--duration <ms>] [--seed <n>] [--ber <rate>]...\n"
+		     "     [--uncoded <index>]... [--bench one-way|both] [--capture <prefix>]\n"
+		     "  %s --replay <capture> [--badge <index>] [--until <ms>] [--print]\n",
+		     program_name,
+		     program_name);
+	return EXIT_FAILURE;
+}
+
+int print_link_goodputs(run_parameters& parameters, const std::vector<double>& bit_error_rates)
+{
+	const auto link_count = parameters.badge_count - 1;
+	const double connected_seconds = (parameters.duration_ms - connection_time_ms) / 1000.0;
+
+	std::printf("%u badges, %lu ms connected, seed %lu\n\n",
+		    parameters.badge_count,
+		    parameters.duration_ms - connection_time_ms,
+		    parameters.seed);
+	std::printf("%-8s %-4s %10s %10s %10s %10s %9s %8s %6s %6s\n",
+		    "BER",
+		    "FEC",
+		    "goodput",
+		    "received",
+		    "retransmit",
+		    "corrupted",
+		    "corrected",
+		    "timeouts",
+		    "ok p50",
+		    "ok p90");
+
+	for (const auto bit_error_rate : bit_error_rates) {
+		for (const bool is_coded : { false, true }) {
+			run_statistics stats;
+
+			parameters.bit_error_rate = bit_error_rate;
+			parameters.is_forward_error_correction_enabled = is_coded;
+			if (!simulate(parameters, stats)) {
+				std::fprintf(stderr, "Failed to simulate the chain\n");
+				return EXIT_FAILURE;
+			}
+
+			std::printf("%-8g %-4s %10.2f %10lu %10lu %10lu %9lu %8lu %6lu %6lu\n",
+				    bit_error_rate,
+				    is_coded ? "on" : "off",
+				    stats.messages_received / connected_seconds / link_count,
+				    stats.messages_received,
+				    stats.retransmissions,
+				    stats.corrupted_messages,
+				    stats.corrected_messages,
+				    stats.timeouts,
+				    stats.confirmation_time_p50_ms,
+				    stats.confirmation_time_p90_ms);
+		}
+	}
+
+	std::printf("\ngoodput: frames received intact per second and per link\n"
+		    "ok p50, ok p90: time from sending a frame to receiving its OK, median "
+		    "averaged over the badges and worst 90th percentile (ms)\n");
+	return EXIT_SUCCESS;
+}
+
+int print_bench_results(run_parameters& parameters, const std::vector<double>& bit_error_rates)
+{
+	std::printf("%u badges, %s link bench of %u s, seed %lu\n\n",
+		    parameters.badge_count,
+		    parameters.bench == bench_mode::BOTH ? "bidirectional" : "one-way",
+		    unsigned(nsec::config::link_bench::duration_s),
+		    parameters.seed);
+	std::printf("%-8s %-4s %8s %8s %6s %8s %10s %5s %5s %5s\n",
+		    "BER",
+		    "FEC",
+		    "out",
+		    "in",
+		    "lost",
+		    "damaged",
+		    "retransmit",
+		    "p50",
+		    "p90",
+		    "p99");
+
+	for (const auto bit_error_rate : bit_error_rates) {
+		for (const bool is_coded : { false, true }) {
+			bench_statistics stats = {};
+
+			parameters.bit_error_rate = bit_error_rate;
+			parameters.is_forward_error_correction_enabled = is_coded;
+			if (!bench(parameters, stats) || !stats.time_ms) {
+				std::printf("%-8g %-4s failed\n", bit_error_rate, is_coded ? "on" : "off");
+				continue;
+			}
+
+			std::printf("%-8g %-4s %8.2f %8.2f %6lu %8lu %10lu %5lu %5lu %5lu\n",
+				    bit_error_rate,
+				    is_coded ? "on" : "off",
+				    stats.frames_out * 1000.0 / stats.time_ms,
+				    stats.frames_in * 1000.0 / stats.time_ms,
+				    stats.frames_lost,
+				    stats.frames_damaged,
+				    stats.retransmissions,
+				    stats.round_trip_time_p50_ms,
+				    stats.round_trip_time_p90_ms,
+				    stats.round_trip_time_p99_ms);
+		}
+	}
+
+	std::printf("\nout, in: frames received intact per second, from and to the left-most badge\n"
+		    "p50, p90, p99: round trip time percentiles of the left-most badge's frames (ms)\n");
+	return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, const char **argv)
+{
+	run_parameters parameters = {
+		default_badge_count, default_duration_ms, default_seed, 0, false, 0, bench_mode::NONE,
+		nullptr
+	};
+	replay_parameters replay_parameters = { nullptr, 0, 0, false };
+	std::vector<double> bit_error_rates;
+
+	for (int i = 1; i < argc; i++) {
+		if (!std::strcmp(argv[i], "--print")) {
+			replay_parameters.print = true;
+		} else if (i + 1 >= argc) {
+			return usage(argv[0]);
+		} else if (!std::strcmp(argv[i], "--badges")) {
+			parameters.badge_count = std::strtoul(argv[++i], nullptr, 10);
+		} else if (!std::strcmp(argv[i], "--duration")) {
+			parameters.duration_ms = std::strtoul(argv[++i], nullptr, 10);
+		} else if (!std::strcmp(argv[i], "--seed")) {
+			parameters.seed = std::strtoul(argv[++i], nullptr, 10);
+		} else if (!std::strcmp(argv[i], "--ber")) {
+			bit_error_rates.push_back(std::strtod(argv[++i], nullptr));
+		} else if (!std::strcmp(argv[i], "--uncoded")) {
+			const auto index = std::strtoul(argv[++i], nullptr, 10);
+
+			if (index >= max_badge_count) {
+				return usage(argv[0]);
+			}
+
+			parameters.uncoded_badges |= 1U << index;
+		} else if (!std::strcmp(argv[i], "--bench")) {
+			i++;
+			if (!std::strcmp(argv[i], "one-way")) {
+				parameters.bench = bench_mode::ONE_WAY;
+			} else if (!std::strcmp(argv[i], "both")) {
+				parameters.bench = bench_mode::BOTH;
+			} else {
+				return usage(argv[0]);
+			}
+		} else if (!std::strcmp(argv[i], "--capture")) {
+			parameters.capture_prefix = argv[++i];
+		} else if (!std::strcmp(argv[i], "--replay")) {
+			replay_parameters.capture_path = argv[++i];
+		} else if (!std::strcmp(argv[i], "--badge")) {
+			replay_parameters.badge = std::strtoul(argv[++i], nullptr, 10);
+		} else if (!std::strcmp(argv[i], "--until")) {
+			replay_parameters.until_ms = std::strtoul(argv[++i], nullptr, 10);
+		} else {
+			return usage(argv[0]);
+		}
+	}
+
+	if (replay_parameters.capture_path) {
+		return replay_parameters.badge < max_badge_count ? replay(replay_parameters) :
+								    usage(argv[0]);
+	}
+
+	if (parameters.badge_count < 2 || parameters.badge_count > max_badge_count ||
+	    parameters.duration_ms <= connection_time_ms) {
+		return usage(argv[0]);
+	}
+
+	if (bit_error_rates.empty()) {
+		bit_error_rates.assign(std::begin(default_bit_error_rates),
+				       std::end(default_bit_error_rates));
+	}
+
+	return parameters.bench == bench_mode::NONE ?
+		print_link_goodputs(parameters, bit_error_rates) :
+		print_bench_results(parameters, bit_error_rates);
+}
@@ -0,0 +1,637 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+/*
+ * Cycle-exact benchmark of the firmware's hot functions, on simavr.
+ *
+ * Two badges running the firmware built by the "cycle_bench" environment are simulated in
+ * lockstep, as ATmega328P (simavr has no ATmega328PB core) at 8 MHz. They play the same
+ * scenario on every run:
+ *   - both boot; an acknowledging device answers at the OLED's address on their TWI bus;
+ *   - at 3 s, the left badge's menus are navigated and its badge information screen is
+ *     shown;
+ *   - at 6 s, the badges are connected as a chain (left badge's right side to the right
+ *     badge's left side), they pair and exchange their IDs.
+ *
+ * Before each instruction, the program counter of the MCU is looked up in the entry points
+ * of the measured functions, found in the ELF's symbol table (the "cycle_bench" build keeps
+ * them out of line, see include/diagnostics/benchmark.hpp). A call ends when the stack
+ * pointer climbs above its return address. Counts are inclusive: callees and interrupt
+ * handlers that fire during a call are part of its cost, as on the badge.
+ *
+ *   cycle_bench <firmware.elf> [--duration <ms>] [--baseline <path> [--update-baseline]]
+ *
+ * With --baseline, the mean cost of each function is compared to the baseline table (as
+ * written by --update-baseline) and the exit status is 1 if one of them regressed by more
+ * than 2%.
+ */
+
+#include <simavr/avr_adc.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_twi.h>
+#include <simavr/avr_uart.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <elf.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr uint32_t cpu_frequency = 8000000;
+constexpr uint16_t vcc_mv = 3300;
+constexpr unsigned long default_duration_ms = 20000;
+constexpr double regression_threshold_percent = 2;
+
+constexpr uint8_t oled_address = 0x3C;
+// Data space address of PORTD, to read the level of output pins.
+constexpr uint16_t portd_address = 0x2B;
+
+// Pins of board.hpp and config.hpp (port D bits, port C bits and ADC channels).
+enum : uint8_t {
+	SIG_L1 = 2, // Left RX
+	SIG_L2 = 3, // Left TX
+	SIG_L3 = 4, // Left sense
+	SIG_R1 = 5, // Right TX
+	SIG_R2 = 6, // Right RX
+	SIG_R3 = 7, // Right sense
+};
+
+enum class button : uint8_t { RIGHT, UP, DOWN, LEFT, CANCEL, OK };
+
+struct measured_function {
+	const char *label;
+	// Substrings that the demangled names of its symbols (clones included) all contain.
+	const char *patterns[2];
+};
+
+const measured_function measured_functions[] = {
+	{ "scheduler::tick", { "nsec::scheduling::scheduler<", ">::tick(" } },
+	{ "strip_animator::_keyframe_animation_tick",
+	  { "nsec::led::strip_animator::_keyframe_animation_tick(", nullptr } },
+	{ "interpolate", { "(anonymous namespace)::interpolate(", nullptr } },
+	{ "network_handler::_handle_reception",
+	  { "nsec::communication::network_handler::_handle_reception(", nullptr } },
+	{ "Adafruit_SSD1306::display", { "Adafruit_SSD1306::display()", nullptr } },
+	{ "storage::buffer::contains", { "nsec::storage::buffer<", ">::contains(" } },
+	{ "draw_string", { "nsec::display::utils::draw_string(", nullptr } },
+	{ "badge_info_printer", { "(anonymous namespace)::badge_info_printer(", nullptr } },
+	{ "watcher::run", { "nsec::button::watcher::run(", nullptr } },
+};
+
+constexpr uint8_t measured_function_count =
+	sizeof(measured_functions) / sizeof(*measured_functions);
+
+struct function_statistics {
+	unsigned long call_count;
+	avr_cycle_count_t total_cycles;
+	avr_cycle_count_t min_cycles;
+	avr_cycle_count_t max_cycles;
+};
+
+function_statistics statistics[measured_function_count];
+
+struct call {
+	uint8_t function;
+	avr_cycle_count_t start_cycle;
+	// Stack pointer on entry, the return address being on the top of the stack.
+	uint16_t entry_sp;
+};
+
+struct simulated_badge {
+	avr_t *avr;
+	std::vector<call> calls;
+	// Address of the device selected on the TWI bus, 0 if none.
+	uint8_t twi_selected_address;
+};
+
+simulated_badge badges[2];
+simulated_badge& left_badge = badges[0];
+simulated_badge& right_badge = badges[1];
+bool are_badges_connected;
+
+// Measured function starting at each flash word, -1 if none.
+std::vector<int8_t> function_at;
+
+std::string demangle(const char *name)
+{
+	int status;
+	std::unique_ptr<char, decltype(&std::free)> demangled(
+		abi::__cxa_demangle(name, nullptr, nullptr, &status), std::free);
+
+	return status == 0 ? demangled.get() : name;
+}
+
+int8_t measured_function_index(const std::string& name)
+{
+	for (uint8_t i = 0; i < measured_function_count; i++) {
+		const auto& patterns = measured_functions[i].patterns;
+
+		if (name.find(patterns[0]) != std::string::npos &&
+		    (!patterns[1] || name.find(patterns[1]) != std::string::npos)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/* Map the entry points of the measured functions from the ELF's symbol table. */
+bool find_measured_functions(const char *elf_path, uint32_t flash_size)
+{
+	std::ifstream file(elf_path, std::ios::binary);
+	const std::vector<char> contents((std::istreambuf_iterator<char>(file)),
+					 std::istreambuf_iterator<char>());
+
+	if (contents.size() < sizeof(Elf32_Ehdr)) {
+		return false;
+	}
+
+	const auto& header = *reinterpret_cast<const Elf32_Ehdr *>(contents.data());
+
+	if (std::memcmp(header.e_ident, ELFMAG, SELFMAG) ||
+	    header.e_ident[EI_CLASS] != ELFCLASS32 ||
+	    header.e_shoff + header.e_shnum * sizeof(Elf32_Shdr) > contents.size()) {
+		return false;
+	}
+
+	const auto *sections =
+		reinterpret_cast<const Elf32_Shdr *>(contents.data() + header.e_shoff);
+	bool found[measured_function_count] = {};
+
+	function_at.assign(flash_size / 2, -1);
+	for (unsigned int i = 0; i < header.e_shnum; i++) {
+		if (sections[i].sh_type != SHT_SYMTAB || sections[i].sh_link >= header.e_shnum) {
+			continue;
+		}
+
+		const auto& symbol_table = sections[i];
+		const auto *symbols = reinterpret_cast<const Elf32_Sym *>(contents.data() +
+									   symbol_table.sh_offset);
+		const char *names = contents.data() + sections[symbol_table.sh_link].sh_offset;
+
+		for (unsigned int j = 0; j < symbol_table.sh_size / sizeof(Elf32_Sym); j++) {
+			const auto& symbol = symbols[j];
+
+			if (ELF32_ST_TYPE(symbol.st_info) != STT_FUNC ||
+			    symbol.st_value >= flash_size) {
+				continue;
+			}
+
+			const auto name = demangle(names + symbol.st_name);
+			const auto index = measured_function_index(name);
+
+			if (index >= 0) {
+				function_at[symbol.st_value / 2] = index;
+				found[index] = true;
+			}
+		}
+	}
+
+	for (uint8_t i = 0; i < measured_function_count; i++) {
+		if (!found[i]) {
+			std::cerr << "Warning: " << measured_functions[i].label
+				  << " not found in the ELF (inlined?)\n";
+		}
+	}
+
+	return true;
+}
+
+uint16_t stack_pointer(const avr_t *avr)
+{
+	return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+}
+
+void end_call(const call& ended_call, avr_cycle_count_t end_cycle)
+{
+	auto& stats = statistics[ended_call.function];
+	const auto cycles = end_cycle - ended_call.start_cycle;
+
+	stats.min_cycles = stats.call_count ? std::min(stats.min_cycles, cycles) : cycles;
+	stats.max_cycles = std::max(stats.max_cycles, cycles);
+	stats.total_cycles += cycles;
+	stats.call_count++;
+}
+
+/* Account for the calls which returned, then for the one starting at the current pc. */
+void observe_calls(simulated_badge& badge)
+{
+	const auto sp = stack_pointer(badge.avr);
+
+	while (!badge.calls.empty() && sp > badge.calls.back().entry_sp) {
+		end_call(badge.calls.back(), badge.avr->cycle);
+		badge.calls.pop_back();
+	}
+
+	const auto word = badge.avr->pc / 2;
+
+	if (word >= function_at.size() || function_at[word] < 0) {
+		return;
+	}
+
+	const auto function = uint8_t(function_at[word]);
+
+	// A loop branching back to the function's first instruction isn't a new call.
+	if (!badge.calls.empty() && badge.calls.back().function == function &&
+	    badge.calls.back().entry_sp == sp) {
+		return;
+	}
+
+	badge.calls.push_back({ function, badge.avr->cycle, sp });
+}
+
+/* The OLED: acknowledge everything sent to its address. */
+void on_twi_output(avr_irq_t *, uint32_t value, void *param)
+{
+	auto& badge = *static_cast<simulated_badge *>(param);
+	auto *twi_input = avr_io_getirq(badge.avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT);
+	avr_twi_msg_irq_t message;
+
+	message.u.v = value;
+	if (message.u.twi.msg & TWI_COND_STOP) {
+		badge.twi_selected_address = 0;
+	}
+
+	if (message.u.twi.msg & TWI_COND_START) {
+		badge.twi_selected_address = 0;
+		if ((message.u.twi.addr >> 1) == oled_address) {
+			badge.twi_selected_address = message.u.twi.addr;
+			avr_raise_irq(twi_input,
+				      avr_twi_irq_msg(TWI_COND_ACK, badge.twi_selected_address, 1));
+		}
+	}
+
+	if (badge.twi_selected_address && (message.u.twi.msg & TWI_COND_WRITE)) {
+		avr_raise_irq(twi_input,
+			      avr_twi_irq_msg(TWI_COND_ACK, badge.twi_selected_address, 1));
+	}
+}
+
+avr_irq_t *port_d_pin(simulated_badge& badge, uint8_t pin)
+{
+	return avr_io_getirq(badge.avr, AVR_IOCTL_IOPORT_GETIRQ('D'), pin);
+}
+
+bool output_level(simulated_badge& badge, uint8_t pin)
+{
+	return badge.avr->data[portd_address] & (1 << pin);
+}
+
+struct wire {
+	simulated_badge *from;
+	uint8_t from_pin;
+	simulated_badge *to;
+	uint8_t to_pin;
+};
+
+// The chain's connector: TX to RX both ways, and the right badge's left sense line.
+const wire wires[] = {
+	{ &left_badge, SIG_R1, &right_badge, SIG_L1 },
+	{ &right_badge, SIG_L2, &left_badge, SIG_R2 },
+	{ &right_badge, SIG_L3, &left_badge, SIG_R3 },
+};
+
+void on_wire_output(avr_irq_t *, uint32_t value, void *param)
+{
+	const auto& connection = *static_cast<const wire *>(param);
+
+	if (are_badges_connected) {
+		avr_raise_irq(port_d_pin(*connection.to, connection.to_pin), value & 1);
+	}
+}
+
+void connect_badges()
+{
+	are_badges_connected = true;
+	for (const auto& connection : wires) {
+		avr_raise_irq(port_d_pin(*connection.to, connection.to_pin),
+			      output_level(*connection.from, connection.from_pin));
+	}
+}
+
+void set_button(simulated_badge& badge, button id, bool is_pressed)
+{
+	switch (id) {
+	case button::OK:
+	case button::CANCEL:
+		// Analog-only pins on the ATmega328P: ADC7 and ADC6.
+		avr_raise_irq(avr_io_getirq(badge.avr,
+					    AVR_IOCTL_ADC_GETIRQ,
+					    id == button::OK ? ADC_IRQ_ADC7 : ADC_IRQ_ADC6),
+			      is_pressed ? 0 : vcc_mv);
+		break;
+	default:
+		avr_raise_irq(avr_io_getirq(badge.avr, AVR_IOCTL_IOPORT_GETIRQ('C'), uint8_t(id)),
+			      !is_pressed);
+		break;
+	}
+}
+
+bool make_badge(simulated_badge& badge, elf_firmware_t& firmware)
+{
+	badge.avr = avr_make_mcu_by_name(firmware.mmcu);
+	if (!badge.avr) {
+		return false;
+	}
+
+	avr_init(badge.avr);
+	avr_load_firmware(badge.avr, &firmware);
+	badge.avr->vcc = badge.avr->avcc = badge.avr->aref = vcc_mv;
+
+	// Keep the serial output out of the report.
+	uint32_t uart_flags = 0;
+
+	avr_ioctl(badge.avr, AVR_IOCTL_UART_GET_FLAGS('0'), &uart_flags);
+	uart_flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(badge.avr, AVR_IOCTL_UART_SET_FLAGS('0'), &uart_flags);
+
+	avr_irq_register_notify(avr_io_getirq(badge.avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT),
+				on_twi_output,
+				&badge);
+
+	// Disconnected lines and released buttons are pulled up.
+	for (const auto pin : { SIG_L1, SIG_R2, SIG_R3 }) {
+		avr_raise_irq(port_d_pin(badge, pin), 1);
+	}
+
+	for (const auto id : { button::RIGHT,
+			       button::UP,
+			       button::DOWN,
+			       button::LEFT,
+			       button::CANCEL,
+			       button::OK }) {
+		set_button(badge, id, false);
+	}
+
+	return true;
+}
+
+struct scripted_event {
+	unsigned long time_ms;
+	enum class type : uint8_t { PRESS, RELEASE, CONNECT } type;
+	button id;
+};
+
+constexpr unsigned long hold_ms = 80;
+
+const scripted_event scenario[] = {
+	// From the left badge's name screen to its main menu, through its entries and back.
+	{ 3000, scripted_event::type::PRESS, button::CANCEL },
+	{ 3000 + hold_ms, scripted_event::type::RELEASE, button::CANCEL },
+	{ 3400, scripted_event::type::PRESS, button::DOWN },
+	{ 3400 + hold_ms, scripted_event::type::RELEASE, button::DOWN },
+	{ 3800, scripted_event::type::PRESS, button::DOWN },
+	{ 3800 + hold_ms, scripted_event::type::RELEASE, button::DOWN },
+	{ 4200, scripted_event::type::PRESS, button::UP },
+	{ 4200 + hold_ms, scripted_event::type::RELEASE, button::UP },
+	// Open the badge information screen, then back to the main menu and the name screen.
+	{ 4600, scripted_event::type::PRESS, button::OK },
+	{ 4600 + hold_ms, scripted_event::type::RELEASE, button::OK },
+	{ 5000, scripted_event::type::PRESS, button::CANCEL },
+	{ 5000 + hold_ms, scripted_event::type::RELEASE, button::CANCEL },
+	{ 5400, scripted_event::type::PRESS, button::CANCEL },
+	{ 5400 + hold_ms, scripted_event::type::RELEASE, button::CANCEL },
+	{ 6000, scripted_event::type::CONNECT, {} },
+};
+
+void apply(const scripted_event& event)
+{
+	switch (event.type) {
+	case scripted_event::type::PRESS:
+	case scripted_event::type::RELEASE:
+		set_button(left_badge, event.id, event.type == scripted_event::type::PRESS);
+		break;
+	case scripted_event::type::CONNECT:
+		connect_badges();
+		break;
+	}
+}
+
+avr_cycle_count_t ms_to_cycles(unsigned long time_ms)
+{
+	return avr_cycle_count_t(time_ms) * (cpu_frequency / 1000);
+}
+
+bool simulate(unsigned long duration_ms)
+{
+	const auto end_cycle = ms_to_cycles(duration_ms);
+	size_t next_event = 0;
+
+	while (true) {
+		auto& badge = left_badge.avr->cycle <= right_badge.avr->cycle ? left_badge :
+										 right_badge;
+		const auto cycle = badge.avr->cycle;
+
+		if (cycle >= end_cycle) {
+			return true;
+		}
+
+		while (next_event < sizeof(scenario) / sizeof(*scenario) &&
+		       cycle >= ms_to_cycles(scenario[next_event].time_ms)) {
+			apply(scenario[next_event++]);
+		}
+
+		observe_calls(badge);
+
+		const auto state = avr_run(badge.avr);
+
+		if (state == cpu_Done || state == cpu_Crashed) {
+			std::cerr << (&badge == &left_badge ? "Left" : "Right") << " badge "
+				  << (state == cpu_Done ? "stopped" : "crashed") << " at "
+				  << cycle * 1000 / cpu_frequency << " ms\n";
+			return false;
+		}
+	}
+}
+
+std::string report(unsigned long duration_ms)
+{
+	std::ostringstream table;
+	char line[128];
+	const double total_cycles = 2.0 * duration_ms * (cpu_frequency / 1000);
+
+	std::snprintf(line,
+		      sizeof(line),
+		      "%-42s %9s %9s %9s %9s %7s\n",
+		      "function",
+		      "calls",
+		      "min",
+		      "mean",
+		      "max",
+		      "busy %");
+	table << line;
+	for (uint8_t i = 0; i < measured_function_count; i++) {
+		const auto& stats = statistics[i];
+
+		std::snprintf(line,
+			      sizeof(line),
+			      "%-42s %9lu %9llu %9llu %9llu %7.2f\n",
+			      measured_functions[i].label,
+			      stats.call_count,
+			      (unsigned long long) stats.min_cycles,
+			      (unsigned long long) (stats.call_count ?
+							    stats.total_cycles / stats.call_count :
+							    0),
+			      (unsigned long long) stats.max_cycles,
+			      stats.total_cycles * 100 / total_cycles);
+		table << line;
+	}
+
+	return table.str();
+}
+
+/* Mean cycles per call of each function of a baseline table. */
+std::map<std::string, unsigned long long> read_baseline(std::istream& in)
+{
+	std::map<std::string, unsigned long long> means;
+	std::string line;
+
+	while (std::getline(in, line)) {
+		std::istringstream fields(line);
+		std::string label;
+		unsigned long long calls, min, mean;
+
+		if (fields >> label >> calls >> min >> mean) {
+			means[label] = mean;
+		}
+	}
+
+	return means;
+}
+
+/* Returns false if a function regressed. */
+bool compare_to_baseline(std::istream& baseline)
+{
+	const auto baseline_means = read_baseline(baseline);
+	bool has_regressed = false;
+
+	std::printf("\n%-42s %9s %9s %8s\n", "function", "baseline", "mean", "change");
+	for (uint8_t i = 0; i < measured_function_count; i++) {
+		const auto& stats = statistics[i];
+		const auto entry = baseline_means.find(measured_functions[i].label);
+
+		if (entry == baseline_means.end() || entry->second == 0 || stats.call_count == 0) {
+			std::printf("%-42s %9s\n", measured_functions[i].label, "-");
+			continue;
+		}
+
+		const auto mean = stats.total_cycles / stats.call_count;
+		const double change_percent = (double(mean) - entry->second) * 100 / entry->second;
+		const bool is_regression = change_percent > regression_threshold_percent;
+
+		has_regressed |= is_regression;
+		std::printf("%-42s %9llu %9llu %+7.1f%%%s\n",
+			    measured_functions[i].label,
+			    entry->second,
+			    (unsigned long long) mean,
+			    change_percent,
+			    is_regression ? "  REGRESSION" : "");
+	}
+
+	return !has_regressed;
+}
+
+int usage(const char *program_name)
+{
+	std::cerr << "Usage: " << program_name
+		  << " <firmware.elf> [--duration <ms>] [--baseline <path> [--update-baseline]]\n";
+	return 2;
+}
+} // namespace
+
+int main(int argc, const char **argv)
+{
+	if (argc < 2) {
+		return usage(argv[0]);
+	}
+
+	const char *elf_path = argv[1];
+	const char *baseline_path = nullptr;
+	unsigned long duration_ms = default_duration_ms;
+	bool update_baseline = false;
+
+	for (int i = 2; i < argc; i++) {
+		if (!std::strcmp(argv[i], "--duration") && i + 1 < argc) {
+			duration_ms = std::stoul(argv[++i]);
+		} else if (!std::strcmp(argv[i], "--baseline") && i + 1 < argc) {
+			baseline_path = argv[++i];
+		} else if (!std::strcmp(argv[i], "--update-baseline")) {
+			update_baseline = true;
+		} else {
+			return usage(argv[0]);
+		}
+	}
+
+	if (update_baseline && !baseline_path) {
+		return usage(argv[0]);
+	}
+
+	elf_firmware_t firmware = {};
+
+	if (elf_read_firmware(elf_path, &firmware)) {
+		std::cerr << "Failed to load " << elf_path << '\n';
+		return 2;
+	}
+
+	std::strcpy(firmware.mmcu, "atmega328p");
+	firmware.frequency = cpu_frequency;
+	for (auto& badge : badges) {
+		if (!make_badge(badge, firmware)) {
+			std::cerr << "Failed to create the simulated MCU\n";
+			return 2;
+		}
+	}
+
+	if (!find_measured_functions(elf_path, left_badge.avr->flashend + 1)) {
+		std::cerr << "Failed to read the symbols of " << elf_path << '\n';
+		return 2;
+	}
+
+	for (const auto& connection : wires) {
+		avr_irq_register_notify(port_d_pin(*connection.from, connection.from_pin),
+					on_wire_output,
+					const_cast<wire *>(&connection));
+	}
+
+	if (!simulate(duration_ms)) {
+		return 2;
+	}
+
+	const auto table = report(duration_ms);
+
+	std::printf("Cycles per call, 2 badges at 8 MHz for %lu ms\n\n%s",
+		    duration_ms,
+		    table.c_str());
+	if (update_baseline) {
+		std::ofstream(baseline_path) << table;
+		return 0;
+	}
+
+	if (baseline_path) {
+		std::ifstream baseline(baseline_path);
+
+		if (!baseline) {
+			std::cerr << "No baseline at " << baseline_path
+				  << ", create it with --update-baseline\n";
+			return 2;
+		}
+
+		return compare_to_baseline(baseline) ? 0 : 1;
+	}
+
+	return 0;
+}
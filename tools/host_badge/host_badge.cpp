@@ -0,0 +1,335 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+/*
+ * Host build of the complete firmware.
+ *
+ * The badge runs on the Arduino host shims (lib/host_shims) and a virtual clock: the main
+ * loop is the one of src/main.cpp, except that the time the badge would spend idle is
+ * skipped. Buttons are pressed by driving their pins, the panel's content is decoded from
+ * the TWI traffic and the serial output is printed as it is produced.
+ *
+ *   host_badge run [duration_ms] [--press <button>@<time_ms>[+<hold_ms>]]...
+ *                  [--type <time_ms>:<line>]...
+ *   host_badge bench [duration_ms]
+ *
+ * Times are counted from power-up. Buttons are named up, down, left, right, ok and cancel.
+ */
+
+#include "badge.hpp"
+#include "board.hpp"
+#include "globals.hpp"
+#include "host_clock.hpp"
+#include "host_oled.hpp"
+#include "host_pins.hpp"
+
+#include <Adafruit_NeoPixel.h>
+#include <EEPROM.h>
+#include <Wire.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace ns = nsec::scheduling;
+
+namespace {
+constexpr unsigned long default_duration_ms = 10000;
+// Time left to the badge's boot sequence before the benchmark's first button press.
+constexpr unsigned long bench_boot_duration_ms = 3000;
+constexpr unsigned long bench_press_period_ms = 400;
+constexpr unsigned long default_hold_ms = 80;
+
+struct input_event {
+	unsigned long time_ms;
+	enum class type { PRESS, RELEASE, SERIAL_LINE } type;
+	uint8_t pin;
+	std::string line;
+};
+
+struct run_statistics {
+	unsigned long duration_ms;
+	unsigned long tick_count;
+	// Time spent by the host in the main loop.
+	unsigned long long host_ns;
+	unsigned long display_frame_count;
+	unsigned long twi_bytes;
+	unsigned long led_show_count;
+	unsigned long eeprom_write_count;
+	unsigned long serial_bytes;
+};
+
+bool echo_serial_output;
+unsigned long led_show_count;
+
+void on_serial_output(uint8_t byte)
+{
+	if (echo_serial_output) {
+		std::putchar(byte);
+	}
+}
+
+void on_led_show(const Adafruit_NeoPixel&)
+{
+	led_show_count++;
+}
+
+bool button_pin(const std::string& name, uint8_t& pin)
+{
+	static const struct {
+		const char *name;
+		uint8_t pin;
+	} buttons[] = {
+		{ "up", BTN_UP },	  { "down", BTN_DOWN }, { "left", BTN_LEFT },
+		{ "right", BTN_RIGHT }, { "ok", BTN_OK },	    { "cancel", BTN_CANCEL },
+	};
+
+	for (const auto& button : buttons) {
+		if (name == button.name) {
+			pin = button.pin;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void add_press(std::vector<input_event>& events,
+	       unsigned long time_ms,
+	       uint8_t pin,
+	       unsigned long hold_ms)
+{
+	events.push_back({ time_ms, input_event::type::PRESS, pin, {} });
+	events.push_back({ time_ms + hold_ms, input_event::type::RELEASE, pin, {} });
+}
+
+void apply(const input_event& event)
+{
+	switch (event.type) {
+	case input_event::type::PRESS:
+		// The buttons short their pin to ground.
+		nsec::host::drive_pin(event.pin, false);
+		break;
+	case input_event::type::RELEASE:
+		nsec::host::release_pin(event.pin);
+		break;
+	case input_event::type::SERIAL_LINE:
+	{
+		const auto line = event.line + "\n";
+
+		Serial.receive(reinterpret_cast<const uint8_t *>(line.data()), line.size());
+		break;
+	}
+	}
+}
+
+/*
+ * Run the badge's main loop until `end_time_ms`, applying the input events as their time
+ * comes. After each tick, the clock jumps to the scheduler's next deadline, unless the
+ * tasks already consumed that time (blocking transfers advance the clock).
+ */
+run_statistics simulate(unsigned long end_time_ms, std::vector<input_event> events)
+{
+	run_statistics stats = {};
+	const auto start_time_ms = millis();
+	const auto initial_twi_bytes = Wire.bytes_sent();
+	const auto initial_frame_count = nsec::host::oled::frame_count();
+	const auto initial_led_show_count = led_show_count;
+	const auto initial_eeprom_write_count = EEPROM.write_count();
+	const auto initial_serial_bytes = Serial.bytes_sent();
+	size_t next_event = 0;
+
+	std::stable_sort(events.begin(), events.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.time_ms < rhs.time_ms;
+	});
+
+	while (millis() < end_time_ms) {
+		while (next_event < events.size() && events[next_event].time_ms <= millis()) {
+			apply(events[next_event++]);
+		}
+
+		const auto tick_time_ms = millis();
+		const auto start = std::chrono::steady_clock::now();
+
+		nsec::g::the_badge.check_wake_up_sources();
+
+		const auto time_to_next_tick = nsec::g::the_scheduler.tick(tick_time_ms);
+		const auto end = std::chrono::steady_clock::now();
+
+		stats.host_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+					 .count();
+		stats.tick_count++;
+
+		auto next_tick_time_ms =
+			tick_time_ms + std::max<ns::relative_time_ms>(time_to_next_tick, 1);
+
+		if (next_event < events.size()) {
+			next_tick_time_ms = std::min(next_tick_time_ms, events[next_event].time_ms);
+		}
+
+		next_tick_time_ms = std::min(next_tick_time_ms, end_time_ms);
+		if (next_tick_time_ms * 1000ULL > nsec::host::time_us()) {
+			nsec::host::set_time_ms(next_tick_time_ms);
+		}
+	}
+
+	stats.duration_ms = millis() - start_time_ms;
+	stats.display_frame_count = nsec::host::oled::frame_count() - initial_frame_count;
+	stats.twi_bytes = Wire.bytes_sent() - initial_twi_bytes;
+	stats.led_show_count = led_show_count - initial_led_show_count;
+	stats.eeprom_write_count = EEPROM.write_count() - initial_eeprom_write_count;
+	stats.serial_bytes = Serial.bytes_sent() - initial_serial_bytes;
+	return stats;
+}
+
+void print_display()
+{
+	const std::string border = "+" + std::string(SCREEN_WIDTH, '-') + "+";
+
+	std::cout << border << (nsec::host::oled::is_on() ? "" : " (off)") << '\n';
+	for (uint8_t y = 0; y < SCREEN_HEIGHT; y++) {
+		std::string row;
+
+		for (uint8_t x = 0; x < SCREEN_WIDTH; x++) {
+			row += nsec::host::oled::pixel(x, y) ? '#' : ' ';
+		}
+
+		std::cout << '|' << row << "|\n";
+	}
+
+	std::cout << border << '\n';
+}
+
+void print_statistics(const run_statistics& stats)
+{
+	const double seconds = std::max<unsigned long>(stats.duration_ms, 1) / 1000.0;
+
+	std::printf("virtual time:     %lu ms\n", stats.duration_ms);
+	std::printf("host time:        %.3f ms (%.0fx real time)\n",
+		    stats.host_ns / 1e6,
+		    stats.duration_ms * 1e6 / std::max<unsigned long long>(stats.host_ns, 1));
+	std::printf("scheduler ticks:  %lu (%.0f host ns/tick)\n",
+		    stats.tick_count,
+		    double(stats.host_ns) / std::max<unsigned long>(stats.tick_count, 1));
+	std::printf("display frames:   %lu (%.1f/s)\n",
+		    stats.display_frame_count,
+		    stats.display_frame_count / seconds);
+	std::printf("TWI bytes:        %lu (%.0f/s)\n", stats.twi_bytes, stats.twi_bytes / seconds);
+	std::printf("LED frames:       %lu (%.1f/s)\n",
+		    stats.led_show_count,
+		    stats.led_show_count / seconds);
+	std::printf("EEPROM writes:    %lu\n", stats.eeprom_write_count);
+	std::printf("serial bytes:     %lu\n", stats.serial_bytes);
+}
+
+int usage(const char *program_name)
+{
+	std::cerr << "Usage:\n"
+		  << "  " << program_name
+		  << " run [duration_ms] [--press <button>@<time_ms>[+<hold_ms>]]... "
+		     "[--type <time_ms>:<line>]...\n"
+		  << "  " << program_name << " bench [duration_ms]\n"
+		  << "Buttons: up, down, left, right, ok, cancel\n";
+	return 1;
+}
+
+int run(int argc, const char **argv)
+{
+	unsigned long duration_ms = default_duration_ms;
+	std::vector<input_event> events;
+
+	for (int i = 2; i < argc; i++) {
+		if (!std::strcmp(argv[i], "--press") && i + 1 < argc) {
+			const std::string press = argv[++i];
+			const auto at = press.find('@');
+			const auto plus = press.find('+');
+			uint8_t pin;
+
+			if (at == std::string::npos || !button_pin(press.substr(0, at), pin)) {
+				std::cerr << "Invalid button press: " << press << '\n';
+				return usage(argv[0]);
+			}
+
+			add_press(events,
+				  std::stoul(press.substr(at + 1, plus - at - 1)),
+				  pin,
+				  plus == std::string::npos ? default_hold_ms :
+							      std::stoul(press.substr(plus + 1)));
+		} else if (!std::strcmp(argv[i], "--type") && i + 1 < argc) {
+			const std::string input = argv[++i];
+			const auto colon = input.find(':');
+
+			if (colon == std::string::npos) {
+				std::cerr << "Invalid serial input: " << input << '\n';
+				return usage(argv[0]);
+			}
+
+			events.push_back({ std::stoul(input.substr(0, colon)),
+					   input_event::type::SERIAL_LINE,
+					   0,
+					   input.substr(colon + 1) });
+		} else {
+			duration_ms = std::stoul(argv[i]);
+		}
+	}
+
+	echo_serial_output = true;
+
+	const auto stats = simulate(duration_ms, events);
+
+	std::cout << '\n';
+	print_display();
+	print_statistics(stats);
+	return 0;
+}
+
+/*
+ * Navigate the menus at a steady pace: enough to exercise the renderer, the button
+ * watcher and the screens' transitions on every run in the same way.
+ */
+int bench(int argc, const char **argv)
+{
+	const unsigned long duration_ms = argc > 2 ? std::stoul(argv[2]) : default_duration_ms;
+	// From the name screen to the main menu, through its entries and back.
+	static const uint8_t sequence[] = { BTN_CANCEL, BTN_DOWN, BTN_DOWN, BTN_DOWN,
+					    BTN_UP,	BTN_UP,	  BTN_CANCEL };
+	std::vector<input_event> events;
+	unsigned int i = 0;
+
+	for (auto time_ms = bench_boot_duration_ms; time_ms < duration_ms;
+	     time_ms += bench_press_period_ms) {
+		add_press(events, time_ms, sequence[i++ % sizeof(sequence)], default_hold_ms);
+	}
+
+	print_statistics(simulate(duration_ms, events));
+	return 0;
+}
+
+} // namespace
+
+int main(int argc, const char **argv)
+{
+	if (argc < 2) {
+		return usage(argv[0]);
+	}
+
+	HardwareSerial::set_output_observer(on_serial_output);
+	Adafruit_NeoPixel::set_show_observer(on_led_show);
+	nsec::host::oled::attach(SCREEN_ADDRESS);
+	nsec::g::the_badge.setup();
+
+	if (!std::strcmp(argv[1], "run")) {
+		return run(argc, argv);
+	} else if (!std::strcmp(argv[1], "bench")) {
+		return bench(argc, argv);
+	}
+
+	return usage(argv[0]);
+}
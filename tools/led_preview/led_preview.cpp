@@ -0,0 +1,371 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+/*
+ * Host-side previewer and benchmark of the LED strip animations.
+ *
+ * The strip animator is built against the NeoPixel host shim and driven by the scheduler on a
+ * virtual clock, so every frame "sent" to the strip can be captured and the work done to
+ * produce it can be counted, without flashing a badge.
+ *
+ *   led_preview list
+ *   led_preview render <animation> [duration_ms] [--csv <path>] [--ppm <path>]
+ *   led_preview bench [duration_ms]
+ *
+ * Animations are named:
+ *   idle:<id>, progress:<led count>, pairing-completed:<happy|sad>, level:<value>
+ */
+
+#include "globals.hpp"
+#include "host_clock.hpp"
+#include "led/strip_animator.hpp"
+#include "led_preview_probes.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace nl = nsec::led;
+namespace ns = nsec::scheduling;
+
+nsec::led::preview::probe_counters nsec::led::preview::probes;
+ns::scheduler<nsec::config::scheduler::max_scheduled_task_count,
+	      nsec::diagnostics::scheduler_observer>
+	nsec::g::the_scheduler;
+
+namespace {
+constexpr unsigned long default_duration_ms = 10000;
+
+struct frame {
+	unsigned long time_ms;
+	uint8_t rgb[NUMPIXELS][3];
+};
+
+struct run_statistics {
+	unsigned long duration_ms;
+	unsigned long frame_count;
+	unsigned long interpolate_count;
+	unsigned long set_pixel_color_count;
+	unsigned long show_wire_time_us;
+	// Time spent by the host in the scheduler's tick (i.e. the animator's run()).
+	unsigned long long host_ns;
+	// Estimated current draw of the LEDs (running average) at the end of the run.
+	unsigned int average_current_ma;
+};
+
+std::vector<frame> captured_frames;
+bool capture_frames;
+// The animator's strip, known once it has shown its first frame.
+const Adafruit_NeoPixel *strip;
+
+void on_show(const Adafruit_NeoPixel& pixels)
+{
+	strip = &pixels;
+	if (!capture_frames) {
+		return;
+	}
+
+	frame new_frame;
+
+	new_frame.time_ms = millis();
+	for (uint16_t i = 0; i < NUMPIXELS; i++) {
+		const auto color = pixels.getPixelColor(i);
+
+		new_frame.rgb[i][0] = uint8_t(color >> 16);
+		new_frame.rgb[i][1] = uint8_t(color >> 8);
+		new_frame.rgb[i][2] = uint8_t(color);
+	}
+
+	captured_frames.emplace_back(new_frame);
+}
+
+nl::strip_animator& the_animator()
+{
+	// Constructed on first use; it registers itself with the scheduler.
+	static nl::strip_animator animator;
+
+	return animator;
+}
+
+ns::absolute_time_ms current_time_ms;
+
+bool set_animation(const std::string& name)
+{
+	const auto separator = name.find(':');
+
+	if (separator == std::string::npos) {
+		return false;
+	}
+
+	const auto kind = name.substr(0, separator);
+	const auto argument = name.substr(separator + 1);
+	auto& animator = the_animator();
+
+	nsec::host::set_time_ms(current_time_ms);
+	if (kind == "idle") {
+		animator.set_idle_animation(uint8_t(std::stoul(argument)));
+	} else if (kind == "progress") {
+		animator.set_red_to_green_led_progress_bar(uint8_t(std::stoul(argument)));
+	} else if (kind == "pairing-completed") {
+		if (argument != "happy" && argument != "sad") {
+			return false;
+		}
+
+		animator.set_pairing_completed_animation(
+			argument == "happy" ?
+				nl::strip_animator::pairing_completed_animation_type::HAPPY_CLOWN_BARF :
+				nl::strip_animator::pairing_completed_animation_type::NO_NEW_FRIENDS);
+	} else if (kind == "level") {
+		animator.set_show_level_animation(
+			nl::strip_animator::pairing_completed_animation_type::HAPPY_CLOWN_BARF,
+			uint8_t(std::stoul(argument)),
+			true);
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+std::vector<std::string> all_animations()
+{
+	std::vector<std::string> names;
+
+	for (unsigned int i = 0; i < nl::strip_animator::idle_animation_count(); i++) {
+		names.emplace_back("idle:" + std::to_string(i));
+	}
+
+	names.emplace_back("progress:8");
+	names.emplace_back("progress:16");
+	names.emplace_back("pairing-completed:happy");
+	names.emplace_back("pairing-completed:sad");
+	names.emplace_back("level:170");
+	return names;
+}
+
+/* Run the scheduler on the virtual clock for `duration_ms`. */
+run_statistics simulate(unsigned long duration_ms)
+{
+	const auto end_time_ms = current_time_ms + duration_ms;
+	const auto initial_show_count = strip ? strip->show_count() : 0;
+	const auto initial_set_pixel_color_count = strip ? strip->set_pixel_color_count() : 0;
+	run_statistics stats = {};
+
+	stats.duration_ms = duration_ms;
+	nsec::led::preview::probes = {};
+
+	while (current_time_ms < end_time_ms) {
+		nsec::host::set_time_ms(current_time_ms);
+
+		const auto start = std::chrono::steady_clock::now();
+		const auto time_to_next_tick = nsec::g::the_scheduler.tick(current_time_ms);
+		const auto end = std::chrono::steady_clock::now();
+
+		stats.host_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+					 .count();
+		current_time_ms += std::max<ns::relative_time_ms>(time_to_next_tick, 1);
+	}
+
+	if (strip) {
+		stats.frame_count = strip->show_count() - initial_show_count;
+		stats.set_pixel_color_count =
+			strip->set_pixel_color_count() - initial_set_pixel_color_count;
+		stats.show_wire_time_us = stats.frame_count * strip->show_duration_us();
+	}
+
+	stats.interpolate_count = nsec::led::preview::probes.interpolate;
+	stats.average_current_ma = the_animator().average_current_ma();
+	return stats;
+}
+
+void write_csv(std::ostream& out)
+{
+	out << "time_ms";
+	for (unsigned int i = 0; i < NUMPIXELS; i++) {
+		out << ",r" << i << ",g" << i << ",b" << i;
+	}
+
+	out << '\n';
+	for (const auto& frame : captured_frames) {
+		out << frame.time_ms;
+		for (const auto& led : frame.rgb) {
+			out << ',' << unsigned(led[0]) << ',' << unsigned(led[1]) << ','
+			    << unsigned(led[2]);
+		}
+
+		out << '\n';
+	}
+}
+
+/*
+ * Timeline image: one row per frame, top to bottom, with one block per LED. Values are what
+ * the strip receives (after gamma and brightness), stretched so that the brightest component
+ * of the capture is displayed at full scale.
+ */
+void write_ppm(std::ostream& out)
+{
+	constexpr unsigned int led_width = 8, frame_height = 2;
+	uint8_t max_component = 1;
+
+	for (const auto& frame : captured_frames) {
+		for (const auto& led : frame.rgb) {
+			max_component = std::max({ max_component, led[0], led[1], led[2] });
+		}
+	}
+
+	out << "P6\n"
+	    << NUMPIXELS * led_width << ' ' << captured_frames.size() * frame_height << "\n255\n";
+	for (const auto& frame : captured_frames) {
+		for (unsigned int line = 0; line < frame_height; line++) {
+			for (const auto& led : frame.rgb) {
+				for (unsigned int x = 0; x < led_width; x++) {
+					for (const auto component : led) {
+						out.put(char(component * 255 / max_component));
+					}
+				}
+			}
+		}
+	}
+}
+
+void print_statistics_header()
+{
+	std::printf("%-26s %8s %10s %12s %12s %10s %8s\n",
+		    "animation",
+		    "frames/s",
+		    "interp/fr",
+		    "setpixel/fr",
+		    "host ns/fr",
+		    "irq-off %",
+		    "avg mA");
+}
+
+void print_statistics(const std::string& name, const run_statistics& stats)
+{
+	const double frames = std::max<unsigned long>(stats.frame_count, 1);
+
+	std::printf("%-26s %8.1f %10.2f %12.2f %12.0f %10.2f %8u\n",
+		    name.c_str(),
+		    stats.frame_count * 1000.0 / stats.duration_ms,
+		    stats.interpolate_count / frames,
+		    stats.set_pixel_color_count / frames,
+		    stats.host_ns / frames,
+		    stats.show_wire_time_us / (stats.duration_ms * 10.0),
+		    stats.average_current_ma);
+}
+
+int usage(const char *program_name)
+{
+	std::cerr << "Usage:\n"
+		  << "  " << program_name << " list\n"
+		  << "  " << program_name
+		  << " render <animation> [duration_ms] [--csv <path>] [--ppm <path>]\n"
+		  << "  " << program_name << " bench [duration_ms]\n"
+		  << "Animations: idle:<id>, progress:<led count>, "
+		     "pairing-completed:<happy|sad>, level:<value>\n";
+	return 1;
+}
+
+int render(int argc, const char **argv)
+{
+	if (argc < 3) {
+		return usage(argv[0]);
+	}
+
+	const std::string animation = argv[2];
+	unsigned long duration_ms = default_duration_ms;
+	const char *csv_path = nullptr, *ppm_path = nullptr;
+
+	for (int i = 3; i < argc; i++) {
+		if (!std::strcmp(argv[i], "--csv") && i + 1 < argc) {
+			csv_path = argv[++i];
+		} else if (!std::strcmp(argv[i], "--ppm") && i + 1 < argc) {
+			ppm_path = argv[++i];
+		} else {
+			duration_ms = std::stoul(argv[i]);
+		}
+	}
+
+	if (!set_animation(animation)) {
+		std::cerr << "Unknown animation: " << animation << '\n';
+		return usage(argv[0]);
+	}
+
+	capture_frames = true;
+	const auto stats = simulate(duration_ms);
+
+	if (csv_path) {
+		std::ofstream csv(csv_path);
+		write_csv(csv);
+	} else {
+		write_csv(std::cout);
+	}
+
+	if (ppm_path) {
+		std::ofstream ppm(ppm_path, std::ios::binary);
+		write_ppm(ppm);
+	}
+
+	print_statistics_header();
+	print_statistics(animation, stats);
+	return 0;
+}
+
+int bench(int argc, const char **argv)
+{
+	const unsigned long duration_ms = argc > 2 ? std::stoul(argv[2]) : default_duration_ms;
+	run_statistics total = {};
+
+	print_statistics_header();
+	for (const auto& animation : all_animations()) {
+		set_animation(animation);
+
+		const auto stats = simulate(duration_ms);
+
+		print_statistics(animation, stats);
+		total.duration_ms += stats.duration_ms;
+		total.frame_count += stats.frame_count;
+		total.interpolate_count += stats.interpolate_count;
+		total.set_pixel_color_count += stats.set_pixel_color_count;
+		total.show_wire_time_us += stats.show_wire_time_us;
+		total.host_ns += stats.host_ns;
+		total.average_current_ma = std::max(total.average_current_ma, stats.average_current_ma);
+	}
+
+	print_statistics("total", total);
+	return 0;
+}
+
+} // namespace
+
+int main(int argc, const char **argv)
+{
+	if (argc < 2) {
+		return usage(argv[0]);
+	}
+
+	Adafruit_NeoPixel::set_show_observer(on_show);
+	the_animator().setup();
+
+	if (!std::strcmp(argv[1], "list")) {
+		for (const auto& animation : all_animations()) {
+			std::cout << animation << '\n';
+		}
+
+		return 0;
+	} else if (!std::strcmp(argv[1], "render")) {
+		return render(argc, argv);
+	} else if (!std::strcmp(argv[1], "bench")) {
+		return bench(argc, argv);
+	}
+
+	return usage(argv[0]);
+}
@@ -0,0 +1,24 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright 2023 Jérémie Galarneau <jeremie.galarneau@gmail.com>
+ */
+
+#ifndef NSEC_LED_PREVIEW_PROBES_HPP
+#define NSEC_LED_PREVIEW_PROBES_HPP
+
+/*
+ * Counters incremented by the LED code when it is built for the previewer
+ * (NSEC_LED_PREVIEW defined). They compile to nothing in the firmware.
+ */
+namespace nsec::led::preview {
+struct probe_counters {
+	unsigned long interpolate;
+};
+
+extern probe_counters probes;
+} // namespace nsec::led::preview
+
+#define NSEC_LED_PREVIEW_PROBE(counter) (nsec::led::preview::probes.counter++)
+
+#endif // NSEC_LED_PREVIEW_PROBES_HPP
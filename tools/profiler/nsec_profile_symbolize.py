@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+
+# SPDX-FileCopyrightText: 2023 NorthSec
+#
+# SPDX-License-Identifier: MIT
+
+"""
+Map the program counter histograms of badges built with NSEC_PROFILER (see
+include/diagnostics/profiler.hpp) to the functions of the firmware.
+
+A dump is the text printed on the serial port by the "Profile" menu entry or the
+"profile" console command; the input files can be raw serial captures holding any
+number of dumps, from one or more badges, which are summed. The firmware's ELF file
+must be the one the badges run.
+
+A histogram bucket covers a range of flash addresses which can hold more than one
+function: its samples are split between them in proportion to the bytes of the range
+they occupy, and such estimates are marked with a '~'.
+
+    nsec_profile_symbolize.py .pio/build/profile/firmware.elf capture.log
+    nsec_profile_symbolize.py --folded firmware.elf capture.log | flamegraph.pl > profile.svg
+
+The histograms hold no call stacks: the folded output has a single frame per function.
+"""
+
+import argparse
+import collections
+import subprocess
+import sys
+
+DUMP_FORMAT_VERSION = 1
+UNKNOWN_SYMBOL = '[unknown]'
+
+
+class DumpError(Exception):
+    pass
+
+
+class Dump:
+    def __init__(self, badge_id, sample_rate_hz, bucket_shift, is_full, buckets):
+        self.badge_id = badge_id
+        self.sample_rate_hz = sample_rate_hz
+        self.bucket_shift = bucket_shift
+        self.is_full = is_full
+        # First byte address -> sample count.
+        self.buckets = buckets
+
+
+def _parse_dump(lines):
+    fields = {}
+    buckets = {}
+
+    for line in lines:
+        key, _, value = line.partition(' ')
+        if key == 'bucket':
+            address, count = value.split()
+            buckets[int(address, 16)] = int(count)
+        elif key in ('badge', 'sample_rate_hz', 'bucket_shift', 'full'):
+            fields[key] = value
+        else:
+            raise DumpError('Unexpected line: {}'.format(line))
+
+    try:
+        return Dump(fields['badge'], int(fields['sample_rate_hz']), int(fields['bucket_shift']),
+                    fields['full'] == '1', buckets)
+    except KeyError as e:
+        raise DumpError('Missing field: {}'.format(e.args[0]))
+
+
+def parse_dumps(path):
+    """Extract the dumps from a serial capture."""
+    dumps = []
+    lines = None
+
+    with open(path, errors='replace') as capture:
+        for line in capture:
+            line = line.strip()
+            if line.startswith('nsec-profile '):
+                version = int(line.split()[1])
+                if version != DUMP_FORMAT_VERSION:
+                    raise DumpError('Unsupported dump format version {}'.format(version))
+
+                lines = []
+            elif lines is None:
+                continue
+            elif line == 'end':
+                dumps.append(_parse_dump(lines))
+                lines = None
+            else:
+                lines.append(line)
+
+    if lines is not None:
+        raise DumpError('Truncated dump in {}'.format(path))
+
+    return dumps
+
+
+def read_functions(nm, elf_path):
+    """Return the [(start, end, name)] of the functions, sorted by address."""
+    output = subprocess.check_output(
+        [nm, '--defined-only', '--print-size', '--demangle', '--numeric-sort', elf_path],
+        text=True)
+    functions = []
+    for line in output.splitlines():
+        fields = line.split(maxsplit=3)
+        if len(fields) != 4 or fields[2] not in 'tTwW':
+            continue
+
+        start = int(fields[0], 16)
+        size = int(fields[1], 16)
+        if size:
+            functions.append((start, start + size, fields[3]))
+
+    return functions
+
+
+def attribute(dumps, functions):
+    """
+    Return {name: [sample count, is estimated]} and the buckets' attributions,
+    [(first address, last address, sample count, [(name, sample count)])].
+    """
+    samples = collections.defaultdict(lambda: [0.0, False])
+    buckets = []
+
+    for dump in dumps:
+        bucket_size = 1 << dump.bucket_shift
+        for bucket_start, count in sorted(dump.buckets.items()):
+            bucket_end = bucket_start + bucket_size
+            overlaps = []
+            for start, end, name in functions:
+                overlap = min(end, bucket_end) - max(start, bucket_start)
+                if overlap > 0:
+                    overlaps.append((name, overlap))
+
+            if not overlaps:
+                overlaps = [(UNKNOWN_SYMBOL, bucket_size)]
+
+            covered = sum(overlap for _, overlap in overlaps)
+            shares = [(name, count * overlap / covered) for name, overlap in overlaps]
+            for name, share in shares:
+                samples[name][0] += share
+                samples[name][1] |= len(shares) > 1
+
+            buckets.append((bucket_start, bucket_end - 1, count, shares))
+
+    return samples, buckets
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('elf', help='firmware ELF file')
+    parser.add_argument('captures', nargs='+', help='serial captures holding profile dumps')
+    parser.add_argument('--nm', default='avr-nm', help='nm of the AVR toolchain')
+    parser.add_argument('--folded', action='store_true',
+                        help='print folded stacks, for flamegraph.pl or speedscope')
+    parser.add_argument('--buckets', action='store_true',
+                        help='print the functions sharing each bucket')
+    args = parser.parse_args()
+
+    try:
+        dumps = [dump for path in args.captures for dump in parse_dumps(path)]
+    except DumpError as e:
+        sys.exit('Invalid dump: {}'.format(e))
+
+    if not dumps:
+        sys.exit('No profile dump found')
+
+    for dump in dumps:
+        if dump.is_full:
+            print('Badge {}: a bucket filled up, sampling stopped early'.format(dump.badge_id),
+                  file=sys.stderr)
+
+    samples, buckets = attribute(dumps, read_functions(args.nm, args.elf))
+    total = sum(count for count, _ in samples.values())
+    ranking = sorted(samples.items(), key=lambda item: item[1][0], reverse=True)
+
+    if args.folded:
+        for name, (count, _) in ranking:
+            if round(count):
+                print('{} {}'.format(name.replace(';', ':'), round(count)))
+        return
+
+    if args.buckets:
+        for first, last, count, shares in buckets:
+            print('0x{:04x}-0x{:04x} {:>8}'.format(first, last, count))
+            for name, share in shares:
+                print('    {:>10.1f}  {}'.format(share, name))
+        print()
+
+    seconds = sum(sum(dump.buckets.values()) / dump.sample_rate_hz for dump in dumps)
+    print('{} samples from {} dump(s), {:.1f} s of run time'.format(round(total), len(dumps),
+                                                                   seconds))
+    print('{:>7}  {:>9}  {}'.format('%', 'samples', 'function'))
+    for name, (count, is_estimated) in ranking:
+        print('{:>6.2f}%  {:>8}{} {}'.format(100 * count / total, round(count),
+                                             '~' if is_estimated else ' ', name))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,306 @@
+#!/usr/bin/env python3
+
+# SPDX-FileCopyrightText: 2023 NorthSec
+#
+# SPDX-License-Identifier: MIT
+
+"""
+Convert trace dumps of badges built with NSEC_TRACE (see include/diagnostics/trace.hpp)
+to a CTF 1.8 trace readable by Babeltrace 2.
+
+A dump is the text printed on the serial port by the "Dump trace" menu entry; the input
+files can be raw serial captures holding any number of dumps, from one or more badges.
+The dumps of each badge become the packets of one stream of the trace.
+
+The badges' clocks are not synchronized: use --align-on to shift the streams so that
+the first occurrence of an event (e.g. pairing_end, which all the badges of a chain hit
+within a few milliseconds) happens at the same time on all badges.
+
+    nsec_trace_to_ctf.py -o trace/ left.log middle.log right.log --align-on pairing_end
+    babeltrace2 trace/
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+DUMP_FORMAT_VERSION = 1
+RECORD_SIZE = 6
+CTF_MAGIC = 0xC1FC1FC1
+CLOCK_ADVANCE = 'clock_advance'
+
+
+class DumpError(Exception):
+    pass
+
+
+class Dump:
+    def __init__(self, badge_id, tracepoints, events):
+        self.badge_id = badge_id
+        # id -> (name, arg0 name or None, arg1 name or None)
+        self.tracepoints = tracepoints
+        # [(absolute time in µs, tracepoint id, arg0, arg1)], oldest first.
+        self.events = events
+
+
+def _parse_records(lines, end_time_us, tracepoints):
+    records = []
+    for line in lines:
+        if len(line) != 2 * RECORD_SIZE:
+            raise DumpError('Malformed record: {}'.format(line))
+
+        records.append(struct.unpack('<HBBH', bytes.fromhex(line)))
+
+    # Merge the clock advances with the delta of the record that follows them.
+    merged = []
+    pending_delta_us = 0
+    for delta_us, tracepoint_id, arg0, arg1 in records:
+        if tracepoint_id not in tracepoints:
+            raise DumpError('Unknown tracepoint id {}'.format(tracepoint_id))
+
+        if tracepoints[tracepoint_id][0] == CLOCK_ADVANCE:
+            pending_delta_us += delta_us + (arg1 << 16)
+            continue
+
+        merged.append((pending_delta_us + delta_us, tracepoint_id, arg0, arg1))
+        pending_delta_us = 0
+
+    # Only the time of the last record is known, walk back from it.
+    events = []
+    time_us = end_time_us
+    for delta_us, tracepoint_id, arg0, arg1 in reversed(merged):
+        events.append((time_us, tracepoint_id, arg0, arg1))
+        time_us -= delta_us
+
+    events.reverse()
+    return events
+
+
+def _parse_dump(lines):
+    badge_id = None
+    tracepoints = {}
+    end_time_us = None
+
+    for index, line in enumerate(lines):
+        keyword, _, value = line.partition(' ')
+        if keyword == 'badge':
+            badge_id = bytes.fromhex(value)
+        elif keyword == 'tracepoint':
+            tracepoint_id, name, arg0_name, arg1_name = value.split()
+            tracepoints[int(tracepoint_id)] = (
+                name.lower(),
+                None if arg0_name == 'none' else arg0_name,
+                None if arg1_name == 'none' else arg1_name,
+            )
+        elif keyword == 'end_time_us':
+            end_time_us = int(value)
+        elif keyword == 'records':
+            record_count = int(value)
+            record_lines = lines[index + 1:index + 1 + record_count]
+            if len(record_lines) != record_count:
+                raise DumpError('Truncated dump')
+
+            if badge_id is None or end_time_us is None:
+                raise DumpError('Incomplete dump header')
+
+            events = _parse_records(record_lines, end_time_us, tracepoints)
+            return Dump(badge_id, tracepoints, events)
+        else:
+            raise DumpError('Unexpected line: {}'.format(line))
+
+    raise DumpError('Truncated dump')
+
+
+def parse_dumps(path):
+    """Extract the dumps from a serial capture."""
+    dumps = []
+    current_dump_lines = None
+
+    with open(path, errors='replace') as capture:
+        for line in capture:
+            line = line.strip()
+            if line.startswith('nsec-trace '):
+                version = int(line.split()[1])
+                if version != DUMP_FORMAT_VERSION:
+                    raise DumpError('Unsupported dump format version {}'.format(version))
+
+                current_dump_lines = []
+            elif current_dump_lines is None:
+                # Not part of a dump.
+                continue
+            elif line == 'end':
+                dumps.append(_parse_dump(current_dump_lines))
+                current_dump_lines = None
+            else:
+                current_dump_lines.append(line)
+
+    if current_dump_lines is not None:
+        raise DumpError('{}: truncated dump'.format(path))
+
+    return dumps
+
+
+def _metadata(tracepoints, badge_id_size):
+    lines = [
+        '/* CTF 1.8 */',
+        '',
+        'typealias integer { size = 8; align = 8; signed = false; } := uint8_t;',
+        'typealias integer { size = 16; align = 8; signed = false; } := uint16_t;',
+        'typealias integer { size = 32; align = 8; signed = false; } := uint32_t;',
+        'typealias integer { size = 64; align = 8; signed = false; } := uint64_t;',
+        '',
+        'trace {',
+        '\tmajor = 1;',
+        '\tminor = 8;',
+        '\tbyte_order = le;',
+        '\tpacket.header := struct {',
+        '\t\tuint32_t magic;',
+        '\t\tuint32_t stream_id;',
+        '\t\tuint64_t stream_instance_id;',
+        '\t};',
+        '};',
+        '',
+        'env {',
+        '\tdomain = "nsec-badge";',
+        '\ttracer_name = "nsec-trace";',
+        '\ttracer_major = {};'.format(DUMP_FORMAT_VERSION),
+        '};',
+        '',
+        'clock {',
+        '\tname = "badge";',
+        '\tdescription = "Time since boot of the badges (see --align-on)";',
+        '\tfreq = 1000000;',
+        '};',
+        '',
+        'typealias integer {',
+        '\tsize = 64; align = 8; signed = false;',
+        '\tmap = clock.badge.value;',
+        '} := badge_clock_t;',
+        '',
+        'stream {',
+        '\tid = 0;',
+        '\tpacket.context := struct {',
+        '\t\tbadge_clock_t timestamp_begin;',
+        '\t\tbadge_clock_t timestamp_end;',
+        '\t\tuint64_t content_size;',
+        '\t\tuint64_t packet_size;',
+        '\t\tuint8_t badge_id[{}];'.format(badge_id_size),
+        '\t};',
+        '\tevent.header := struct {',
+        '\t\tuint8_t id;',
+        '\t\tbadge_clock_t timestamp;',
+        '\t};',
+        '};',
+    ]
+
+    for tracepoint_id, (name, arg0_name, arg1_name) in sorted(tracepoints.items()):
+        if name == CLOCK_ADVANCE:
+            continue
+
+        lines += [
+            '',
+            'event {',
+            '\tname = "{}";'.format(name),
+            '\tid = {};'.format(tracepoint_id),
+            '\tstream_id = 0;',
+        ]
+
+        fields = []
+        if arg0_name:
+            fields.append('\t\tuint8_t {};'.format(arg0_name))
+        if arg1_name:
+            fields.append('\t\tuint16_t {};'.format(arg1_name))
+        if fields:
+            lines += ['\tfields := struct {'] + fields + ['\t};']
+
+        lines.append('};')
+
+    return '\n'.join(lines) + '\n'
+
+
+def _packet(stream_instance_id, dump, time_offset_us):
+    events = bytearray()
+    for time_us, tracepoint_id, arg0, arg1 in dump.events:
+        name, arg0_name, arg1_name = dump.tracepoints[tracepoint_id]
+        events += struct.pack('<BQ', tracepoint_id, time_us + time_offset_us)
+        if arg0_name:
+            events += struct.pack('<B', arg0)
+        if arg1_name:
+            events += struct.pack('<H', arg1)
+
+    header_size = struct.calcsize('<IIQQQQQ') + len(dump.badge_id)
+    packet_size_bits = (header_size + len(events)) * 8
+    header = struct.pack('<IIQQQQQ',
+                         CTF_MAGIC,
+                         0,
+                         stream_instance_id,
+                         dump.events[0][0] + time_offset_us,
+                         dump.events[-1][0] + time_offset_us,
+                         packet_size_bits,
+                         packet_size_bits)
+    return header + dump.badge_id + events
+
+
+def _first_occurrence_us(dumps, event_name):
+    for dump in dumps:
+        for time_us, tracepoint_id, _, _ in dump.events:
+            if dump.tracepoints[tracepoint_id][0] == event_name:
+                return time_us
+
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('captures', nargs='+', help='serial captures holding trace dumps')
+    parser.add_argument('-o', '--output', required=True, help='output CTF trace directory')
+    parser.add_argument('--align-on', metavar='EVENT',
+                        help='align the badges on the first occurrence of an event')
+    args = parser.parse_args()
+
+    dumps_per_badge = {}
+    try:
+        for path in args.captures:
+            for dump in parse_dumps(path):
+                if dump.events:
+                    dumps_per_badge.setdefault(dump.badge_id, []).append(dump)
+    except (DumpError, ValueError) as error:
+        sys.exit('Failed to parse the trace dumps: {}'.format(error))
+
+    if not dumps_per_badge:
+        sys.exit('No trace records found')
+
+    all_dumps = [dump for dumps in dumps_per_badge.values() for dump in dumps]
+    tracepoints = all_dumps[0].tracepoints
+    badge_id_size = len(all_dumps[0].badge_id)
+    if any(dump.tracepoints != tracepoints or len(dump.badge_id) != badge_id_size
+           for dump in all_dumps):
+        sys.exit('The dumps come from different firmware versions')
+
+    # Per-badge shift of the timestamps.
+    offsets_us = {badge_id: 0 for badge_id in dumps_per_badge}
+    if args.align_on:
+        for badge_id, dumps in dumps_per_badge.items():
+            occurrence_us = _first_occurrence_us(dumps, args.align_on)
+            if occurrence_us is None:
+                sys.exit('Badge {} never hit {}'.format(badge_id.hex(), args.align_on))
+
+            offsets_us[badge_id] = -occurrence_us
+
+    # Timestamps are unsigned: start the trace at 0.
+    base_us = -min(dump.events[0][0] + offsets_us[dump.badge_id] for dump in all_dumps)
+
+    os.makedirs(args.output, exist_ok=True)
+    with open(os.path.join(args.output, 'metadata'), 'w') as metadata:
+        metadata.write(_metadata(tracepoints, badge_id_size))
+
+    for stream_instance_id, (badge_id, dumps) in enumerate(sorted(dumps_per_badge.items())):
+        dumps.sort(key=lambda dump: dump.events[0][0])
+        with open(os.path.join(args.output, 'badge_' + badge_id.hex()), 'wb') as stream:
+            for dump in dumps:
+                stream.write(_packet(stream_instance_id, dump, offsets_us[badge_id] + base_us))
+
+
+if __name__ == '__main__':
+    main()